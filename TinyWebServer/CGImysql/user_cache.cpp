@@ -0,0 +1,91 @@
+#include "user_cache.h"
+
+UserCache::UserCache(): shardCapacity(0), ttlMs(0), negativeTtlMs(0) {
+}
+
+void UserCache::init(int capacity, int ttlMs, int negativeTtlMs) {
+    this->shardCapacity = capacity <= 0 ? 0 : (capacity + SHARD_NUM - 1) / SHARD_NUM;
+    this->ttlMs = ttlMs;
+    this->negativeTtlMs = negativeTtlMs;
+}
+
+long long UserCache::nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// 命中时把条目移到表头，过期的条目直接删除并按未命中处理
+UserCache::RESULT UserCache::get(const string& name, string* password) {
+    if (shardCapacity == 0) {
+        return MISS;
+    }
+    Shard& shard = shardOf(name);
+    shard.lock.lock();
+    auto it = shard.index.find(name);
+    if (it == shard.index.end()) {
+        shard.lock.unlock();
+        return MISS;
+    }
+    if (it->second->expireMs <= nowMs()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        shard.lock.unlock();
+        return MISS;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    RESULT result = ABSENT;
+    if (!it->second->absent) {
+        *password = it->second->password;
+        result = FOUND;
+    }
+    shard.lock.unlock();
+    return result;
+}
+
+void UserCache::put(const string& name, const string& password) {
+    insert(name, password, false);
+}
+
+void UserCache::putAbsent(const string& name) {
+    insert(name, "", true);
+}
+
+void UserCache::erase(const string& name) {
+    if (shardCapacity == 0) {
+        return;
+    }
+    Shard& shard = shardOf(name);
+    shard.lock.lock();
+    auto it = shard.index.find(name);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    shard.lock.unlock();
+}
+
+// 插入或更新条目并移到表头，分片满时淘汰表尾（最久未使用）的条目
+void UserCache::insert(const string& name, const string& password, bool absent) {
+    if (shardCapacity == 0) {
+        return;
+    }
+    long long expireMs = nowMs() + (absent ? negativeTtlMs : ttlMs);
+    Shard& shard = shardOf(name);
+    shard.lock.lock();
+    auto it = shard.index.find(name);
+    if (it != shard.index.end()) {
+        it->second->password = password;
+        it->second->absent = absent;
+        it->second->expireMs = expireMs;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    } else {
+        if (static_cast<int>(shard.lru.size()) >= shardCapacity) {
+            shard.index.erase(shard.lru.back().name);
+            shard.lru.pop_back();
+        }
+        shard.lru.push_front(Entry{name, password, absent, expireMs});
+        shard.index[name] = shard.lru.begin();
+    }
+    shard.lock.unlock();
+}
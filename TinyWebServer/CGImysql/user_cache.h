@@ -0,0 +1,69 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <time.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include "../lock/locker.h"
+
+using namespace std;
+
+// 数据库前的用户记录缓存，替代启动时把整张user表读进全局map的做法（用户多了内存和启动时间都撑不住）
+// 按用户名分片，每个分片一把锁、一条LRU链表，条目带过期时间，同时缓存查不到的用户名（负缓存）
+// 注册成功后直接写入缓存，注册失败时删除；负缓存的有效期较短，以免其他进程注册的用户长时间查不到
+class UserCache {
+public:
+    // 查找的结果
+    enum RESULT {
+        MISS = 0,   // 缓存中没有或已过期，需要查询数据库
+        FOUND,      // 用户存在
+        ABSENT      // 用户不存在
+    };
+
+    // 单例模式
+    static UserCache* getInstance() {
+        static UserCache instance;
+        return &instance;
+    }
+
+    // 设置总容量（条目数）和正、负缓存的有效期（毫秒），容量为0时不缓存
+    void init(int capacity, int ttlMs, int negativeTtlMs);
+
+    RESULT get(const string& name, string* password);  // 查找用户，存在时写入密码
+    void put(const string& name, const string& password);  // 记录存在的用户
+    void putAbsent(const string& name);  // 记录不存在的用户名
+    void erase(const string& name);  // 删除缓存，用于结果不确定的情况
+
+private:
+    UserCache();
+    ~UserCache() {}
+
+    static const int SHARD_NUM = 16;
+
+    struct Entry {
+        string name;
+        string password;
+        bool absent;
+        long long expireMs;
+    };
+
+    struct Shard {
+        Locker lock;
+        list<Entry> lru;    // 表头为最近使用的条目
+        unordered_map<string, list<Entry>::iterator> index;
+    };
+
+    Shard& shardOf(const string& name) {
+        return shards[hash<string>()(name) % SHARD_NUM];
+    }
+    void insert(const string& name, const string& password, bool absent);
+    static long long nowMs();
+
+    Shard shards[SHARD_NUM];
+    int shardCapacity;  // 每个分片的容量
+    int ttlMs;
+    int negativeTtlMs;
+};
+
+#endif
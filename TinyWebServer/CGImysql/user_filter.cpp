@@ -0,0 +1,161 @@
+#include <math.h>
+#include <stdlib.h>
+#include "user_filter.h"
+
+// 计数器个数 m = -n * ln(p) / (ln2)^2，哈希函数个数 k = m / n * ln2
+void UserFilter::init(ConnectionPool* connPool, int expectedUsers, double falsePositiveRate) {
+    this->connPool = connPool;
+    this->closeLog = connPool->closeLog;
+    if (expectedUsers < 1) {
+        expectedUsers = 1;
+    }
+    double m = -expectedUsers * log(falsePositiveRate) / (log(2.0) * log(2.0));
+    size = m < 64 ? 64 : static_cast<size_t>(m);
+    hashCount = static_cast<int>(round(m / expectedUsers * log(2.0)));
+    hashCount = hashCount < 1 ? 1 : (hashCount > 16 ? 16 : hashCount);
+    vector<atomic<unsigned char> > tmp(size);
+    counters.swap(tmp);
+    for (size_t i = 0; i < size; ++i) {
+        counters[i] = 0;
+    }
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, loadThread, this) != 0) {
+        LOG_ERROR("UserFilter create load thread error");
+        return;
+    }
+    pthread_detach(tid);
+}
+
+void* UserFilter::loadThread(void* arg) {
+    UserFilter* filter = (UserFilter*) arg;
+    filter->load();
+    return NULL;
+}
+
+// 按用户名做键集分页（username > last ORDER BY username），每批单独取一个连接
+void UserFilter::load() {
+    string last;
+    int total = 0;
+    bool checked = false;
+    while (true) {
+        MYSQL* mysql = NULL;
+        ConnectionRAII mysqlConn(&mysql, connPool);
+        if (mysql == NULL) {
+            return;
+        }
+        if (!checked) {
+            int hasKey = hasUniqueKey(mysql);
+            if (hasKey <= 0) {
+                LOG_ERROR("UserFilter: user.username has no UNIQUE index (%s), registration will always SELECT first",
+                          hasKey < 0 ? mysql_error(mysql) : "not found");
+                return;
+            }
+            checked = true;
+        }
+        char escaped[2 * 100 + 1];
+        mysql_real_escape_string(mysql, escaped, last.c_str(), last.size() < 100 ? last.size() : 100);
+        char sqlSelect[300];
+        snprintf(sqlSelect, sizeof(sqlSelect),
+                 "SELECT username FROM user WHERE username > '%s' ORDER BY username LIMIT %d", escaped, LOAD_BATCH);
+        if (mysql_query(mysql, sqlSelect)) {
+            LOG_ERROR("UserFilter SELECT error: %s\n", mysql_error(mysql));
+            return;
+        }
+        MYSQL_RES* result = mysql_store_result(mysql);
+        if (result == NULL) {
+            return;
+        }
+        int rows = 0;
+        while (MYSQL_ROW row = mysql_fetch_row(result)) {
+            last = row[0];
+            add(last);
+            ++rows;
+        }
+        mysql_free_result(result);
+        total += rows;
+        if (rows < LOAD_BATCH) {
+            break;
+        }
+    }
+    ready = true;
+    LOG_INFO("UserFilter loaded %d users", total);
+}
+
+// 找username是第一列且没有第二列的唯一索引
+int UserFilter::hasUniqueKey(MYSQL* mysql) {
+    const char* sqlCheck =
+        "SELECT COUNT(*) FROM information_schema.STATISTICS s"
+        " WHERE s.TABLE_SCHEMA = DATABASE() AND s.TABLE_NAME = 'user' AND s.COLUMN_NAME = 'username'"
+        " AND s.NON_UNIQUE = 0 AND s.SEQ_IN_INDEX = 1 AND NOT EXISTS (SELECT 1 FROM information_schema.STATISTICS t"
+        " WHERE t.TABLE_SCHEMA = s.TABLE_SCHEMA AND t.TABLE_NAME = s.TABLE_NAME AND t.INDEX_NAME = s.INDEX_NAME"
+        " AND t.SEQ_IN_INDEX = 2)";
+    if (mysql_query(mysql, sqlCheck)) {
+        return -1;
+    }
+    MYSQL_RES* result = mysql_store_result(mysql);
+    if (result == NULL) {
+        return -1;
+    }
+    MYSQL_ROW row = mysql_fetch_row(result);
+    int count = (row != NULL && row[0] != NULL) ? atoi(row[0]) : -1;
+    mysql_free_result(result);
+    return count > 0 ? 1 : count;
+}
+
+// 64位FNV-1a，再用splitmix64的混合步骤导出第二个哈希值，第i个位置取 (h1 + i * h2) % size
+void UserFilter::hash(const string& name, uint64_t& h1, uint64_t& h2) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < name.size(); ++i) {
+        h ^= (unsigned char) name[i];
+        h *= 1099511628211ULL;
+    }
+    uint64_t mix = h + 0x9e3779b97f4a7c15ULL;
+    mix = (mix ^ (mix >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    mix = (mix ^ (mix >> 27)) * 0x94d049bb133111ebULL;
+    mix ^= mix >> 31;
+    h1 = h;
+    h2 = mix | 1;
+}
+
+bool UserFilter::mayExist(const string& name) {
+    if (!ready || size == 0) {
+        return true;
+    }
+    uint64_t h1, h2;
+    hash(name, h1, h2);
+    for (int i = 0; i < hashCount; ++i) {
+        if (counters[(h1 + i * h2) % size] == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void UserFilter::add(const string& name) {
+    if (size == 0) {
+        return;
+    }
+    uint64_t h1, h2;
+    hash(name, h1, h2);
+    for (int i = 0; i < hashCount; ++i) {
+        atomic<unsigned char>& counter = counters[(h1 + i * h2) % size];
+        unsigned char count = counter;
+        while (count < 255 && !counter.compare_exchange_weak(count, count + 1)) {
+        }
+    }
+}
+
+void UserFilter::remove(const string& name) {
+    if (size == 0) {
+        return;
+    }
+    uint64_t h1, h2;
+    hash(name, h1, h2);
+    for (int i = 0; i < hashCount; ++i) {
+        atomic<unsigned char>& counter = counters[(h1 + i * h2) % size];
+        unsigned char count = counter;
+        while (count > 0 && count < 255 && !counter.compare_exchange_weak(count, count - 1)) {
+        }
+    }
+}
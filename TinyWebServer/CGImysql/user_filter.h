@@ -0,0 +1,53 @@
+#ifndef USER_FILTER_H
+#define USER_FILTER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "sql_connection_pool.h"
+
+using namespace std;
+
+// 已存在用户名的计数布隆过滤器，注册时判断用户名是否可用
+// 启动时由后台线程按用户名顺序分批读入user表（每批之间归还数据库连接），注册成功的用户名随时加入
+// 加载完成后判断为不存在的用户名一定不存在，注册时可以跳过SELECT；加载完成前mayExist总是返回true
+// 跳过SELECT后由唯一索引拒绝重复的用户名（MySQL按列的排序规则比较，默认不区分大小写，过滤器比较的是原始字节），
+// 所以加载前先检查user.username上有没有唯一索引，没有时不加载，注册总是先查询
+// 每个位置是一个8位计数器，支持删除，计数器用原子操作增减，加到255后不再变化
+class UserFilter {
+public:
+    // 单例模式
+    static UserFilter* getInstance() {
+        static UserFilter instance;
+        return &instance;
+    }
+
+    // 按预计用户数和误判率初始化，并启动加载线程，需在数据库连接池初始化之后调用
+    void init(ConnectionPool* connPool, int expectedUsers, double falsePositiveRate);
+
+    bool mayExist(const string& name);  // 用户名可能存在时返回true
+    void add(const string& name);   // 加入已存在的用户名
+    void remove(const string& name);    // 删除用户名
+
+private:
+    UserFilter(): connPool(NULL), closeLog(0), size(0), hashCount(0), ready(false) {}
+    ~UserFilter() {}
+
+    static const int LOAD_BATCH = 1000;
+
+    static void* loadThread(void* arg);    // 加载线程入口
+    void load();
+    int hasUniqueKey(MYSQL* mysql);  // user.username上是否有只含这一列的唯一索引，出错返回-1
+    void hash(const string& name, uint64_t& h1, uint64_t& h2);
+
+    ConnectionPool* connPool;
+    int closeLog;   // 日志开关，与连接池相同
+    vector<atomic<unsigned char> > counters;
+    size_t size;
+    int hashCount;
+    atomic<bool> ready;
+};
+
+#endif
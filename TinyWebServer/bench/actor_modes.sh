@@ -0,0 +1,60 @@
+#!/bin/bash
+# 比较TinyWebServer三种并发模式（-a 0 proactor，1 reactor，2 混合）在静态页面和登录混合负载下的吞吐和延迟
+# 负载由modernCppWebServer/bench/loadgen产生：GET /（judge.html）和POST /2CGISQL.cgi登录按STATIC:LOGIN的权重混合
+# 登录用户为bench0..bench99，数据库中没有这些用户时登录走失败页面，仍然要查询数据库
+#
+# 用法（在TinyWebServer目录下运行，服务器从./root读取页面）：
+#   bench/actor_modes.sh ./server ../modernCppWebServer/build/loadgen
+# 可用环境变量调整：PORT DURATION CONNS THREADS STATIC LOGIN TRIG
+
+SERVER=${1:-./server}
+LOADGEN=${2:-../modernCppWebServer/build/loadgen}
+PORT=${PORT:-9006}
+DURATION=${DURATION:-10}
+CONNS=${CONNS:-128}
+THREADS=${THREADS:-4}
+STATIC=${STATIC:-9}
+LOGIN=${LOGIN:-1}
+TRIG=${TRIG:-0}
+
+if [ ! -x "$SERVER" ] || [ ! -x "$LOADGEN" ]; then
+    echo "usage: $0 server_binary loadgen_binary" >&2
+    exit 1
+fi
+
+# 等待服务器开始监听
+wait_port() {
+    for i in $(seq 1 50); do
+        if (exec 3<>/dev/tcp/127.0.0.1/$PORT) 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+printf "%-9s %10s %8s %8s %8s %8s %8s\n" mode rps p50_us p99_us p999_us errors 5xx
+for mode in 0 1 2; do
+    case $mode in
+        0) name=proactor ;;
+        1) name=reactor ;;
+        2) name=hybrid ;;
+    esac
+    # 关闭日志，避免日志写入影响结果
+    "$SERVER" -p $PORT -a $mode -m $TRIG -c 1 > /dev/null 2>&1 &
+    pid=$!
+    if ! wait_port; then
+        echo "$name: server did not start" >&2
+        kill $pid 2>/dev/null
+        exit 1
+    fi
+    json=$("$LOADGEN" -P $PORT -c $CONNS -t $THREADS -d $DURATION -w 1 -u /:$STATIC \
+           -l $LOGIN -L /2CGISQL.cgi -U user -j | tail -1)
+    kill $pid
+    wait $pid 2>/dev/null
+    field() {
+        echo "$json" | sed -n "s/.*\"$1\":\([0-9.]*\).*/\1/p"
+    }
+    printf "%-9s %10s %8s %8s %8s %8s %8s\n" $name "$(field rps)" "$(field p50_us)" "$(field p99_us)" \
+           "$(field p999_us)" "$(field errors)" "$(field status_5xx)"
+done
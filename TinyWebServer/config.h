@@ -32,7 +32,7 @@ public:
     int threadNum;
     // 是否关闭日志
     int closeLog;
-    // 并发模式选择
+    // 并发模式选择，0为proactor，1为reactor，2为两者混合
     int actorModel;
 
 };
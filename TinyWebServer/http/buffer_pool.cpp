@@ -0,0 +1,52 @@
+#include "buffer_pool.h"
+
+BufferPool::~BufferPool() {
+    for (int i = 0; i < CLASS_NUM; ++i) {
+        for (size_t j = 0; j < lists[i].bufs.size(); ++j) {
+            delete[] lists[i].bufs[j];
+        }
+    }
+}
+
+// 能容纳size字节的最小等级
+int BufferPool::classOf(int size) {
+    int cls = 0;
+    int capacity = MIN_SIZE;
+    while (capacity < size) {
+        capacity <<= 1;
+        ++cls;
+    }
+    return cls;
+}
+
+char* BufferPool::acquire(int size, int* capacity) {
+    if (size > MAX_SIZE) {
+        return NULL;
+    }
+    int cls = classOf(size);
+    *capacity = MIN_SIZE << cls;
+    FreeList& list = lists[cls];
+    list.lock.lock();
+    if (!list.bufs.empty()) {
+        char* buf = list.bufs.back();
+        list.bufs.pop_back();
+        list.lock.unlock();
+        return buf;
+    }
+    list.lock.unlock();
+    return new char[*capacity];
+}
+
+void BufferPool::release(char* buf, int capacity) {
+    if (!buf) {
+        return;
+    }
+    FreeList& list = lists[classOf(capacity)];
+    list.lock.lock();
+    if ((int)list.bufs.size() * capacity < MAX_FREE_BYTES) {
+        list.bufs.push_back(buf);
+        buf = NULL;
+    }
+    list.lock.unlock();
+    delete[] buf;
+}
@@ -0,0 +1,45 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <vector>
+#include "../lock/locker.h"
+
+using namespace std;
+
+// 连接读写缓冲区的内存池，代替每个HttpConn对象中固定大小的数组
+// 缓冲区按2的幂分为MIN_SIZE到MAX_SIZE几个等级，每个等级一把锁、一个空闲栈
+// 连接只在有请求要处理时持有缓冲区，请求处理完就归还，内存随活跃连接数而不是最大文件描述符数增长
+class BufferPool {
+public:
+    static const int MIN_SIZE = 1024;       // 最小的缓冲区
+    static const int MAX_SIZE = 65536;      // 最大的缓冲区，请求报文超过这个大小时关闭连接
+
+    // 单例模式
+    static BufferPool* getInstance() {
+        static BufferPool instance;
+        return &instance;
+    }
+
+    // 申请至少size字节的缓冲区，实际大小写入capacity，size超过MAX_SIZE时返回NULL
+    char* acquire(int size, int* capacity);
+    // 归还缓冲区，capacity为申请时得到的大小，空闲栈已满时直接释放
+    void release(char* buf, int capacity);
+
+private:
+    BufferPool() {}
+    ~BufferPool();
+
+    static const int CLASS_NUM = 7;     // 1K, 2K, ..., 64K
+    static const int MAX_FREE_BYTES = 4 << 20;  // 每个等级最多缓存的空闲内存
+
+    struct FreeList {
+        Locker lock;
+        vector<char*> bufs;
+    };
+
+    static int classOf(int size);
+
+    FreeList lists[CLASS_NUM];
+};
+
+#endif
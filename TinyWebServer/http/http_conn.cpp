@@ -14,31 +14,34 @@ const char* error_404_form = "The requested file was not found on this server.\n
 const char* error_500_title = "Internal Error";
 const char* error_500_form = "There was an unusual problem serving the request file.\n";
 
-Locker lock;
-map<string, string> users;
 int HttpConn::userCount = 0;
 int HttpConn::epollfd = -1;
 
 // 循环读取客户数据，直到无数据可读或对方关闭连接
 // 非阻塞ET工作模式下，需要一次性将数据读完
+// 缓冲区总留一个字节，数据之后写'\0'；满了先扩大，达到最大大小仍读不完整个请求时返回false关闭连接
 bool HttpConn::readOnce() {
-    if (readIdx >= READ_BUFFER_SIZE) {
-        return false;
-    }
     int bytesRead = 0;
     //LT 读取数据
     if (trigMode == 0) {
+        if (readIdx + 1 >= readCap && !growReadBuf()) {
+            return false;
+        }
         // 从套接字接收数据存储在readBuf缓冲区
-        bytesRead = recv(sockfd, readBuf+readIdx, READ_BUFFER_SIZE-readIdx, 0);
-        readIdx += bytesRead;   // 修改读取字节数
+        bytesRead = recv(sockfd, readBuf+readIdx, readCap-1-readIdx, 0);
         if (bytesRead <= 0) {
             return false;
         }
+        readIdx += bytesRead;   // 修改读取字节数
+        readBuf[readIdx] = '\0';
         return true;
     } else {
         // ET 读数据
         while (true) {
-            bytesRead = recv(sockfd, readBuf+readIdx, READ_BUFFER_SIZE-readIdx, 0);
+            if (readIdx + 1 >= readCap && !growReadBuf()) {
+                return false;
+            }
+            bytesRead = recv(sockfd, readBuf+readIdx, readCap-1-readIdx, 0);
             if (bytesRead == -1) {
                 // 非阻塞ET模式下，需要一次性将数据读完
                 if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -48,11 +51,66 @@ bool HttpConn::readOnce() {
                 return false;
             }
             readIdx += bytesRead;
+            readBuf[readIdx] = '\0';
         }
         return true;
     }
 }
 
+// 第一次按READ_BUFFER_SIZE申请，之后每次扩大一倍
+// 请求行和请求头解析时url、version、host指向readBuf中，换缓冲区后按偏移平移到新的缓冲区
+bool HttpConn::growReadBuf() {
+    int newCap = 0;
+    char* newBuf = BufferPool::getInstance()->acquire(readCap == 0 ? READ_BUFFER_SIZE : readCap * 2, &newCap);
+    if (!newBuf) {
+        LOG_ERROR("request from fd %d is larger than %d bytes", sockfd, BufferPool::MAX_SIZE);
+        return false;
+    }
+    if (readBuf) {
+        memcpy(newBuf, readBuf, readIdx + 1);
+        char** ptrs[] = {&url, &version, &host, &str};
+        for (int i = 0; i < 4; ++i) {
+            if (*ptrs[i] >= readBuf && *ptrs[i] < readBuf + readCap) {
+                *ptrs[i] = newBuf + (*ptrs[i] - readBuf);
+            }
+        }
+        BufferPool::getInstance()->release(readBuf, readCap);
+    } else {
+        newBuf[0] = '\0';
+    }
+    readBuf = newBuf;
+    readCap = newCap;
+    return true;
+}
+
+// 扩大写缓冲区，已写入的响应报文拷到新的缓冲区
+bool HttpConn::growWriteBuf(int size) {
+    int newCap = writeCap == 0 ? WRITE_BUFFER_SIZE : writeCap * 2;
+    while (newCap < size) {
+        newCap *= 2;
+    }
+    char* newBuf = BufferPool::getInstance()->acquire(newCap, &newCap);
+    if (!newBuf) {
+        return false;
+    }
+    if (writeBuf) {
+        memcpy(newBuf, writeBuf, writeIdx);
+        BufferPool::getInstance()->release(writeBuf, writeCap);
+    }
+    writeBuf = newBuf;
+    writeCap = newCap;
+    return true;
+}
+
+void HttpConn::freeBuffers() {
+    BufferPool::getInstance()->release(readBuf, readCap);
+    readBuf = NULL;
+    readCap = 0;
+    BufferPool::getInstance()->release(writeBuf, writeCap);
+    writeBuf = NULL;
+    writeCap = 0;
+}
+
 // 对文件描述符设置非阻塞
 int setNonBlocking(int fd) {
     int oldOption = fcntl(fd, F_GETFL);
@@ -97,38 +155,43 @@ void modfd(int epollfd, int fd, int ev, int trigMode) {
     epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &event);
 }
 
-// 同步线程初始化数据库读取表
-void HttpConn::initMysqlResult(ConnectionPool *connPoll) {
-    // 先从连接池中取一个连接
-    MYSQL* mysql = NULL;
-    ConnectionRAII mysqlConn(&mysql, connPoll);
-
-    // 在user表中检索username， password数据，浏览器端输入
-    if (mysql_query(mysql, "SELECT username, passwd FROM user")) {
+// 从数据库查询用户的密码，用户存在返回1，不存在返回0，出错返回-1，查询结果写入用户缓存
+// 原来启动时把整张user表读进全局map，这里改为按需查询
+int HttpConn::queryPassword(const char* name, string& password) {
+    char escaped[2 * 100 + 1];
+    mysql_real_escape_string(mysql, escaped, name, strlen(name));
+    char sqlSelect[300];
+    snprintf(sqlSelect, sizeof(sqlSelect), "SELECT passwd FROM user WHERE username='%s' LIMIT 1", escaped);
+    if (mysql_query(mysql, sqlSelect)) {
         LOG_ERROR("SELECT error: %s\n", mysql_error(mysql));
+        return -1;
     }
-
-    // 从表中检索完整的结果集
     MYSQL_RES *result = mysql_store_result(mysql);
-    // 返回结果集中的列数
-    int numFields = mysql_num_fields(result);
-    // 返回所有字段结构的数组
-    MYSQL_FIELD* fields = mysql_fetch_field(result);
-    // 从结果集中获取下一行，将对应的用户名和密码，存入map中
-    while (MYSQL_ROW row = mysql_fetch_row(result)) {
-        string temp1(row[0]);
-        string temp2(row[1]);
-        users[temp1] = temp2;
+    if (result == NULL) {
+        return -1;
+    }
+    int found = 0;
+    if (MYSQL_ROW row = mysql_fetch_row(result)) {
+        password = row[0];
+        found = 1;
+        UserCache::getInstance()->put(name, password);
+    } else {
+        UserCache::getInstance()->putAbsent(name);
     }
+    mysql_free_result(result);
+    return found;
 }
 
 // 关闭连接，关闭一个连接，客户总量减一
 void HttpConn::closeConn(bool realClose) {
     if (realClose && (sockfd != -1)) {
         printf("close %d\n", sockfd);
-        removefd(epollfd, sockfd);
+        int fd = sockfd;
         sockfd = -1;
         --userCount;
+        // 先归还缓冲区再关闭套接字：关闭后主线程可能马上接受复用这个fd的新连接，在同一个对象上调用init
+        freeBuffers();
+        removefd(epollfd, fd);
     }
 }
 
@@ -152,8 +215,8 @@ void HttpConn::init(int sockfd, const sockaddr_in& addr, char* root, int trigMod
     init();
 }
 
-// 初始化新接受的连接
-// checkState默认为分析请求行状态
+// 初始化新接受的连接，长连接处理完一个请求后也调用
+// checkState默认为分析请求行状态，读写缓冲区归还内存池，空闲的连接不占用缓冲区
 void HttpConn::init() {
     mysql = NULL;
     bytesToSend = 0;
@@ -173,9 +236,10 @@ void HttpConn::init() {
     state = 0;
     timerFlag = 0;
     improve = 0;
+    inWorker = 0;
 
-    memset(readBuf, '\0', READ_BUFFER_SIZE);
-    memset(writeBuf, '\0', WRITE_BUFFER_SIZE);
+    str = 0;
+    freeBuffers();
     memset(realFile, '\0', FILENAME_LEN);
 }
 
@@ -417,33 +481,50 @@ HttpConn::HTTP_CODE HttpConn::doRequest() {
         }
         password[j] = '\0';
 
+        // 先查用户缓存，未命中时再查询数据库
+        string cachedPassword;
+        UserCache::RESULT cached = UserCache::getInstance()->get(name, &cachedPassword);
+        int found = cached == UserCache::FOUND ? 1 : 0;
+        bool needQuery = cached == UserCache::MISS;
+        if (needQuery && *(p+1) == '3' && !UserFilter::getInstance()->mayExist(name)) {
+            // 注册时布隆过滤器确定不存在的用户名不需要查询
+            needQuery = false;
+        }
+        if (needQuery) {
+            found = queryPassword(name, cachedPassword);
+        }
+
         if (*(p+1) == '3') {
             // 如果是注册，先检测数据库中是否有重名的
-            // 没有重名的，进行增加数据
-            char* sqlInsert = (char*) malloc(sizeof(char) * 200);
-            strcpy(sqlInsert, "INSERT INTO user(username, passwd) values(");
-            strcat(sqlInsert, "'");
-            strcat(sqlInsert, name);
-            strcat(sqlInsert, "', '");
-            strcat(sqlInsert, password);
-            strcat(sqlInsert, "')");
-
-            if (users.find(name) == users.end()) {
-                lock.lock();
-                int res = mysql_query(mysql, sqlInsert);
-                users.insert(pair<string, string>(name, password));
-                lock.unlock();
+            // 没有重名的，进行增加数据，缓存中确定不存在的用户名不需要再查询
+            if (found == 0) {
+                char escapedName[2 * 100 + 1];
+                char escapedPassword[2 * 100 + 1];
+                mysql_real_escape_string(mysql, escapedName, name, strlen(name));
+                mysql_real_escape_string(mysql, escapedPassword, password, strlen(password));
+                char sqlInsert[500];
+                snprintf(sqlInsert, sizeof(sqlInsert), "INSERT INTO user(username, passwd) values('%s', '%s')",
+                         escapedName, escapedPassword);
 
+                int res = mysql_query(mysql, sqlInsert);
+                // 插入失败多半是用户名已存在，两种情况都加入布隆过滤器
+                UserFilter::getInstance()->add(name);
                 if (!res) {
+                    // 注册成功后直接写入缓存
+                    UserCache::getInstance()->put(name, password);
                     strcpy(url, "/log.html");
                 } else {
+                    // 插入失败（如其他连接刚注册了同名用户）时删除缓存，下次重新查询
+                    UserCache::getInstance()->erase(name);
                     strcpy(url, "/registerError.html");
                 }
+            } else {
+                strcpy(url, "/registerError.html");
             }
         // 如果是登录，直接判断
         // 若浏览器端输入的用户名和密码在表中可以查找到，返回1，否则返回0
         } else if (*(p + 1) == '2') {
-            if (users.find(name) != users.end() && users[name] == password) {
+            if (found == 1 && cachedPassword == password) {
                 strcpy(url, "/welcome.html");
             } else {
                 strcpy(url, "/logError.html");
@@ -503,25 +584,32 @@ HttpConn::HTTP_CODE HttpConn::doRequest() {
 }
 
 bool HttpConn::addResponse(const char* format, ...) {
-    // 如果写入内容超出writeBuf大小则报错
-    if (writeIdx >= WRITE_BUFFER_SIZE) {
-        return false;
-    }
-    // 定义可变参数列表
-    va_list arg_list;
-    // 将变量arg_list初始化为传入参数
-    va_start(arg_list, format);
-    // 将数据format从可变参数写入缓冲区写，返回写入数组的长度
-    int len = vsnprintf(writeBuf + writeIdx, WRITE_BUFFER_SIZE - 1 - writeIdx, format, arg_list);
-    // 如果写入的数据长度超过缓冲区剩余空间，则报错
-    if (len >= (WRITE_BUFFER_SIZE - 1 - writeIdx)) {
-        va_end(arg_list);
-        return false;
+    while (true) {
+        int space = writeCap - writeIdx;
+        int len = -1;
+        if (space > 0) {
+            // 定义可变参数列表
+            va_list arg_list;
+            // 将变量arg_list初始化为传入参数
+            va_start(arg_list, format);
+            // 将数据format从可变参数写入缓冲区写，返回需要的长度
+            len = vsnprintf(writeBuf + writeIdx, space, format, arg_list);
+            // 清空可变参数列表
+            va_end(arg_list);
+            if (len < 0) {
+                return false;
+            }
+            if (len < space) {
+                // 更新writeIdx位置
+                writeIdx += len;
+                break;
+            }
+        }
+        // 剩余空间不够，扩大缓冲区后重新写入，超过最大大小时报错
+        if (!growWriteBuf(writeIdx + len + 1)) {
+            return false;
+        }
     }
-    // 更新writeIdx位置
-    writeIdx += len;
-    // 清空可变参数列表
-    va_end(arg_list);
 
     LOG_INFO("request:%s", writeBuf);
 
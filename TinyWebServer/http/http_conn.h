@@ -20,9 +20,13 @@
 #include <sys/wait.h>
 #include <sys/uio.h>
 #include <map>
+#include <atomic>
 
 #include "../lock/locker.h"
 #include "../CGImysql/sql_connection_pool.h"
+#include "../CGImysql/user_cache.h"
+#include "../CGImysql/user_filter.h"
+#include "buffer_pool.h"
 #include "../timer/lst_timer.h"
 #include "../log/log.h"
 
@@ -30,11 +34,12 @@
 class HttpConn {
 public:
     static const int FILENAME_LEN = 200;    // 读取文件名称realFile大小
-    static const int READ_BUFFER_SIZE = 2048;   // 设置读缓冲区大小
-    static const int WRITE_BUFFER_SIZE = 1024;  // 设置写缓存区大小
+    static const int READ_BUFFER_SIZE = 2048;   // 读缓冲区的初始大小，不够时成倍扩大，最大BufferPool::MAX_SIZE
+    static const int WRITE_BUFFER_SIZE = 1024;  // 写缓冲区的初始大小
 
-    int timerFlag;
-    int improve;
+    atomic<int> timerFlag;  // reactor模式下由工作线程设置，主线程读取
+    atomic<int> improve;    // reactor模式下工作线程处理完读写后置1，主线程等待它
+    atomic<int> inWorker;   // 交给线程池时置1，工作线程处理完后清0，期间定时器不能关闭连接、归还缓冲区
 
     static int epollfd;
     static int userCount;
@@ -76,8 +81,10 @@ public:
         LINE_OPEN
     };
 
-    HttpConn() {}
-    ~HttpConn() {}
+    HttpConn() : readBuf(NULL), readCap(0), writeBuf(NULL), writeCap(0) {}
+    ~HttpConn() {
+        freeBuffers();
+    }
     // 初始化套接字地址，函数内部会调用私有方法init
     void init(int sockfd, const sockaddr_in& addr, char*, int, int, string user, string password, string sqlName);
     void closeConn(bool realClose = true);  // 关闭http连接
@@ -87,16 +94,21 @@ public:
     sockaddr_in* getAddress() {
         return &address;
     }
-    void initMysqlResult(ConnectionPool *connPool); // 同步线程初始化数据库读取表
+    // 混合模式下判断已读入的请求是否要交给线程池：POST请求（登录和注册，要访问数据库）或超过初始读缓冲区的大请求
+    bool isHeavy() const {
+        return readIdx > READ_BUFFER_SIZE || (readIdx >= 4 && strncasecmp(readBuf, "POST", 4) == 0);
+    }
     
 private:
     int sockfd;
     sockaddr_in address;
-    char readBuf[READ_BUFFER_SIZE]; // 存储读取的请求报文数据
+    char* readBuf;  // 存储读取的请求报文数据，第一次读时从BufferPool申请，请求处理完后归还
+    int readCap;    // readBuf的大小
     int readIdx;    // 缓冲区中readBuf中数据的最后一个字节的下一个位置
     int checkedIdx; // readBuf读取的位置
     int startLine;  // readBuf中已经解析的字符个数
-    char writeBuf[WRITE_BUFFER_SIZE];   // 存储发出的响应报文数据
+    char* writeBuf;     // 存储发出的响应报文数据，生成响应时申请
+    int writeCap;       // writeBuf的大小
     int writeIdx;   // 知识buffer中的长度
     CHECK_STATE checkState; // 主状态机的状态
     METHOD method;  // 请求方法
@@ -118,7 +130,6 @@ private:
     int bytesHaveSend;  // 已经发送字节数
     char* docRoot;
 
-    map<string, string>users;
     int trigMode;
     int closeLog;
 
@@ -133,11 +144,15 @@ private:
     HTTP_CODE parseHeaders(char* text); // 主状态机解析报文中的请求头数据
     HTTP_CODE parseContent(char* text); // 主状态机解析报文中的请求内容
     HTTP_CODE doRequest();  // 生成响应报文
+    int queryPassword(const char* name, string& password);  // 从数据库查询用户的密码
     char* getLine() {
         return readBuf + startLine; // startLine是已经解析的字符
     }   // getLine用于将指针向后便宜，指向未处理的字符
     LINE_STATUS parseLine();    // 从状态机读取一行，分析是请求报文的哪一部分
     void unmap();
+    bool growReadBuf();     // 读缓冲区已满时扩大一倍，已解析出的指针随之平移
+    bool growWriteBuf(int size);    // 写缓冲区扩大到至少size字节
+    void freeBuffers();     // 把读写缓冲区归还BufferPool
     bool addResponse(const char* format, ...);  // 根据响应报文，生成对应8个部分，以下函数均有doRequest调用
     bool addContent(const char* content);
     bool addStatusLine(int status, const char* title);
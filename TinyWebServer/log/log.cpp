@@ -132,7 +132,13 @@ void Log::writeLog(int level, const char* format, ...) {
                      myTm.tm_hour, myTm.tm_min, myTm.tm_sec, now.tv_usec, s);
 
     // 内容格式化，用于向字符串中打印数据、数据格式用户自定义，返回写入到字符数组str中的字符个数（不包含终止符）
-    int m = vsnprintf(buf + n, logBufsize - 1, format, valst);
+    // 超长的内容（如很长的请求头）截断，留出换行符和结尾的null字符
+    int m = vsnprintf(buf + n, logBufsize - n - 1, format, valst);
+    if (m < 0) {
+        m = 0;
+    } else if (m > logBufsize - n - 2) {
+        m = logBufsize - n - 2;
+    }
     buf[n+m] = '\n';
     buf[n+m+1] = '\0';
 
@@ -16,6 +16,7 @@ public:
     ~ThreadPool();
     bool append(T* request, int state); // 向请求队列中插入任务请求
     bool appendP(T* request);   // 应该是弃用的版本
+    int size();     // 请求队列中等待处理的请求数
 
 private:
     // 工作线程运行的函数，它不断从工作队列中取出任务并执行
@@ -72,6 +73,7 @@ bool ThreadPool<T>::append(T* request, int state) {
         return false;
     }
     request->state = state;
+    request->inWorker = 1;
     // 添加任务
     workQueue.push_back(request);
     queueLocker.unlock();
@@ -88,12 +90,21 @@ bool ThreadPool<T>::appendP(T *request){
         queueLocker.unlock();
         return false;
     }
+    request->inWorker = 1;
     workQueue.push_back(request);
     queueLocker.unlock();
     queueStat.post();
     return true;
 }
 
+template <typename T>
+int ThreadPool<T>::size() {
+    queueLocker.lock();
+    int n = workQueue.size();
+    queueLocker.unlock();
+    return n;
+}
+
 template<typename T>
 void* ThreadPool<T>::worker(void* arg) {
     // 将参数强转为线程池类，调用成员方法
@@ -140,6 +151,8 @@ void ThreadPool<T>::run() {
             ConnectionRAII mysqlConn(&request->mysql, connPool);
             request->process();
         }
+        // 之后不再访问request的缓冲区，主线程的定时器可以关闭它了
+        request->inWorker = 0;
     }
 }
 
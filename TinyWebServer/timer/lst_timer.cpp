@@ -2,152 +2,138 @@
 #include "../http/http_conn.h"
 
 void cb_func(clientData* userData) {
-    // 删除非活动连接在socket上的注册事件
-    epoll_ctl(Utils::epollfd, EPOLL_CTL_DEL, userData->sockfd, 0);
     assert(userData);
-    // 关闭文件描述符
-    close(userData->sockfd);
-    // 减少连接数
-    HttpConn::userCount--;
+    // 通过closeConn关闭：删除socket上的注册事件，关闭文件描述符，减少连接数，
+    // 并把读写缓冲区归还BufferPool，否则超时或对端关闭的连接会一直占着缓冲区
+    // 连接已经关闭过时closeConn什么也不做，不会重复关闭同一个文件描述符
+    userData->conn->closeConn();
 }
 
-SortTimerLst::SortTimerLst() {
-    head = NULL;
-    tail = NULL;
-}
-
-SortTimerLst::~SortTimerLst() {
-    UtilTimer* tmp = head;
-    while (tmp) {
-        head = tmp->next;
-        delete tmp;
-        tmp = head;
+TimeWheel::TimeWheel() {
+    for (int i = 0; i < TIMER_SLOT_NUM; ++i) {
+        slots[i] = NULL;
     }
+    curSlot = 0;
+    curTime = nowMs();
+    count = 0;
 }
 
-// 添加定时器，内部调用私有成员add_timer
-void SortTimerLst::addTimer(UtilTimer* timer) {
-    if (!timer) {
-        return;
-    }
-    if (!head) {
-        head = tail = timer;
-        return;
-    }
-    // 如果新的定时器超时时间小于当前头部节点
-    // 直接将当前定时器节点作为头部节点
-    if (timer->expire < head->expire) {
-        timer->next = head;
-        head->prev = timer;
-        head = timer;
-        return;
-    }
-    // 否则调用私用成员，调整内部节点
-    addTimer(timer, head);
-}
-
-// 私有成员，被公有成员addTimer和adjustTimer调用
-// 主要用于调整链表内部节点
-void SortTimerLst::addTimer(UtilTimer* timer, UtilTimer* lstHead) {
-    UtilTimer* prev = lstHead;
-    UtilTimer* tmp = prev->next;
-    // 遍历当前节点之后的链表，按照超时时间找到目标定时器对应的位置，常规双向链表插入操作
-    while (tmp) {
-        if (timer->expire < tmp->expire) {
-            prev->next = timer;
-            timer->next = tmp;
-            tmp->prev = timer;
-            timer->prev = prev;
-            break;
+TimeWheel::~TimeWheel() {
+    for (int i = 0; i < TIMER_SLOT_NUM; ++i) {
+        UtilTimer* tmp = slots[i];
+        while (tmp) {
+            slots[i] = tmp->next;
+            delete tmp;
+            tmp = slots[i];
         }
-        prev = tmp;
-        tmp = tmp->next;
-    }
-    // 遍历完发现，目标定时器需要放到尾节点处
-    if (!tmp) {
-        prev->next = timer;
-        timer->prev = prev;
-        timer->next = NULL;
-        tail = timer;
     }
 }
 
-// 调整定时器，任务发生变化时，调整定时器在链表中的位置
-void SortTimerLst::adjustTimer(UtilTimer* timer) {
-    if (!timer) {
-        return;
-    }
-    UtilTimer* tmp = timer->next;
-    // 被调整的定时器在链表尾部
-    // 定时器超时值仍然小于下一个定时器超时值，不调整
-    if (!tmp || (timer->expire < tmp->expire)) {
-        return;
-    }
-    // 被调整定时器是链表头结点，将定时器取出，重新插入
-    if (timer == head) {
-        head = head->next;
-        head->prev = NULL;
-        timer->next = NULL;
-        addTimer(timer, head);
-    } else {
-        //被调整定时器在内部，将定时器取出，重新插入
+long long TimeWheel::nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+long long TimeWheel::nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 根据超时时间算出还要走多少格，得到槽和圈数，插入槽的链表头部
+void TimeWheel::link(UtilTimer* timer) {
+    long long ticks = (timer->expire - curTime + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    // 至少下一格才处理
+    if (ticks < 1) {
+        ticks = 1;
+    }
+    timer->rotation = (ticks - 1) / TIMER_SLOT_NUM;
+    timer->slot = (curSlot + ticks) % TIMER_SLOT_NUM;
+    timer->prev = NULL;
+    timer->next = slots[timer->slot];
+    if (slots[timer->slot]) {
+        slots[timer->slot]->prev = timer;
+    }
+    slots[timer->slot] = timer;
+}
+
+// 从所在槽的链表中取下
+void TimeWheel::unlink(UtilTimer* timer) {
+    if (timer->prev) {
         timer->prev->next = timer->next;
+    } else {
+        slots[timer->slot] = timer->next;
+    }
+    if (timer->next) {
         timer->next->prev = timer->prev;
-        addTimer(timer, timer->next);
     }
+    timer->prev = NULL;
+    timer->next = NULL;
 }
 
-void SortTimerLst::delTimer(UtilTimer* timer) {
+// 添加定时器
+void TimeWheel::addTimer(UtilTimer* timer) {
     if (!timer) {
         return;
     }
-    if ((timer == head) && (timer == tail)) {
-        delete timer;
-        head = NULL;
-        tail = NULL;
-        return;
+    // 时间轮为空时不会被推进，把当前时间对齐到现在，避免下次推进时空转经过的格
+    if (count == 0) {
+        curTime = nowMs();
     }
-    if (timer == head) {
-        head = head->next;
-        head->prev = NULL;
-        delete timer;
+    link(timer);
+    ++count;
+}
+
+// 调整定时器，任务发生变化时，调整定时器所在的槽
+void TimeWheel::adjustTimer(UtilTimer* timer) {
+    if (!timer) {
         return;
     }
-    if (timer == tail) {
-        tail = tail->prev;
-        tail->next = NULL;
-        delete timer;
+    unlink(timer);
+    link(timer);
+}
+
+void TimeWheel::delTimer(UtilTimer* timer) {
+    if (!timer) {
         return;
     }
-    timer->prev->next = timer->next;
-    timer->next->prev = timer->prev;
+    unlink(timer);
+    --count;
+    timer->userData->timer = NULL;
     delete timer;
 }
 
 // 定时任务处理函数
-void SortTimerLst::tick() {
-    if (!head) {
-        return;
-    }
-    // 获取当前时间
-    time_t cur = time(NULL);
-    UtilTimer* tmp = head;
-    // 遍历定时器链表
-    while (tmp) {
-        // 链表容器为升序排列
-        // 当前时间小于定时器的超过时间，后面的定时器也没有到期
-        if (cur < tmp->expire) {
-            break;
+void TimeWheel::tick() {
+    long long cur = nowMs();
+    // 事件循环处理得慢时一次可能要走多格
+    while (count > 0 && curTime + TIMER_TICK_MS <= cur) {
+        curTime += TIMER_TICK_MS;
+        curSlot = (curSlot + 1) % TIMER_SLOT_NUM;
+        UtilTimer* tmp = slots[curSlot];
+        while (tmp) {
+            UtilTimer* next = tmp->next;
+            // 还没转够圈数，本轮不到期
+            if (tmp->rotation > 0) {
+                --tmp->rotation;
+            } else if (tmp->userData->conn->inWorker) {
+                // 请求还在线程池中（排队或者等数据库连接），工作线程还在用连接的缓冲区，
+                // 这时关闭会把缓冲区归还BufferPool，工作线程回来就访问到别人的缓冲区。
+                // 推迟到下一格再检查，工作线程处理完后由下次读写事件或者到期处理
+                unlink(tmp);
+                tmp->expire = cur + TIMER_TICK_MS;
+                link(tmp);
+            } else {
+                // 当前定时器到期，则调用回调函数，执行定时事件，再从槽中删除
+                unlink(tmp);
+                --count;
+                tmp->cb_func(tmp->userData);
+                tmp->userData->timer = NULL;
+                delete tmp;
+            }
+            tmp = next;
         }
-        // 当前定时器到期，则调用回调函数，执行定时事件
-        tmp->cb_func(tmp->userData);
-        // 将处理后的定时器从来链表容器中删除，并重置头结点
-        head = tmp->next;
-        if (head) {
-            head->prev = NULL;
-        }
-        delete tmp;
-        tmp = head;
     }
 }
 
@@ -180,15 +166,6 @@ void Utils::addfd(int epollfd, int fd, bool one_shot, int trigMode) {
     
 }
 
-// 信号处理函数
-void Utils::sigHandle(int sig) {
-    // 为保证函数的可重入性，保留原来的errno
-    int save_errno = errno;
-    int msg = sig;
-    send(pipefd[1], (char*)&msg, 1, 0);
-    errno = save_errno;
-}
-
 // 设置信号函数
 void Utils::addSig(int sig, void(handler)(int), bool restart) {
     struct sigaction sa;
@@ -201,10 +178,40 @@ void Utils::addSig(int sig, void(handler)(int), bool restart) {
     assert(sigaction(sig, &sa, NULL) != -1);
 }
 
-// 定时处理任务，重新定时以不断触发SIGALRM信号
+// 在所有线程中屏蔽信号，改由signalfd读取，需在创建任何线程之前调用
+void Utils::blockSig(int sig) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, sig);
+    int ret = pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    assert(ret == 0);
+}
+
+// 有定时器时启动timerfd，每TIMER_TICK_MS触发一次，已启动时不做任何事
+void Utils::startTick() {
+    if (timerArmed) {
+        return;
+    }
+    struct itimerspec spec;
+    spec.it_value.tv_sec = 0;
+    spec.it_value.tv_nsec = TIMER_TICK_MS * 1000000L;
+    spec.it_interval = spec.it_value;
+    timerfd_settime(timerfd, 0, &spec, NULL);
+    timerArmed = true;
+}
+
+// 读出超时次数，推进时间轮；定时器都删除后停止timerfd，空闲时不再被唤醒
 void Utils::timerHandler() {
-    timerLst.tick();
-    alarm(timeSlot);
+    uint64_t expirations;
+    while (read(timerfd, &expirations, sizeof(expirations)) > 0) {
+    }
+    timeWheel.tick();
+    if (timeWheel.size() == 0 && timerArmed) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        timerfd_settime(timerfd, 0, &spec, NULL);
+        timerArmed = false;
+    }
 }
 
 void Utils::showError(int connfd, const char* info) {
@@ -212,5 +219,4 @@ void Utils::showError(int connfd, const char* info) {
     close(connfd);
 }
 
-int *Utils::pipefd = 0;
 int Utils::epollfd = 0;
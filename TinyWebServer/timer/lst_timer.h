@@ -21,52 +21,75 @@
 #include <sys/wait.h>
 #include <sys/uio.h>
 #include <time.h>
+#include <sys/timerfd.h>
 // #include "../log/log.h"
 
 // 连接资源结构体成员需要用到定时器类
 // 需要前向声明
 class UtilTimer;
+class HttpConn;
 
 struct clientData {
     sockaddr_in address;  // 客户端socket地址
     int sockfd;     // socket文件描述符
     UtilTimer* timer;   // 定时器
+    HttpConn* conn;     // 对应的http连接，超时关闭时归还它的读写缓冲区
 };
 
+const int TIMER_TICK_MS = 10;       // 时间轮每格的时长，超时精度
+const int TIMER_SLOT_NUM = 4096;    // 时间轮的槽数，转一圈约41秒，长于默认的15秒超时，多数定时器不需要转圈
+
 // 定时器类
 class UtilTimer {
 public:
-    UtilTimer() : prev(NULL), next(NULL) {
+    UtilTimer() : prev(NULL), next(NULL), rotation(0), slot(-1) {
 
     }
 
-    time_t expire;  // 超过时间
+    long long expire;  // 超时时间，单调时钟的毫秒数
     void (*cb_func)(clientData*);   // 回调函数
     clientData* userData;   // 连接资源
-    UtilTimer* prev;    // 前向定时器
-    UtilTimer* next;    // 后继定时器
+    UtilTimer* prev;    // 同一槽中的前向定时器
+    UtilTimer* next;    // 同一槽中的后继定时器
+    int rotation;   // 还要转多少圈才到期
+    int slot;       // 所在的槽
 };
 
-class SortTimerLst {
+// 时间轮，代替按超时时间排序的链表
+// 每个槽是一个双向链表，定时器按超时时间挂到对应的槽上，添加、调整、删除都是O(1)
+// 每格只检查当前槽中的定时器，没转够圈数的减一圈
+class TimeWheel {
 public:
-    SortTimerLst();
-    ~SortTimerLst();
+    TimeWheel();
+    ~TimeWheel();
 
     void addTimer(UtilTimer* timer);
+    // 定时器的超时时间改变后，移到新的槽上
     void adjustTimer(UtilTimer* timer);
     void delTimer(UtilTimer* timer);
+    // 推进到当前时间，处理经过的各槽中到期的定时器
     void tick();
+    int size() const {
+        return count;
+    }
+
+    // 单调时钟的毫秒数，不受系统时间调整的影响
+    static long long nowMs();
+    static long long nowUs();
 
 private:
-    void addTimer(UtilTimer* timer, UtilTimer* lstHead);
+    void link(UtilTimer* timer);
+    void unlink(UtilTimer* timer);
 
-    UtilTimer* head;
-    UtilTimer* tail;
+    UtilTimer* slots[TIMER_SLOT_NUM];
+    int curSlot;        // 当前槽
+    long long curTime;  // 当前槽对应的时间
+    int count;          // 定时器个数
 };
 
 class Utils {
 public:
-    Utils() {}
+    Utils() : timerfd(-1), timerArmed(false) {}
     ~Utils() {}
 
     void init(int timeslot);
@@ -74,19 +97,22 @@ public:
     int setnonblocking(int fd);
     // 将内核事件表注册读事件，ET模式，选择开启EPOLLONESHOT
     void addfd(int epollfd, int fd, bool oneShot, int trigMode);
-    // 信号处理函数
-    static void sigHandle(int sig);
     // 设置信号函数
     void addSig(int sig, void(handler)(int), bool restart=true);
-    // 定时处理任务，重新定时以不断触发SIGALRM信号
+    // 在所有线程中屏蔽信号，改由signalfd读取，需在创建任何线程之前调用
+    static void blockSig(int sig);
+    // 有定时器时启动timerfd，每TIMER_TICK_MS触发一次，已启动时不做任何事
+    void startTick();
+    // timerfd可读时调用，推进时间轮，没有定时器后停止timerfd
     void timerHandler();
 
     void showError(int connfd, const char* info);
 
-    static int* pipefd;
-    SortTimerLst timerLst;
+    TimeWheel timeWheel;
     static int epollfd;
     int timeSlot;
+    int timerfd;        // 驱动时间轮的timerfd，注册在epoll中
+    bool timerArmed;    // timerfd是否在计时
 
 };
 
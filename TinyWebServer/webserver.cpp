@@ -1,8 +1,24 @@
 #include "webserver.h"
 
 WebServer::WebServer() {
-    // HttpConn类对象
-    users = new HttpConn[MAX_FD];
+    // 描述符上限取RLIMIT_NOFILE，先把软限制提高到硬限制（默认的软限制通常只有1024）
+    maxFd = MAX_FD;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        if (limit.rlim_cur < limit.rlim_max) {
+            rlim_t oldCur = limit.rlim_cur;
+            limit.rlim_cur = limit.rlim_max;
+            if (setrlimit(RLIMIT_NOFILE, &limit) < 0) {
+                limit.rlim_cur = oldCur;
+            }
+        }
+        if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < (rlim_t)MAX_FD) {
+            maxFd = limit.rlim_cur;
+        }
+    }
+
+    // HttpConn类对象，只分配指针表，对象在该描述符第一次接受连接时创建，之后复用
+    users = new HttpConn*[maxFd]();
 
     // root文件夹路径
     char serverPath[200];
@@ -13,14 +29,20 @@ WebServer::WebServer() {
     strcat(this->root, root);
 
     // 定时器
-    usersTimer = new clientData[MAX_FD];
+    usersTimer = new clientData[maxFd];
+
+    inlineCostUs = 0;
+    probeCount = 0;
 }
 
 WebServer::~WebServer() {
     close(epollfd);
     close(listenFd);
-    close(pipefd[1]);
-    close(pipefd[0]);
+    close(utils.timerfd);
+    close(sigfd);
+    for (int i = 0; i < maxFd; ++i) {
+        delete users[i];
+    }
     delete[] users;
     delete[] usersTimer;    // 关闭定时器！
     delete[] pool;
@@ -40,7 +62,10 @@ void WebServer::init(int port, string user, string password, string databaseName
     this->optLinger = optLinger;
     this->trigMode = trigMode;
     this->closeLog = closeLog;
-    actorMode = actorMode;
+    this->actorModel = actorMode;
+
+    // SIGTERM在所有线程中屏蔽，由主线程通过signalfd读取，需在日志、数据库、线程池创建线程之前
+    Utils::blockSig(SIGTERM);
 
 }
 
@@ -80,8 +105,10 @@ void WebServer::sqlPool() {
     connPool = ConnectionPool::getInstance();
     connPool->init("localhost", user, passWord, databaseName, 3306, sqlNum, closeLog);
 
-    // 初始化数据库读取表
-    users->initMysqlResult(connPool);
+    // 初始化用户缓存，登录和注册时按需查询数据库，不再在启动时读取整张表
+    UserCache::getInstance()->init(USER_CACHE_CAPACITY, USER_CACHE_TTL_MS, USER_CACHE_NEGATIVE_TTL_MS);
+    // 后台加载已有用户名的布隆过滤器，注册新用户名时跳过查询
+    UserFilter::getInstance()->init(connPool, USER_FILTER_CAPACITY, 0.01);
 }
 
 void WebServer::threadPool() {
@@ -127,46 +154,51 @@ void WebServer::eventListen() {
     utils.addfd(epollfd, listenFd, false, listenTrigMode);
     HttpConn::epollfd = epollfd;
 
-    ret = socketpair(PF_UNIX, SOCK_STREAM, 0, pipefd);
-    assert(ret != -1);
-    utils.setnonblocking(pipefd[1]);
-    utils.addfd(epollfd, pipefd[0], false, 0);
+    // 定时器由timerfd驱动，不再用SIGALRM和管道，信号不会打断各线程的系统调用
+    utils.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    assert(utils.timerfd != -1);
+    utils.addfd(epollfd, utils.timerfd, false, 0);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    assert(sigfd != -1);
+    utils.addfd(epollfd, sigfd, false, 0);
 
     utils.addSig(SIGPIPE, SIG_IGN);
-    utils.addSig(SIGALRM, utils.sigHandle, false);
-    utils.addSig(SIGTERM, utils.sigHandle, false);
 
-    alarm(TIMESLOT);
-    
     // 工具类，信号和描述符基础操作
-    Utils::pipefd = pipefd;
     Utils::epollfd = epollfd;
 
 }
 
 void WebServer::timer(int connfd, struct sockaddr_in clientAddress) {
-    users[connfd].init(connfd, clientAddress, root, connTrigMode, closeLog, user, passWord, databaseName);
+    if (!users[connfd]) {
+        users[connfd] = new HttpConn;
+    }
+    users[connfd]->init(connfd, clientAddress, root, connTrigMode, closeLog, user, passWord, databaseName);
 
     // 初始化clientData数据
     // 创建定时器，设置回调函数和超时时间，绑定用户数据，将定时器添加到链表中
     usersTimer[connfd].address = clientAddress;
     usersTimer[connfd].sockfd = connfd;
+    usersTimer[connfd].conn = users[connfd];
     UtilTimer* timer = new UtilTimer;
     timer->userData = &usersTimer[connfd];
     timer->cb_func = cb_func;
-    time_t cur = time(NULL);
-    timer->expire = cur + 3 * TIMESLOT;
+    timer->expire = TimeWheel::nowMs() + 3 * TIMESLOT * 1000;
     usersTimer[connfd].timer = timer;
-    utils.timerLst.addTimer(timer);
+    utils.timeWheel.addTimer(timer);
+    utils.startTick();
 
 }
 
 // 若有数据传输，则将定时器往后延迟3个单位
 // 并对新的定时器在链表上的位置进行跳转
 void WebServer::adjustTimer(UtilTimer* timer) {
-    time_t cur = time(NULL);
-    utils.timerLst.adjustTimer(timer);
-    utils.timerLst.adjustTimer(timer);
+    timer->expire = TimeWheel::nowMs() + 3 * TIMESLOT * 1000;
+    utils.timeWheel.adjustTimer(timer);
 
     LOG_INFO("%s", "adjust timer once");
 }
@@ -174,7 +206,7 @@ void WebServer::adjustTimer(UtilTimer* timer) {
 void WebServer::dealTimer(UtilTimer* timer, int sockfd) {
     timer->cb_func(&usersTimer[sockfd]);
     if (timer) {
-        utils.timerLst.delTimer(timer);
+        utils.timeWheel.delTimer(timer);
     }
 
     LOG_INFO("close fd %d", usersTimer[sockfd].sockfd);
@@ -189,7 +221,7 @@ bool WebServer::dealClinetData() {
             LOG_ERROR("%s:errno is :%d", "accept error", error);
             return false;
         }
-        if (HttpConn::userCount >= MAX_FD) {
+        if (connfd >= maxFd) {
             utils.showError(connfd, "Internal server busy");
             LOG_ERROR("%s", "Internal server busy");
             return false;
@@ -202,7 +234,7 @@ bool WebServer::dealClinetData() {
                 LOG_ERROR("%s:errno is %d", "accept error", errno);
                 break;
             }
-            if (HttpConn::userCount >= MAX_FD) {
+            if (connfd >= maxFd) {
                 utils.showError(connfd, "Internal server busy");
                 LOG_ERROR("%s", "Internal server busy");
                 break;
@@ -214,27 +246,14 @@ bool WebServer::dealClinetData() {
     return true;
 }
 
-bool WebServer::dealWithSignal(bool &timeout, bool& stopServer) {
-    int ret = 0;
-    char signals[1024];
-    ret = recv(pipefd[0], signals, sizeof(signals), 0);
-    if (ret == -1) {
-        return false;
-    } else if (ret == 0) {
+bool WebServer::dealWithSignal(bool& stopServer) {
+    struct signalfd_siginfo info;
+    ssize_t ret = read(sigfd, &info, sizeof(info));
+    if (ret != sizeof(info)) {
         return false;
-    } else {
-        for (int i = 0; i < ret; ++i) {
-            switch (signals[i]) {
-                case SIGALRM: {
-                    timeout = true;
-                    break;
-                }
-                case SIGTERM: {
-                    stopServer = true;
-                    break;
-                }
-            }
-        }
+    }
+    if (info.ssi_signo == SIGTERM) {
+        stopServer = true;
     }
     return true;
 }
@@ -247,23 +266,38 @@ void WebServer::dealWithRead(int sockfd) {
             adjustTimer(timer);
         }
         // 若监测到读事件，将该事件放入请求队列
-        pool->append(users + sockfd, 0);
+        pool->append(users[sockfd], 0);
         while (true) {
-            if (users[sockfd].improve == 1) {
-                if (users[sockfd].timerFlag == 1) {
+            if (users[sockfd]->improve == 1) {
+                if (users[sockfd]->timerFlag == 1) {
                     dealTimer(timer, sockfd);
-                    users[sockfd].timerFlag = 0;
+                    users[sockfd]->timerFlag = 0;
                 }
-                users[sockfd].improve = 0;
+                users[sockfd]->improve = 0;
                 break;
             }
         }
+    } else if (actorModel == 2) {
+        // 混合模式：主线程读取，小的静态请求直接在主线程处理，登录注册和大请求交给线程池
+        if (users[sockfd]->readOnce()) {
+            LOG_INFO("deal with the client(%s)", inet_ntoa(users[sockfd]->getAddress()->sin_addr));
+            if (timer) {
+                adjustTimer(timer);
+            }
+            if (shouldOffload(users[sockfd])) {
+                pool->appendP(users[sockfd]);
+            } else {
+                processInline(users[sockfd]);
+            }
+        } else {
+            dealTimer(timer, sockfd);
+        }
     } else {
         // proactor
-        if (users[sockfd].readOnce()) {
-            LOG_INFO("deal with the client(%s)", inet_ntoa(users[sockfd].getAddress()->sin_addr));
+        if (users[sockfd]->readOnce()) {
+            LOG_INFO("deal with the client(%s)", inet_ntoa(users[sockfd]->getAddress()->sin_addr));
             // 若监测到读事件，将该事件放入请求队列
-            pool->appendP(users + sockfd);
+            pool->appendP(users[sockfd]);
             if (timer) {
                 adjustTimer(timer);
             }
@@ -273,6 +307,31 @@ void WebServer::dealWithRead(int sockfd) {
     }
 }
 
+// 混合模式下决定请求交给线程池还是在主线程处理
+// 要访问数据库的请求会阻塞事件循环，总是交给线程池；线程池积压时静态请求在主线程处理更快，
+// 否则按主线程处理静态请求的实测耗时决定（如文件不在页缓存中时stat和mmap变慢）
+bool WebServer::shouldOffload(HttpConn* conn) {
+    if (conn->isHeavy()) {
+        return true;
+    }
+    if (inlineCostUs <= HYBRID_INLINE_COST_US || pool->size() >= threadNum) {
+        return false;
+    }
+    // 定期在主线程处理一个，避免耗时降下来后一直转交线程池
+    if (++probeCount >= HYBRID_PROBE_INTERVAL) {
+        probeCount = 0;
+        return false;
+    }
+    return true;
+}
+
+// 在主线程解析请求、生成响应，记录耗时；响应在EPOLLOUT事件中由主线程发送，和proactor模式相同
+void WebServer::processInline(HttpConn* conn) {
+    long long start = TimeWheel::nowUs();
+    conn->process();
+    inlineCostUs += (TimeWheel::nowUs() - start - inlineCostUs) / 8;
+}
+
 void WebServer::dealWithWrite(int sockfd) {
     UtilTimer* timer = usersTimer[sockfd].timer;
     // rector
@@ -280,21 +339,21 @@ void WebServer::dealWithWrite(int sockfd) {
         if (timer) {
             adjustTimer(timer);
         }
-        pool->append(users + sockfd, 1);
+        pool->append(users[sockfd], 1);
         while (true) {
-            if (users[sockfd].improve) {
-                if (users[sockfd].timerFlag) {
+            if (users[sockfd]->improve) {
+                if (users[sockfd]->timerFlag) {
                     dealTimer(timer, sockfd);
-                    users[sockfd].timerFlag = 0;
+                    users[sockfd]->timerFlag = 0;
                 }
-                users[sockfd].improve = 0;
+                users[sockfd]->improve = 0;
                 break;
             }
         }
     } else {
         // proactor
-        if (users[sockfd].write()) {
-            LOG_INFO("send data to the client(%s)", inet_ntoa(users[sockfd].getAddress()->sin_addr));
+        if (users[sockfd]->write()) {
+            LOG_INFO("send data to the client(%s)", inet_ntoa(users[sockfd]->getAddress()->sin_addr));
             if (timer) {
                 adjustTimer(timer);
             }
@@ -305,7 +364,6 @@ void WebServer::dealWithWrite(int sockfd) {
 }
 
 void WebServer::eventLoop() {
-    bool timeout = false;
     bool stopServer = false;
 
     while (!stopServer) {
@@ -327,9 +385,12 @@ void WebServer::eventLoop() {
                 // 服务器关闭连接，移除对应的定时器
                 UtilTimer* timer = usersTimer[sockfd].timer;
                 dealTimer(timer, sockfd);
-            } else if ((sockfd == pipefd[0]) && (events[i].events & EPOLLIN)) {
+            } else if (sockfd == utils.timerfd) {
+                // 定时器到期，推进时间轮
+                utils.timerHandler();
+            } else if ((sockfd == sigfd) && (events[i].events & EPOLLIN)) {
                 // 处理信号
-                bool flag = dealWithSignal(timeout, stopServer);
+                bool flag = dealWithSignal(stopServer);
                 if (flag == false) {
                     LOG_ERROR("%s", "deal client data failure");// 日志！！
                 }
@@ -339,13 +400,6 @@ void WebServer::eventLoop() {
                 dealWithWrite(sockfd);
             }
         }
-        if (timeout) {
-            // 超时处理
-            utils.timerHandler();
-            LOG_INFO("%s", "timer tick");
-
-            timeout = false;
-        }
     }
 
 }
\ No newline at end of file
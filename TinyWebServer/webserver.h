@@ -11,6 +11,9 @@
 #include <stdlib.h>
 #include <cassert>
 #include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
 #include <mysql/mysql.h>
 
 #include "./threadpool/threadpool.h"
@@ -18,9 +21,15 @@
 #include "./timer/lst_timer.h"
 #include "./log/log.h"
 
-const int MAX_FD = 65536;   // 最大文件描述符
+const int MAX_FD = 1 << 20; // 最大文件描述符，实际上限还受RLIMIT_NOFILE限制
 const int MAX_EVENT_NUMBER = 10000; // 最大事件数
-const int TIMESLOT = 5;     // 最小超时单位
+const int TIMESLOT = 5;     // 最小超时单位，连接空闲3个单位后关闭
+const int USER_CACHE_CAPACITY = 100000;  // 用户缓存的条目数
+const int USER_CACHE_TTL_MS = 300000;    // 存在的用户的缓存有效期
+const int USER_CACHE_NEGATIVE_TTL_MS = 10000; // 不存在的用户名的缓存有效期
+const int USER_FILTER_CAPACITY = 1 << 20;   // 用户名布隆过滤器按此用户数设计
+const int HYBRID_INLINE_COST_US = 200;  // 混合模式下，在主线程处理静态请求的平均耗时超过这个值时转交线程池
+const int HYBRID_PROBE_INTERVAL = 32;   // 转交线程池期间，每隔这么多个静态请求仍在主线程处理一个，重新测量耗时
 
 class WebServer {
 public:
@@ -41,9 +50,11 @@ public:
     void adjustTimer(UtilTimer* timer);
     void dealTimer(UtilTimer* timer, int sockfd);
     bool dealClinetData();
-    bool dealWithSignal(bool& timeout, bool& stopServer);
+    bool dealWithSignal(bool& stopServer);
     void dealWithRead(int sockfd);
     void dealWithWrite(int sockfd);
+    bool shouldOffload(HttpConn* conn);
+    void processInline(HttpConn* conn);
 
     // 基础
     int port;
@@ -52,9 +63,10 @@ public:
     int closeLog;
     int actorModel;
 
-    int pipefd[2];
+    int sigfd;      // 读取SIGTERM的signalfd
     int epollfd;
-    HttpConn* users;
+    int maxFd;      // users和usersTimer的大小，不小于它的描述符直接拒绝
+    HttpConn** users;   // 按文件描述符索引，第一次用到时才创建HttpConn对象
 
     // 数据库相关
     ConnectionPool* connPool;
@@ -67,6 +79,10 @@ public:
     ThreadPool<HttpConn>* pool;
     int threadNum;
 
+    // 混合模式相关，只在主线程中访问
+    double inlineCostUs;    // 主线程处理静态请求耗时的指数移动平均
+    int probeCount;         // 转交线程池以来的静态请求数
+
     // epoll_event相关
     epoll_event events[MAX_EVENT_NUMBER];
 
@@ -0,0 +1,711 @@
+//
+// Created by lhm on 2026/10/19.
+//
+// 空闲长连接的容量测试（C100K）：建立并保持大量空闲的长连接，每个连接每隔几秒发一个请求，
+// 对比建立空闲连接前后服务器的内存占用、活跃请求的延迟，以及（服务器开启/metrics时）主线程上
+// HeapTimer::GetNextTick和处理一批就绪事件的耗时
+// 单个源地址到同一个服务器端口最多只有本地端口范围（约2.8万）个连接，空闲连接轮流绑定127.0.0.2开始的多个回环地址
+//
+// 流程：基线压测 -> 按速率建立空闲连接 -> 稳定几秒 -> 空闲连接存在时再压测一次 -> 输出对比
+// 进程和服务器都需要足够的描述符：ulimit -n不小于连接数加上余量，服务器端同样，超过1024时先提高硬限制
+// 每个源地址上的请求很多，modernCppWebServer需以WEBSERVER_RATE_LIMIT=0启动，关闭按IP限速
+//
+// 用法示例：
+//   idleconn -n 100000 -s 16 -i 10 -x $(pidof modernCppWebServer) -m     modernCppWebServer，同时读取/metrics
+//   idleconn -P 9006 -n 100000 -i 5 -x $(pidof tiny) -u /                 TinyWebServer，空闲超时15秒，发送间隔要更短
+//
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../metrics/histogram.h"
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+namespace {
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int port = 1316;
+  int idle = 100000;       // 空闲连接数
+  int sources = 16;        // 空闲连接使用的源地址个数，127.0.0.2起，0为不绑定源地址
+  int connect_rate = 20000; // 每秒新建的空闲连接数
+  int trickle_s = 10;      // 每个空闲连接发送请求的间隔，需小于服务器的空闲超时
+  int active = 16;         // 测量延迟的活跃连接数，闭环，每个连接一个在途请求
+  int duration_s = 10;     // 每轮活跃压测的时长
+  int settle_s = 2;        // 空闲连接建立完后等待的时间
+  std::string path = "/";  // 活跃连接和空闲连接请求的路径
+  int pid = 0;             // 服务器进程号，用于读取内存占用，0为不读取
+  bool scrape_metrics = false; // 从服务器的/metrics读取主线程各阶段的耗时，只有modernCppWebServer支持
+};
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// 把描述符数的软限制提高到needed，硬限制不够时先尝试提高硬限制（需要CAP_SYS_RESOURCE），返回最终的软限制
+rlim_t RaiseFdLimit(rlim_t needed) {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) < 0) {
+    return 0;
+  }
+  if (limit.rlim_max != RLIM_INFINITY && limit.rlim_max < needed) {
+    struct rlimit raised = {needed, needed};
+    if (setrlimit(RLIMIT_NOFILE, &raised) == 0) {
+      return needed;
+    }
+  }
+  if (limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+  }
+  return limit.rlim_cur;
+}
+
+// 读取进程的常驻内存（/proc/pid/status中的VmRSS），单位KB，失败返回-1
+long ReadRssKb(int pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/status", pid);
+  FILE *fp = fopen(path, "r");
+  if (fp == nullptr) {
+    return -1;
+  }
+  char line[256];
+  long rss = -1;
+  while (fgets(line, sizeof(line), fp) != nullptr) {
+    if (strncmp(line, "VmRSS:", 6) == 0) {
+      rss = strtol(line + 6, nullptr, 10);
+      break;
+    }
+  }
+  fclose(fp);
+  return rss;
+}
+
+// 解析in开头的一个完整响应：状态行 + 响应头 + Content-length长度的响应体
+// 返回响应的总长度，不完整时返回0，格式错误时返回-1
+long ParseResponse(const std::string &in, int *status, bool *is_close) {
+  size_t header_end = in.find("\r\n\r\n");
+  if (header_end == std::string::npos) {
+    return in.size() > 65536 ? -1 : 0;
+  }
+  if (in.compare(0, 5, "HTTP/") != 0) {
+    return -1;
+  }
+  const char *sp = static_cast<const char *>(memchr(in.data(), ' ', header_end));
+  if (sp == nullptr) {
+    return -1;
+  }
+  *status = atoi(sp + 1);
+  *is_close = false;
+  size_t body_len = 0;
+  size_t line = in.find("\r\n");
+  while (line < header_end) {
+    size_t next = in.find("\r\n", line + 2);
+    const char *field = in.data() + line + 2;
+    size_t field_len = next - line - 2;
+    if (field_len > 15 && strncasecmp(field, "Content-length:", 15) == 0) {
+      body_len = strtoul(field + 15, nullptr, 10);
+    } else if (field_len > 11 && strncasecmp(field, "Connection:", 11) == 0) {
+      *is_close = strncasecmp(field + 11 + strspn(field + 11, " "), "close", 5) == 0;
+    }
+    line = next;
+  }
+  size_t total = header_end + 4 + body_len;
+  return in.size() < total ? 0 : static_cast<long>(total);
+}
+
+std::string MakeRequest(const Options &opt, const std::string &path) {
+  return "GET " + path + " HTTP/1.1\r\nHost: " + opt.host + "\r\nConnection: keep-alive\r\n\r\n";
+}
+
+// 从服务器的/metrics读取所有统计项，返回"名字{标签}" -> 数值，失败时返回空
+std::map<std::string, double> ScrapeMetrics(const Options &opt) {
+  std::map<std::string, double> values;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(opt.port);
+  inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+  struct timeval tv = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return values;
+  }
+  std::string request = "GET /metrics HTTP/1.1\r\nHost: " + opt.host + "\r\nConnection: close\r\n\r\n";
+  send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+  std::string in;
+  char buff[65536];
+  int status = 0;
+  bool is_close = false;
+  long total = 0;
+  while (total == 0) {
+    ssize_t len = recv(fd, buff, sizeof(buff), 0);
+    if (len <= 0) {
+      break;
+    }
+    in.append(buff, len);
+    total = ParseResponse(in, &status, &is_close);
+  }
+  close(fd);
+  if (total <= 0 || status != 200) {
+    return values;
+  }
+  size_t pos = in.find("\r\n\r\n") + 4;
+  while (pos < static_cast<size_t>(total)) {
+    size_t end = in.find('\n', pos);
+    if (end == std::string::npos) {
+      end = total;
+    }
+    std::string line = in.substr(pos, end - pos);
+    pos = end + 1;
+    size_t sp = line.rfind(' ');
+    if (line.empty() || line[0] == '#' || sp == std::string::npos) {
+      continue;
+    }
+    values[line.substr(0, sp)] = atof(line.c_str() + sp + 1);
+  }
+  return values;
+}
+
+// 两次抓取之间某个阶段的平均耗时（微秒），没有数据时返回-1
+double StageMeanUs(const std::map<std::string, double> &before, const std::map<std::string, double> &after,
+                   const char *stage) {
+  std::string label = std::string("{stage=\"") + stage + "\"}";
+  auto get = [](const std::map<std::string, double> &values, const std::string &key) {
+    auto it = values.find(key);
+    return it == values.end() ? 0.0 : it->second;
+  };
+  double count = get(after, "webserver_stage_latency_us_count" + label)
+      - get(before, "webserver_stage_latency_us_count" + label);
+  double sum = get(after, "webserver_stage_latency_us_sum" + label)
+      - get(before, "webserver_stage_latency_us_sum" + label);
+  return count > 0 ? sum / count : -1;
+}
+
+// 启动以来某个阶段的累计分位数（微秒），没有该项时返回-1
+double StageQuantileUs(const std::map<std::string, double> &values, const char *stage, const char *quantile) {
+  auto it = values.find(std::string("webserver_stage_latency_us{stage=\"") + stage + "\",quantile=\"" + quantile
+                            + "\"}");
+  return it == values.end() ? -1 : it->second;
+}
+
+// 一轮活跃压测的结果
+struct ProbeResult {
+  ProbeResult() : latency(new LatencyHistogram()) {}
+  std::unique_ptr<LatencyHistogram> latency;  // 微秒
+  uint64_t ok = 0;      // 2xx、3xx响应数
+  uint64_t failed = 0;  // 4xx、5xx响应数
+  uint64_t errors = 0;  // 连接错误、响应无法解析、连接被中途关闭
+};
+
+// 闭环压测：active个长连接，每个连接收到响应后立即发下一个请求，持续duration_s秒
+void RunProbe(const Options &opt, ProbeResult *result) {
+  struct ProbeConn {
+    int fd;
+    int64_t sent_at;
+    std::string in;
+  };
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(opt.port);
+  inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+  const std::string request = MakeRequest(opt, opt.path);
+  int epoll_fd = epoll_create1(0);
+  std::vector<ProbeConn> conns(opt.active);
+
+  // 连接阻塞建立，之后改为非阻塞并发出第一个请求
+  auto open_conn = [&](ProbeConn &conn) {
+    conn.fd = socket(AF_INET, SOCK_STREAM, 0);
+    conn.in.clear();
+    int one = 1;
+    setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(conn.fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+      ++result->errors;
+      close(conn.fd);
+      conn.fd = -1;
+      return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u32 = static_cast<uint32_t>(&conn - &conns[0]);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn.fd, &ev);
+    conn.sent_at = NowNs();
+    send(conn.fd, request.data(), request.size(), MSG_NOSIGNAL);
+  };
+  auto close_conn = [&](ProbeConn &conn) {
+    close(conn.fd);
+    conn.fd = -1;
+  };
+
+  for (ProbeConn &conn : conns) {
+    open_conn(conn);
+  }
+  const int64_t stop_at = NowNs() + opt.duration_s * 1000000000LL;
+  std::vector<struct epoll_event> events(256);
+  char buff[65536];
+  while (NowNs() < stop_at) {
+    int n = epoll_wait(epoll_fd, &events[0], static_cast<int>(events.size()), 100);
+    int64_t now = NowNs();
+    for (int i = 0; i < n; ++i) {
+      ProbeConn &conn = conns[events[i].data.u32];
+      ssize_t len = recv(conn.fd, buff, sizeof(buff), 0);
+      if (len <= 0) {
+        ++result->errors;
+        close_conn(conn);
+        open_conn(conn);
+        continue;
+      }
+      conn.in.append(buff, len);
+      int status = 0;
+      bool is_close = false;
+      long total = ParseResponse(conn.in, &status, &is_close);
+      if (total == 0) {
+        continue;
+      }
+      if (total < 0) {
+        ++result->errors;
+        close_conn(conn);
+        open_conn(conn);
+        continue;
+      }
+      result->latency->Record(static_cast<uint64_t>((now - conn.sent_at) / 1000));
+      if (status >= 400) {
+        ++result->failed;
+      } else {
+        ++result->ok;
+      }
+      conn.in.erase(0, total);
+      if (is_close) {
+        close_conn(conn);
+        open_conn(conn);
+      } else {
+        conn.sent_at = now;
+        send(conn.fd, request.data(), request.size(), MSG_NOSIGNAL);
+      }
+    }
+    // 建立失败的连接（如服务器暂时拒绝）稍后重试
+    for (ProbeConn &conn : conns) {
+      if (conn.fd < 0) {
+        open_conn(conn);
+      }
+    }
+  }
+  for (ProbeConn &conn : conns) {
+    if (conn.fd >= 0) {
+      close(conn.fd);
+    }
+  }
+  close(epoll_fd);
+}
+
+// 空闲连接：按速率建立，之后每个连接每隔trickle_s秒发一个请求，发送时刻均匀错开
+// 只由一个线程运行，统计值用原子变量，主线程随时读取
+class IdlePool {
+ public:
+  explicit IdlePool(const Options &opt)
+      : opt_(opt), conns_(opt.idle), request_(MakeRequest(opt, opt.path)), trickle_latency_(new LatencyHistogram()) {
+  }
+
+  // 建立连接并保持，直到Stop()
+  void Run();
+  void Stop() {
+    stop_.store(true);
+  }
+
+  bool RampDone() const {
+    return ramp_done_.load();
+  }
+  double RampSeconds() const {
+    return ramp_ns_.load() / 1e9;
+  }
+  int Open() const {
+    return open_.load();
+  }
+
+  std::atomic<uint64_t> connect_failed{0};  // 建立失败（含socket、bind失败）的连接数
+  std::atomic<uint64_t> server_closed{0};   // 建立后被服务器关闭或出错的连接数
+  std::atomic<uint64_t> trickle_sent{0};
+  std::atomic<uint64_t> trickle_ok{0};
+  std::atomic<uint64_t> trickle_failed{0};  // 4xx、5xx响应数
+
+  const LatencyHistogram &TrickleLatency() const {
+    return *trickle_latency_;
+  }
+
+ private:
+  enum State : uint8_t { kClosed = 0, kConnecting, kIdle, kWaiting };
+
+  struct IdleConn {
+    int fd = -1;
+    State state = kClosed;
+    int64_t sent_at = 0;
+    std::string in;  // 只在等待响应时非空
+  };
+
+  void Connect_(uint32_t index);
+  void Close_(IdleConn &conn, bool by_server);
+  void OnEvent_(uint32_t index, uint32_t events, int64_t now);
+  void Send_(IdleConn &conn, int64_t now);
+
+  static const int kSlotMs = 10;  // 发送时刻的粒度
+
+  const Options &opt_;
+  std::vector<IdleConn> conns_;
+  const std::string request_;
+  std::unique_ptr<LatencyHistogram> trickle_latency_;
+  int epoll_fd_ = -1;
+  struct sockaddr_in addr_;
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> ramp_done_{false};
+  std::atomic<int64_t> ramp_ns_{0};
+  std::atomic<int> open_{0};
+};
+
+const int IdlePool::kSlotMs;
+
+void IdlePool::Run() {
+  memset(&addr_, 0, sizeof(addr_));
+  addr_.sin_family = AF_INET;
+  addr_.sin_port = htons(opt_.port);
+  inet_pton(AF_INET, opt_.host.c_str(), &addr_.sin_addr);
+  epoll_fd_ = epoll_create1(0);
+
+  // 第i个连接在每个周期的第(i % slot_num)个时间片发送请求
+  const int64_t start = NowNs();
+  const int slot_num = std::max(1, opt_.trickle_s * 1000 / kSlotMs);
+  int64_t next_slot = 0;  // 下一个要处理的时间片序号（从start起算）
+  uint32_t next_connect = 0;
+  std::vector<struct epoll_event> events(4096);
+  while (!stop_.load()) {
+    int64_t now = NowNs();
+    if (next_connect < conns_.size()) {
+      // 按速率补齐到当前时刻应建立的连接数
+      uint64_t due = std::min<uint64_t>(conns_.size(), (now - start) / 1000000 * opt_.connect_rate / 1000 + 1);
+      while (next_connect < due) {
+        Connect_(next_connect++);
+      }
+    } else if (!ramp_done_.load()) {
+      bool is_connecting = false;
+      for (const IdleConn &conn : conns_) {
+        if (conn.state == kConnecting) {
+          is_connecting = true;
+          break;
+        }
+      }
+      if (!is_connecting) {
+        ramp_ns_.store(now - start);
+        ramp_done_.store(true);
+      }
+    }
+    int64_t current_slot = (now - start) / (kSlotMs * 1000000LL);
+    for (; next_slot <= current_slot; ++next_slot) {
+      for (size_t i = next_slot % slot_num; i < conns_.size(); i += slot_num) {
+        if (conns_[i].state == kIdle) {
+          Send_(conns_[i], now);
+        }
+      }
+    }
+    int n = epoll_wait(epoll_fd_, &events[0], static_cast<int>(events.size()), kSlotMs);
+    now = NowNs();
+    for (int i = 0; i < n; ++i) {
+      OnEvent_(events[i].data.u32, events[i].events, now);
+    }
+  }
+  for (IdleConn &conn : conns_) {
+    if (conn.fd >= 0) {
+      close(conn.fd);
+    }
+  }
+  close(epoll_fd_);
+}
+
+void IdlePool::Connect_(uint32_t index) {
+  IdleConn &conn = conns_[index];
+  conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (conn.fd < 0) {
+    ++connect_failed;
+    return;
+  }
+  if (opt_.sources > 0) {
+    // 只绑定源地址，本地端口到connect时再按四元组分配，不受bind时端口必须全局唯一的限制
+    int one = 1;
+    setsockopt(conn.fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 1 + index % opt_.sources);
+    if (bind(conn.fd, reinterpret_cast<struct sockaddr *>(&local), sizeof(local)) < 0) {
+      ++connect_failed;
+      close(conn.fd);
+      conn.fd = -1;
+      return;
+    }
+  }
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+  ev.data.u32 = index;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn.fd, &ev);
+  conn.state = kConnecting;
+  if (connect(conn.fd, reinterpret_cast<struct sockaddr *>(&addr_), sizeof(addr_)) < 0 && errno != EINPROGRESS) {
+    ++connect_failed;
+    close(conn.fd);
+    conn.fd = -1;
+    conn.state = kClosed;
+  }
+}
+
+void IdlePool::Close_(IdleConn &conn, bool by_server) {
+  if (conn.state == kConnecting) {
+    ++connect_failed;
+  } else {
+    if (by_server) {
+      ++server_closed;
+    }
+    --open_;
+  }
+  close(conn.fd);
+  conn.fd = -1;
+  conn.state = kClosed;
+  std::string().swap(conn.in);
+}
+
+void IdlePool::OnEvent_(uint32_t index, uint32_t events, int64_t now) {
+  IdleConn &conn = conns_[index];
+  if (conn.state == kConnecting) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+      Close_(conn, false);
+      return;
+    }
+    // 建立后只关心可读（响应或服务器关闭）
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u32 = index;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.state = kIdle;
+    ++open_;
+    return;
+  }
+  char buff[65536];
+  while (true) {
+    ssize_t len = recv(conn.fd, buff, sizeof(buff), MSG_DONTWAIT);
+    if (len > 0) {
+      conn.in.append(buff, len);
+      continue;
+    }
+    if (len == 0 || errno != EAGAIN) {
+      Close_(conn, true);
+      return;
+    }
+    break;
+  }
+  if (conn.state != kWaiting) {
+    // 没有请求时收到数据，只可能是服务器的错误响应
+    Close_(conn, true);
+    return;
+  }
+  int status = 0;
+  bool is_close = false;
+  long total = ParseResponse(conn.in, &status, &is_close);
+  if (total == 0) {
+    return;
+  }
+  if (total < 0) {
+    Close_(conn, true);
+    return;
+  }
+  trickle_latency_->Record(static_cast<uint64_t>((now - conn.sent_at) / 1000));
+  if (status >= 400) {
+    ++trickle_failed;
+  } else {
+    ++trickle_ok;
+  }
+  std::string().swap(conn.in);
+  conn.state = kIdle;
+  if (is_close) {
+    Close_(conn, true);
+  }
+}
+
+void IdlePool::Send_(IdleConn &conn, int64_t now) {
+  ssize_t len = send(conn.fd, request_.data(), request_.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (len != static_cast<ssize_t>(request_.size())) {
+    Close_(conn, true);
+    return;
+  }
+  conn.sent_at = now;
+  conn.state = kWaiting;
+  ++trickle_sent;
+}
+
+void PrintLatency(const char *name, const ProbeResult &result, int duration_s) {
+  std::vector<uint64_t> counts(LatencyHistogram::kBucketNum, 0);
+  result.latency->MergeTo(counts);
+  printf("  %-9s %llu ok (%.1f req/s), %llu 4xx/5xx, %llu errors, latency us p50 %llu, p99 %llu, p999 %llu\n",
+         name, static_cast<unsigned long long>(result.ok), static_cast<double>(result.ok) / duration_s,
+         static_cast<unsigned long long>(result.failed), static_cast<unsigned long long>(result.errors),
+         static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.5)),
+         static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.99)),
+         static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.999)));
+}
+
+void PrintStage(const char *stage, const std::vector<std::map<std::string, double>> &scrapes) {
+  printf("  %-15s mean us baseline %.2f, with idle %.2f; since start p50 %.0f, p99 %.0f, p999 %.0f\n", stage,
+         StageMeanUs(scrapes[0], scrapes[1], stage), StageMeanUs(scrapes[2], scrapes[3], stage),
+         StageQuantileUs(scrapes[3], stage, "0.5"), StageQuantileUs(scrapes[3], stage, "0.99"),
+         StageQuantileUs(scrapes[3], stage, "0.999"));
+}
+
+void Usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -H host        server address (default 127.0.0.1)\n"
+          "  -P port        server port (default 1316)\n"
+          "  -n conns       idle connections (default 100000)\n"
+          "  -s sources     loopback source addresses from 127.0.0.2, 0 = no bind (default 16)\n"
+          "  -r rate        idle connections opened per second (default 20000)\n"
+          "  -i seconds     request interval on each idle connection (default 10)\n"
+          "  -a conns       active closed-loop connections for latency (default 16)\n"
+          "  -d seconds     duration of each active run (default 10)\n"
+          "  -w seconds     settle time after the idle connections are open (default 2)\n"
+          "  -u path        request path (default /)\n"
+          "  -x pid         server pid, report its RSS\n"
+          "  -m             read stage timings from the server's /metrics\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  int opt_char;
+  while ((opt_char = getopt(argc, argv, "H:P:n:s:r:i:a:d:w:u:x:mh")) != -1) {
+    switch (opt_char) {
+      case 'H':opt.host = optarg;
+        break;
+      case 'P':opt.port = atoi(optarg);
+        break;
+      case 'n':opt.idle = std::max(0, atoi(optarg));
+        break;
+      case 's':opt.sources = std::max(0, atoi(optarg));
+        break;
+      case 'r':opt.connect_rate = std::max(1, atoi(optarg));
+        break;
+      case 'i':opt.trickle_s = std::max(1, atoi(optarg));
+        break;
+      case 'a':opt.active = std::max(1, atoi(optarg));
+        break;
+      case 'd':opt.duration_s = std::max(1, atoi(optarg));
+        break;
+      case 'w':opt.settle_s = std::max(0, atoi(optarg));
+        break;
+      case 'u':opt.path = optarg;
+        break;
+      case 'x':opt.pid = atoi(optarg);
+        break;
+      case 'm':opt.scrape_metrics = true;
+        break;
+      default:Usage(argv[0]);
+        return 1;
+    }
+  }
+  rlim_t needed = static_cast<rlim_t>(opt.idle) + opt.active + 64;
+  rlim_t limit = RaiseFdLimit(needed);
+  if (limit < needed) {
+    fprintf(stderr, "fd limit %llu < %llu needed, idle connections beyond it will fail (raise ulimit -Hn)\n",
+            static_cast<unsigned long long>(limit), static_cast<unsigned long long>(needed));
+  }
+
+  // 四次抓取：基线压测前后、空闲连接存在时的压测前后
+  std::vector<std::map<std::string, double>> scrapes(4);
+  auto scrape = [&opt, &scrapes](int i) {
+    if (opt.scrape_metrics) {
+      scrapes[i] = ScrapeMetrics(opt);
+    }
+  };
+  long rss_before = opt.pid > 0 ? ReadRssKb(opt.pid) : -1;
+
+  ProbeResult baseline;
+  scrape(0);
+  RunProbe(opt, &baseline);
+  scrape(1);
+
+  IdlePool pool(opt);
+  std::thread idle_thread([&pool] { pool.Run(); });
+  while (!pool.RampDone()) {
+    usleep(100000);
+  }
+  sleep(opt.settle_s);
+  long rss_idle = opt.pid > 0 ? ReadRssKb(opt.pid) : -1;
+  int open_idle = pool.Open();
+
+  ProbeResult loaded;
+  scrape(2);
+  RunProbe(opt, &loaded);
+  scrape(3);
+  long rss_after = opt.pid > 0 ? ReadRssKb(opt.pid) : -1;
+  int open_after = pool.Open();
+  pool.Stop();
+  idle_thread.join();
+
+  printf("idle connections to %s:%d, %d requested, %d open after ramp (%.1fs), %d open at end\n",
+         opt.host.c_str(), opt.port, opt.idle, open_idle, pool.RampSeconds(), open_after);
+  printf("  connect failures %llu, closed by server %llu\n",
+         static_cast<unsigned long long>(pool.connect_failed.load()),
+         static_cast<unsigned long long>(pool.server_closed.load()));
+  std::vector<uint64_t> counts(LatencyHistogram::kBucketNum, 0);
+  pool.TrickleLatency().MergeTo(counts);
+  printf("  trickle every %ds: %llu sent, %llu ok, %llu 4xx/5xx, latency us p50 %llu, p99 %llu\n", opt.trickle_s,
+         static_cast<unsigned long long>(pool.trickle_sent.load()),
+         static_cast<unsigned long long>(pool.trickle_ok.load()),
+         static_cast<unsigned long long>(pool.trickle_failed.load()),
+         static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.5)),
+         static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.99)));
+  if (opt.pid > 0) {
+    printf("server rss KB: baseline %ld, with idle %ld, after active run %ld, %.2f KB per idle connection\n",
+           rss_before, rss_idle, rss_after,
+           open_idle > 0 ? static_cast<double>(rss_idle - rss_before) / open_idle : 0.0);
+  }
+  printf("active %d connections, GET %s, %ds each\n", opt.active, opt.path.c_str(), opt.duration_s);
+  PrintLatency("baseline", baseline, opt.duration_s);
+  PrintLatency("with idle", loaded, opt.duration_s);
+  if (opt.scrape_metrics) {
+    if (scrapes[3].empty()) {
+      printf("server stages: /metrics not available\n");
+    } else {
+      printf("server stages (main thread):\n");
+      PrintStage("timer_tick", scrapes);
+      PrintStage("event_dispatch", scrapes);
+    }
+  }
+  return 0;
+}
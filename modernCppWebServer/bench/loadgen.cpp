@@ -0,0 +1,617 @@
+//
+// Created by lhm on 2026/10/19.
+//
+// 基于epoll的多线程HTTP压测工具，用于替代webbench（每个客户端fork一个进程、每个请求新建一个连接、只输出pages/min）
+// 支持长连接、流水线深度、闭环（每个连接固定并发）和开环（固定发送速率）两种模式，
+// 开环模式按计划发送时刻计算延迟，以修正协调遗漏（coordinated omission），
+// 支持GET与登录/注册POST的混合负载，输出延迟分位数
+//
+// 用法示例：
+//   loadgen -c 256 -t 4 -d 30 -u /index.html:8 -u /picture.html:1 -l 1     闭环，长连接
+//   loadgen -c 256 -t 4 -d 30 -R 20000 -p 4                                开环，每秒20000个请求，流水线深度4
+//   loadgen -P 10000 -u /:8 -l 2 -L /2CGISQL.cgi -U user                   压测TinyWebServer的登录
+//
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../metrics/histogram.h"
+
+namespace {
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int port = 1316;
+  int threads = 2;
+  int connections = 64;   // 所有线程的连接总数
+  int duration_s = 10;
+  int warmup_s = 0;       // 预热时间内的结果不计入统计
+  int depth = 1;          // 每个连接上同时在途的请求数（流水线深度）
+  bool keep_alive = true;
+  double rate = 0;        // 开环模式下每秒的请求总数，0为闭环模式
+  int timeout_ms = 5000;  // 请求超时时间，超时的连接会被关闭重连
+  int login_users = 100;  // 登录负载使用的用户数量，用户名和密码均为bench<k>
+  std::string login_path = "/login.html";
+  std::string register_path = "/register.html";
+  std::string user_field = "username";  // 表单中用户名字段的名字，TinyWebServer为user
+  bool json = false;
+};
+
+// 负载中的一种请求及其权重
+struct Item {
+  enum Kind { kGet, kLogin, kRegister };
+  Kind kind;
+  std::string path;
+  int weight;
+};
+
+int64_t NowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// 每个线程的统计结果，只由所属线程写入，结束后由主线程合并
+struct Stats {
+  Stats() : latency(new LatencyHistogram()) {}
+  std::unique_ptr<LatencyHistogram> latency;  // 微秒
+  uint64_t ok = 0;          // 2xx、3xx响应数
+  uint64_t status_4xx = 0;
+  uint64_t status_5xx = 0;
+  uint64_t errors = 0;      // 连接错误、响应无法解析、连接被中途关闭的请求数
+  uint64_t timeouts = 0;
+  uint64_t connects = 0;
+  uint64_t bytes_in = 0;
+};
+
+struct Conn {
+  int fd = -1;
+  bool is_connecting = false;
+  bool close_after = false;     // 收到Connection: close后，在途请求完成即关闭
+  std::string out;              // 待发送的请求
+  size_t out_off = 0;
+  std::string in;               // 已收到但未解析的响应
+  std::deque<int64_t> inflight; // 在途请求的计划发送时刻（纳秒），按发送顺序排列
+  int64_t last_progress = 0;
+};
+
+class Worker {
+ public:
+  Worker(const Options &opt, const std::vector<Item> &items, int id, int conn_num, double rate)
+      : opt_(opt), items_(items), id_(id), conns_(conn_num), rate_(rate), rng_(id * 7919 + getpid()) {
+    for (const Item &item : items_) {
+      total_weight_ += item.weight;
+    }
+  }
+
+  // 运行压测，直到stop_at（纳秒）为止，measure_from之前完成的请求不计入统计
+  void Run(int64_t start, int64_t measure_from, int64_t stop_at);
+
+  Stats &GetStats() {
+    return stats_;
+  }
+
+ private:
+  void Connect_(Conn &conn);
+  void Close_(Conn &conn, bool is_error);
+  // 向连接写入一个请求，intended为计划发送时刻
+  void Send_(Conn &conn, int64_t intended);
+  bool Flush_(Conn &conn);
+  void OnReadable_(Conn &conn, int64_t now);
+  // 从conn.in中解析出完整的响应，返回解析出的个数，格式错误时返回-1
+  int ParseResponses_(Conn &conn, int64_t now);
+  void Record_(int64_t intended, int64_t now, int status);
+  // 闭环模式下把连接的在途请求补满到流水线深度
+  void FillClosedLoop_(Conn &conn, int64_t now);
+  // 按权重选取一种请求，拼接后追加到out中
+  void AppendRequest_(std::string &out);
+  bool CanSend_(const Conn &conn) const {
+    return conn.fd >= 0 && !conn.is_connecting && !conn.close_after
+        && static_cast<int>(conn.inflight.size()) < opt_.depth;
+  }
+
+  const Options &opt_;
+  const std::vector<Item> &items_;
+  int id_;
+  int total_weight_ = 0;
+  std::vector<Conn> conns_;
+  double rate_;
+  int epoll_fd_ = -1;
+  int64_t measure_from_ = 0;
+  uint64_t register_seq_ = 0;
+  std::mt19937 rng_;
+  Stats stats_;
+  struct sockaddr_in addr_;
+};
+
+void Worker::Run(int64_t start, int64_t measure_from, int64_t stop_at) {
+  measure_from_ = measure_from;
+  memset(&addr_, 0, sizeof(addr_));
+  addr_.sin_family = AF_INET;
+  addr_.sin_port = htons(opt_.port);
+  inet_pton(AF_INET, opt_.host.c_str(), &addr_.sin_addr);
+
+  epoll_fd_ = epoll_create1(0);
+  for (Conn &conn : conns_) {
+    Connect_(conn);
+  }
+
+  const bool is_open_loop = rate_ > 0;
+  const double interval_ns = is_open_loop ? 1e9 / rate_ : 0;
+  uint64_t sent = 0;     // 开环模式下已经发出的计划请求数
+  size_t next_conn = 0;  // 开环模式下轮询选择连接的起点
+  int64_t next_check = start;
+  std::vector<struct epoll_event> events(256);
+
+  while (true) {
+    int64_t now = NowNs();
+    if (now >= stop_at) {
+      break;
+    }
+    int wait_ms = 100;
+    if (is_open_loop) {
+      // 发送所有已经到达计划时刻的请求，没有可用连接时保留计划时刻，之后发送时延迟仍从计划时刻算起
+      while (true) {
+        int64_t intended = start + static_cast<int64_t>(sent * interval_ns);
+        if (intended > now) {
+          wait_ms = static_cast<int>((intended - now + 999999) / 1000000);
+          break;
+        }
+        size_t i = 0;
+        for (; i < conns_.size(); ++i) {
+          Conn &conn = conns_[(next_conn + i) % conns_.size()];
+          if (CanSend_(conn)) {
+            Send_(conn, intended);
+            break;
+          }
+        }
+        if (i == conns_.size()) {
+          wait_ms = 1;
+          break;
+        }
+        next_conn = (next_conn + i + 1) % conns_.size();
+        ++sent;
+      }
+    }
+
+    int n = epoll_wait(epoll_fd_, &events[0], static_cast<int>(events.size()), wait_ms);
+    now = NowNs();
+    for (int i = 0; i < n; ++i) {
+      Conn &conn = conns_[events[i].data.u32];
+      if (conn.fd < 0) {
+        continue;
+      }
+      if (conn.is_connecting && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+          Close_(conn, true);
+          continue;
+        }
+        conn.is_connecting = false;
+        conn.last_progress = now;
+        ++stats_.connects;
+        if (!is_open_loop) {
+          FillClosedLoop_(conn, now);
+        }
+        continue;
+      }
+      if (events[i].events & EPOLLOUT) {
+        if (!Flush_(conn)) {
+          Close_(conn, true);
+          continue;
+        }
+      }
+      if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        OnReadable_(conn, now);
+      }
+      if (!is_open_loop && conn.fd >= 0) {
+        FillClosedLoop_(conn, now);
+      }
+    }
+
+    if (now >= next_check) {
+      // 每100ms检查一次超时的连接，并重连已关闭的连接
+      next_check = now + 100000000LL;
+      for (Conn &conn : conns_) {
+        if (conn.fd >= 0 && (conn.is_connecting || !conn.inflight.empty())
+            && now - conn.last_progress > opt_.timeout_ms * 1000000LL) {
+          stats_.timeouts += conn.inflight.size();
+          conn.inflight.clear();
+          Close_(conn, false);
+        }
+        if (conn.fd < 0) {
+          Connect_(conn);
+        }
+      }
+    }
+  }
+  for (Conn &conn : conns_) {
+    if (conn.fd >= 0) {
+      close(conn.fd);
+    }
+  }
+  close(epoll_fd_);
+}
+
+void Worker::Connect_(Conn &conn) {
+  conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (conn.fd < 0) {
+    ++stats_.errors;
+    return;
+  }
+  int one = 1;
+  setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  conn.out.clear();
+  conn.out_off = 0;
+  conn.in.clear();
+  conn.inflight.clear();
+  conn.close_after = false;
+  conn.is_connecting = true;
+  conn.last_progress = NowNs();
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.u32 = static_cast<uint32_t>(&conn - &conns_[0]);
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn.fd, &ev);
+  if (connect(conn.fd, reinterpret_cast<struct sockaddr *>(&addr_), sizeof(addr_)) < 0
+      && errno != EINPROGRESS) {
+    Close_(conn, true);
+  }
+}
+
+void Worker::Close_(Conn &conn, bool is_error) {
+  if (conn.fd < 0) {
+    return;
+  }
+  if (is_error) {
+    // 连接异常时，在途请求都算作错误
+    stats_.errors += std::max<size_t>(conn.inflight.size(), 1);
+  }
+  conn.inflight.clear();
+  close(conn.fd);
+  conn.fd = -1;
+}
+
+void Worker::Send_(Conn &conn, int64_t intended) {
+  if (conn.inflight.empty()) {
+    conn.last_progress = NowNs();
+  }
+  AppendRequest_(conn.out);
+  conn.inflight.push_back(intended);
+  if (!Flush_(conn)) {
+    Close_(conn, true);
+  }
+}
+
+// 尽量写出待发送的请求，写满时等待EPOLLOUT，出错返回false
+bool Worker::Flush_(Conn &conn) {
+  while (conn.out_off < conn.out.size()) {
+    ssize_t len = send(conn.fd, conn.out.data() + conn.out_off, conn.out.size() - conn.out_off, MSG_NOSIGNAL);
+    if (len < 0) {
+      return errno == EAGAIN;
+    }
+    conn.out_off += len;
+  }
+  conn.out.clear();
+  conn.out_off = 0;
+  return true;
+}
+
+void Worker::OnReadable_(Conn &conn, int64_t now) {
+  char buff[65536];
+  bool is_eof = false;
+  while (true) {
+    ssize_t len = recv(conn.fd, buff, sizeof(buff), 0);
+    if (len > 0) {
+      stats_.bytes_in += len;
+      conn.in.append(buff, len);
+      continue;
+    }
+    if (len == 0) {
+      is_eof = true;
+    } else if (errno != EAGAIN) {
+      Close_(conn, true);
+      return;
+    }
+    break;
+  }
+  if (ParseResponses_(conn, now) < 0) {
+    Close_(conn, true);
+    return;
+  }
+  if (conn.close_after && conn.inflight.empty()) {
+    // 短连接模式下每个响应后由服务器关闭连接，立即重新建立连接
+    Close_(conn, false);
+    Connect_(conn);
+  } else if (is_eof) {
+    // 服务器关闭了连接，还没有收到响应的请求算作错误
+    Close_(conn, !conn.inflight.empty());
+  }
+}
+
+// 解析完整的响应：状态行 + 响应头 + Content-length长度的响应体
+int Worker::ParseResponses_(Conn &conn, int64_t now) {
+  int count = 0;
+  size_t pos = 0;
+  while (!conn.inflight.empty()) {
+    size_t header_end = conn.in.find("\r\n\r\n", pos);
+    if (header_end == std::string::npos) {
+      break;
+    }
+    const char *head = conn.in.data() + pos;
+    if (conn.in.compare(pos, 5, "HTTP/") != 0) {
+      return -1;
+    }
+    const char *sp = static_cast<const char *>(memchr(head, ' ', header_end - pos));
+    if (sp == nullptr) {
+      return -1;
+    }
+    int status = atoi(sp + 1);
+    size_t body_len = 0;
+    bool is_close = false;
+    size_t line = conn.in.find("\r\n", pos);
+    while (line < header_end) {
+      size_t next = conn.in.find("\r\n", line + 2);
+      const char *field = conn.in.data() + line + 2;
+      size_t field_len = next - line - 2;
+      if (field_len > 15 && strncasecmp(field, "Content-length:", 15) == 0) {
+        body_len = strtoul(field + 15, nullptr, 10);
+      } else if (field_len > 11 && strncasecmp(field, "Connection:", 11) == 0) {
+        is_close = strncasecmp(field + 11 + strspn(field + 11, " "), "close", 5) == 0;
+      }
+      line = next;
+    }
+    if (conn.in.size() < header_end + 4 + body_len) {
+      break;
+    }
+    pos = header_end + 4 + body_len;
+    Record_(conn.inflight.front(), now, status);
+    conn.inflight.pop_front();
+    conn.last_progress = now;
+    ++count;
+    if (is_close) {
+      conn.close_after = true;
+    }
+  }
+  conn.in.erase(0, pos);
+  return count;
+}
+
+void Worker::Record_(int64_t intended, int64_t now, int status) {
+  if (now < measure_from_) {
+    return;
+  }
+  stats_.latency->Record(static_cast<uint64_t>((now - intended) / 1000));
+  if (status >= 500) {
+    ++stats_.status_5xx;
+  } else if (status >= 400) {
+    ++stats_.status_4xx;
+  } else {
+    ++stats_.ok;
+  }
+}
+
+void Worker::FillClosedLoop_(Conn &conn, int64_t now) {
+  while (CanSend_(conn)) {
+    Send_(conn, now);
+  }
+}
+
+void Worker::AppendRequest_(std::string &out) {
+  int pick = std::uniform_int_distribution<int>(0, total_weight_ - 1)(rng_);
+  const Item *item = &items_[0];
+  for (const Item &candidate : items_) {
+    if (pick < candidate.weight) {
+      item = &candidate;
+      break;
+    }
+    pick -= candidate.weight;
+  }
+  const char *connection = opt_.keep_alive ? "keep-alive" : "close";
+  char head[512];
+  if (item->kind == Item::kGet) {
+    snprintf(head, sizeof(head), "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n\r\n",
+             item->path.c_str(), opt_.host.c_str(), connection);
+    out += head;
+    return;
+  }
+  char body[128];
+  if (item->kind == Item::kLogin) {
+    int k = std::uniform_int_distribution<int>(0, opt_.login_users - 1)(rng_);
+    snprintf(body, sizeof(body), "%s=bench%d&password=bench%d", opt_.user_field.c_str(), k, k);
+  } else {
+    // 注册的用户名在线程、进程间都不重复
+    snprintf(body, sizeof(body), "%s=r%d_%d_%llu&password=bench", opt_.user_field.c_str(),
+             getpid(), id_, static_cast<unsigned long long>(register_seq_++));
+  }
+  snprintf(head, sizeof(head),
+           "POST %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n"
+           "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %zu\r\n\r\n",
+           item->kind == Item::kLogin ? opt_.login_path.c_str() : opt_.register_path.c_str(),
+           opt_.host.c_str(), connection, strlen(body));
+  out += head;
+  out += body;
+}
+
+void Usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -H host        server address (default 127.0.0.1)\n"
+          "  -P port        server port (default 1316)\n"
+          "  -t threads     worker threads (default 2)\n"
+          "  -c conns       total connections (default 64)\n"
+          "  -d seconds     test duration (default 10)\n"
+          "  -w seconds     warm-up excluded from results (default 0)\n"
+          "  -p depth       pipelined requests in flight per connection (default 1)\n"
+          "  -k 0|1         keep-alive (default 1)\n"
+          "  -R rate        open-loop total requests/s, 0 = closed loop (default 0)\n"
+          "  -u path[:w]    GET path with weight, repeatable (default /)\n"
+          "  -l weight      POST login weight, users bench0..benchN-1\n"
+          "  -g weight      POST register weight, unique usernames\n"
+          "  -n users       number of login users (default 100)\n"
+          "  -L path        login POST path (default /login.html)\n"
+          "  -G path        register POST path (default /register.html)\n"
+          "  -U field       user name form field (default username)\n"
+          "  -T ms          request timeout (default 5000)\n"
+          "  -j             print a JSON summary line\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  std::vector<Item> items;
+  int opt_char;
+  while ((opt_char = getopt(argc, argv, "H:P:t:c:d:w:p:k:R:u:l:g:n:L:G:U:T:jh")) != -1) {
+    switch (opt_char) {
+      case 'H':opt.host = optarg;
+        break;
+      case 'P':opt.port = atoi(optarg);
+        break;
+      case 't':opt.threads = std::max(1, atoi(optarg));
+        break;
+      case 'c':opt.connections = std::max(1, atoi(optarg));
+        break;
+      case 'd':opt.duration_s = std::max(1, atoi(optarg));
+        break;
+      case 'w':opt.warmup_s = std::max(0, atoi(optarg));
+        break;
+      case 'p':opt.depth = std::max(1, atoi(optarg));
+        break;
+      case 'k':opt.keep_alive = atoi(optarg) != 0;
+        break;
+      case 'R':opt.rate = atof(optarg);
+        break;
+      case 'u': {
+        std::string spec(optarg);
+        size_t colon = spec.rfind(':');
+        int weight = 1;
+        if (colon != std::string::npos) {
+          weight = std::max(0, atoi(spec.c_str() + colon + 1));
+          spec.resize(colon);
+        }
+        items.push_back({Item::kGet, spec, weight});
+        break;
+      }
+      case 'l':items.push_back({Item::kLogin, "", std::max(0, atoi(optarg))});
+        break;
+      case 'g':items.push_back({Item::kRegister, "", std::max(0, atoi(optarg))});
+        break;
+      case 'n':opt.login_users = std::max(1, atoi(optarg));
+        break;
+      case 'L':opt.login_path = optarg;
+        break;
+      case 'G':opt.register_path = optarg;
+        break;
+      case 'U':opt.user_field = optarg;
+        break;
+      case 'T':opt.timeout_ms = std::max(1, atoi(optarg));
+        break;
+      case 'j':opt.json = true;
+        break;
+      default:Usage(argv[0]);
+        return 1;
+    }
+  }
+  items.erase(std::remove_if(items.begin(), items.end(), [](const Item &item) { return item.weight == 0; }),
+              items.end());
+  if (items.empty()) {
+    items.push_back({Item::kGet, "/", 1});
+  }
+  opt.threads = std::min(opt.threads, opt.connections);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int i = 0; i < opt.threads; ++i) {
+    int conn_num = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+    workers.emplace_back(new Worker(opt, items, i, conn_num, opt.rate / opt.threads));
+  }
+  const int64_t start = NowNs();
+  const int64_t measure_from = start + opt.warmup_s * 1000000000LL;
+  const int64_t stop_at = measure_from + opt.duration_s * 1000000000LL;
+  std::vector<std::thread> threads;
+  for (auto &worker : workers) {
+    Worker *w = worker.get();
+    threads.emplace_back([w, start, measure_from, stop_at] { w->Run(start, measure_from, stop_at); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // 合并各线程的统计结果
+  Stats total;
+  std::vector<uint64_t> counts(LatencyHistogram::kBucketNum, 0);
+  uint64_t latency_sum = 0;
+  for (auto &worker : workers) {
+    Stats &stats = worker->GetStats();
+    latency_sum += stats.latency->MergeTo(counts);
+    total.ok += stats.ok;
+    total.status_4xx += stats.status_4xx;
+    total.status_5xx += stats.status_5xx;
+    total.errors += stats.errors;
+    total.timeouts += stats.timeouts;
+    total.connects += stats.connects;
+    total.bytes_in += stats.bytes_in;
+  }
+  uint64_t completed = total.ok + total.status_4xx + total.status_5xx;
+  double seconds = opt.duration_s;
+  double mean = completed ? static_cast<double>(latency_sum) / completed : 0;
+  const double quantiles[] = {0.5, 0.9, 0.99, 0.999, 1.0};
+  uint64_t values[5];
+  for (int i = 0; i < 5; ++i) {
+    values[i] = LatencyHistogram::Quantile(counts, quantiles[i]);
+  }
+
+  printf("%s loop, %d threads, %d connections, depth %d, %s, %ds",
+         opt.rate > 0 ? "open" : "closed", opt.threads, opt.connections, opt.depth,
+         opt.keep_alive ? "keep-alive" : "close", opt.duration_s);
+  if (opt.rate > 0) {
+    printf(", target %.0f req/s", opt.rate);
+  }
+  printf("\n  requests   %llu (%.1f req/s), %.2f MB/s in\n",
+         static_cast<unsigned long long>(completed), completed / seconds, total.bytes_in / seconds / 1048576);
+  printf("  status     2xx/3xx %llu, 4xx %llu, 5xx %llu\n", static_cast<unsigned long long>(total.ok),
+         static_cast<unsigned long long>(total.status_4xx), static_cast<unsigned long long>(total.status_5xx));
+  printf("  errors     %llu, timeouts %llu, connects %llu\n", static_cast<unsigned long long>(total.errors),
+         static_cast<unsigned long long>(total.timeouts), static_cast<unsigned long long>(total.connects));
+  printf("  latency us mean %.0f, p50 %llu, p90 %llu, p99 %llu, p999 %llu, max %llu\n", mean,
+         static_cast<unsigned long long>(values[0]), static_cast<unsigned long long>(values[1]),
+         static_cast<unsigned long long>(values[2]), static_cast<unsigned long long>(values[3]),
+         static_cast<unsigned long long>(values[4]));
+  if (opt.json) {
+    printf("{\"mode\":\"%s\",\"threads\":%d,\"connections\":%d,\"depth\":%d,\"keep_alive\":%s,"
+           "\"duration_s\":%d,\"target_rps\":%.0f,\"requests\":%llu,\"rps\":%.1f,\"ok\":%llu,"
+           "\"status_4xx\":%llu,\"status_5xx\":%llu,\"errors\":%llu,\"timeouts\":%llu,"
+           "\"mean_us\":%.0f,\"p50_us\":%llu,\"p90_us\":%llu,\"p99_us\":%llu,\"p999_us\":%llu,\"max_us\":%llu}\n",
+           opt.rate > 0 ? "open" : "closed", opt.threads, opt.connections, opt.depth,
+           opt.keep_alive ? "true" : "false", opt.duration_s, opt.rate,
+           static_cast<unsigned long long>(completed), completed / seconds,
+           static_cast<unsigned long long>(total.ok), static_cast<unsigned long long>(total.status_4xx),
+           static_cast<unsigned long long>(total.status_5xx), static_cast<unsigned long long>(total.errors),
+           static_cast<unsigned long long>(total.timeouts), mean,
+           static_cast<unsigned long long>(values[0]), static_cast<unsigned long long>(values[1]),
+           static_cast<unsigned long long>(values[2]), static_cast<unsigned long long>(values[3]),
+           static_cast<unsigned long long>(values[4]));
+  }
+  return 0;
+}
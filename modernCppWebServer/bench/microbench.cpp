@@ -0,0 +1,833 @@
+//
+// Created by lhm on 2026/10/19.
+//
+// 核心组件的微基准测试，每项测试重复若干次取中位数，结果以json行输出到标准输出，便于在不同构建之间比较
+//
+// 用法：microbench [-f 名称过滤] [-r 重复次数] [-q] [-s 资源目录]
+//   -q  快速模式，定时器只测到10万个节点
+//
+// alloc_per_request项统计长连接GET请求在连接上的读、解析、生成响应、写的过程中调用new/delete的次数，
+// 不为0时进程以1退出，可作为分配次数的回归检查
+//
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
+#include "../buffer/ringbuffer.h"
+#include "../http/httpconn.h"
+#include "../http/httprequest.h"
+#include "../http/httpresponse.h"
+#include "../log/blockqueue.h"
+#include "../log/log.h"
+#include "../metrics/heavyhitters.h"
+#include "../metrics/histogram.h"
+#include "../pool/bloomfilter.h"
+#include "../pool/localuserstore.h"
+#include "../pool/threadpool.h"
+#include "../server/ratelimiter.h"
+#include "../timer/heaptimer.h"
+
+#ifndef MICROBENCH_SRC_DIR
+#define MICROBENCH_SRC_DIR "./resources"
+#endif
+
+// 统计当前线程调用operator new/delete的次数，只在alloc_per_request中使用
+thread_local long long g_new_count = 0;
+thread_local long long g_delete_count = 0;
+
+void *operator new(size_t size) {
+  ++g_new_count;
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr != nullptr) {
+    ++g_delete_count;
+  }
+  free(ptr);
+}
+
+namespace {
+
+bool g_failed = false;  // 有检查项没有通过
+
+// 浏览器抓取的真实请求
+const char kGetRequest[] =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/118.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+    "image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "\r\n";
+
+// 表单提交到非登录页面，只测解析，不访问数据库
+const char kPostRequest[] =
+    "POST /picture HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 39\r\n"
+    "Origin: http://127.0.0.1:1316\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/118.0.0.0 Safari/537.36\r\n"
+    "Referer: http://127.0.0.1:1316/login.html\r\n"
+    "\r\n"
+    "username=admin%40test&password=12345678";
+
+struct Options {
+  std::string filter;
+  int repeat = 5;
+  bool quick = false;
+  std::string src_dir = MICROBENCH_SRC_DIR;
+};
+
+Options g_opt;
+
+typedef std::chrono::steady_clock BenchClock;
+
+int64_t ElapsedNs(BenchClock::time_point begin) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - begin).count();
+}
+
+// 输出一条结果，extra为附加的json字段（以逗号开头）
+void Report(const char *name, const char *param, int64_t ops, double ns_per_op, const std::string &extra = "") {
+  printf("{\"name\":\"%s\",\"param\":\"%s\",\"ops\":%lld,\"ns_per_op\":%.2f,\"ops_per_s\":%.0f%s}\n",
+         name, param, static_cast<long long>(ops), ns_per_op, ns_per_op > 0 ? 1e9 / ns_per_op : 0.0,
+         extra.c_str());
+  fflush(stdout);
+}
+
+bool Selected(const char *name) {
+  return g_opt.filter.empty() || strstr(name, g_opt.filter.c_str()) != nullptr;
+}
+
+// 重复运行body若干次，每次返回总耗时（纳秒），取中位数后换算为每次操作的耗时
+double MedianNsPerOp(int64_t ops, const std::function<int64_t()> &body) {
+  std::vector<double> samples;
+  for (int i = 0; i < g_opt.repeat; ++i) {
+    samples.push_back(static_cast<double>(body()) / ops);
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// 对一个无状态操作计时
+void Run(const char *name, const char *param, int64_t ops, const std::function<void()> &op) {
+  if (!Selected(name)) {
+    return;
+  }
+  double ns = MedianNsPerOp(ops, [&] {
+    auto begin = BenchClock::now();
+    for (int64_t i = 0; i < ops; ++i) {
+      op();
+    }
+    return ElapsedNs(begin);
+  });
+  Report(name, param, ops, ns);
+}
+
+// 通过socketpair读入，4KB在缓冲区内，64KB需要Buffer扩容或ChainBuffer的多个块
+template<typename BufferType>
+void BenchReadFd(const char *name, BufferType &buff) {
+  const size_t read_sizes[] = {4096, 65536};
+  for (size_t size : read_sizes) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+      return;
+    }
+    int buf_size = 1 << 20;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buf_size, sizeof(buf_size));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size));
+    std::string data(size, 'x');
+    char param[32];
+    snprintf(param, sizeof(param), "%zuB", size);
+    int err = 0;
+    Run(name, param, 20000, [&] {
+      if (write(fds[0], data.data(), data.size()) < 0) {
+        return;
+      }
+      size_t got = 0;
+      while (got < data.size()) {
+        ssize_t len = buff.ReadFd(fds[1], &err);
+        if (len <= 0) {
+          break;
+        }
+        got += len;
+      }
+      buff.RetrieveAll();
+    });
+    close(fds[0]);
+    close(fds[1]);
+  }
+}
+
+void BenchBuffer() {
+  const size_t sizes[] = {16, 256, 4096};
+  for (size_t size : sizes) {
+    std::string data(size, 'x');
+    Buffer buff;
+    ChainBuffer chain;
+    char param[32];
+    snprintf(param, sizeof(param), "%zuB", size);
+    Run("buffer_append", param, 200000, [&] {
+      buff.Append(data);
+      if (buff.ReadableBytes() >= 65536) {
+        buff.RetrieveAll();
+      }
+    });
+    Run("chainbuffer_append", param, 200000, [&] {
+      chain.Append(data);
+      if (chain.ReadableBytes() >= 65536) {
+        chain.RetrieveAll();
+      }
+    });
+  }
+
+  Buffer buff;
+  BenchReadFd("buffer_readfd", buff);
+  ChainBuffer chain;
+  BenchReadFd("chainbuffer_readfd", chain);
+  RingBuffer ring;
+  if (ring.Init(128 * 1024)) {
+    BenchReadFd("ringbuffer_readfd", ring);
+  }
+
+  // 64KB内容写到/dev/null，Buffer一次write，ChainBuffer一次writev提交16个块
+  if (Selected("buffer_writefd")) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+      std::string data(65536, 'x');
+      Buffer buff;
+      ChainBuffer chain;
+      int err = 0;
+      Run("buffer_writefd", "buffer_64KB", 20000, [&] {
+        buff.Append(data);
+        buff.WriteFd(null_fd, &err);
+        buff.RetrieveAll();
+      });
+      Run("buffer_writefd", "chain_64KB", 20000, [&] {
+        chain.Append(data);
+        chain.WriteFd(null_fd, &err);
+        chain.RetrieveAll();
+      });
+      close(null_fd);
+    }
+  }
+}
+
+void BenchHttp() {
+  HttpRequest request;
+  Buffer buff;
+  Run("http_parse", "get", 20000, [&] {
+    request.Init();
+    buff.Append(kGetRequest, sizeof(kGetRequest) - 1);
+    request.Parse(buff);
+    buff.RetrieveAll();
+  });
+  Run("http_parse", "post_form", 20000, [&] {
+    request.Init();
+    buff.Append(kPostRequest, sizeof(kPostRequest) - 1);
+    request.Parse(buff);
+    buff.RetrieveAll();
+  });
+
+  HttpResponse response;
+  const char *paths[] = {"/index.html", "/nothere.html"};
+  for (const char *path : paths) {
+    std::string file(path);
+    Run("http_make_response", path, 20000, [&] {
+      response.Init(g_opt.src_dir.c_str(), file.c_str(), true, 200);
+      response.MakeResponse(buff);
+      response.UnmapFile();
+      buff.RetrieveAll();
+    });
+  }
+}
+
+// 每个连接处理完一个长连接GET请求后进入空闲状态，统计空闲连接平均占用的缓冲区内存
+// 同时给出处理请求期间占用的缓冲区内存，即缓冲区不归还时空闲连接会一直占用的量
+void BenchIdleConnFootprint() {
+  if (!Selected("idle_conn_footprint")) {
+    return;
+  }
+  struct rlimit limit;
+  int conn_num = 1000;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+    conn_num = std::min<int>(conn_num, (static_cast<int>(limit.rlim_cur) - 64) / 2);
+  }
+  if (conn_num <= 0) {
+    return;
+  }
+  HttpConn::src_dir = g_opt.src_dir.c_str();
+  HttpConn::isET = false;
+  std::vector<HttpConn> conns(conn_num);
+  std::vector<int> peers;
+  BufferPool *pool = BufferPool::Instance();
+  size_t base = pool->InUseBytes();
+  size_t busy_max = 0;
+  for (HttpConn &conn : conns) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+      break;
+    }
+    sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    conn.Init(fds[1], addr);
+    peers.push_back(fds[0]);
+    if (write(fds[0], kGetRequest, sizeof(kGetRequest) - 1) < 0) {
+      break;
+    }
+    int err = 0;
+    size_t before = pool->InUseBytes();
+    conn.Read(&err);
+    conn.Process();
+    busy_max = std::max(busy_max, pool->InUseBytes() - before);
+    conn.Write(&err);
+    // 和服务器一样，长连接响应写完后再调用一次Process，连接进入空闲，归还缓冲区和arena
+    conn.Process();
+  }
+  size_t idle = pool->InUseBytes() - base;
+  char extra[256];
+  snprintf(extra, sizeof(extra),
+           ",\"conns\":%zu,\"conn_object_bytes\":%zu,\"buffer_bytes_per_idle_conn\":%.1f,"
+           "\"buffer_bytes_per_busy_conn\":%zu",
+           peers.size(), sizeof(HttpConn), peers.empty() ? 0.0 : static_cast<double>(idle) / peers.size(),
+           busy_max);
+  Report("idle_conn_footprint", "keepalive_get", static_cast<int64_t>(peers.size()), 0, extra);
+  conns.clear();
+  for (int fd : peers) {
+    close(fd);
+  }
+}
+
+// 在一个连接上反复处理长连接GET请求，预热后统计每个请求的new/delete次数
+// 请求的解析结果在arena中，缓冲区和arena的内存都从内存池借，预热后都不应再调用new/delete
+void BenchAllocPerRequest() {
+  if (!Selected("alloc_per_request")) {
+    return;
+  }
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    return;
+  }
+  HttpConn::src_dir = g_opt.src_dir.c_str();
+  HttpConn::isET = false;
+  HttpConn conn;
+  sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  conn.Init(fds[1], addr);
+  std::vector<char> drain(1 << 16);
+  auto serve_one = [&] {
+    if (write(fds[0], kGetRequest, sizeof(kGetRequest) - 1) < 0) {
+      return;
+    }
+    int err = 0;
+    conn.Read(&err);
+    conn.Process();
+    conn.Write(&err);
+    // 和服务器一样，长连接响应写完后再调用一次Process，连接进入空闲
+    conn.Process();
+    while (recv(fds[0], drain.data(), drain.size(), MSG_DONTWAIT) > 0) {
+    }
+  };
+  const int kWarmup = 100;
+  const int kRequests = 10000;
+  for (int i = 0; i < kWarmup; ++i) {
+    serve_one();
+  }
+  long long news = g_new_count;
+  long long deletes = g_delete_count;
+  auto begin = BenchClock::now();
+  for (int i = 0; i < kRequests; ++i) {
+    serve_one();
+  }
+  int64_t ns = ElapsedNs(begin);
+  news = g_new_count - news;
+  deletes = g_delete_count - deletes;
+  char extra[128];
+  snprintf(extra, sizeof(extra), ",\"new_per_request\":%.3f,\"delete_per_request\":%.3f",
+           static_cast<double>(news) / kRequests, static_cast<double>(deletes) / kRequests);
+  Report("alloc_per_request", "keepalive_get", kRequests, static_cast<double>(ns) / kRequests, extra);
+  if (news != 0 || deletes != 0) {
+    fprintf(stderr, "alloc_per_request: %lld new / %lld delete in %d requests, expected 0\n",
+            news, deletes, kRequests);
+    g_failed = true;
+  }
+  close(fds[0]);
+}
+
+// 注册时的用户名过滤器：插入kKeys个用户名后，查询同样多个不存在的用户名，统计误判率
+void BenchBloomFilter() {
+  if (!Selected("bloomfilter_query")) {
+    return;
+  }
+  const int kKeys = g_opt.quick ? 100000 : 1000000;
+  const double kRate = 0.01;
+  CountingBloomFilter filter;
+  filter.Init(kKeys, kRate);
+  char key[32];
+  for (int i = 0; i < kKeys; ++i) {
+    int len = snprintf(key, sizeof(key), "user%d", i);
+    filter.Add(key, len);
+  }
+  int false_positives = 0;
+  double ns = MedianNsPerOp(kKeys, [&] {
+    false_positives = 0;
+    auto begin = BenchClock::now();
+    for (int i = 0; i < kKeys; ++i) {
+      int len = snprintf(key, sizeof(key), "new%d", i);
+      false_positives += filter.MayContain(key, len);
+    }
+    return ElapsedNs(begin);
+  });
+  double fp_rate = static_cast<double>(false_positives) / kKeys;
+  char param[32];
+  snprintf(param, sizeof(param), "%dkeys", kKeys);
+  char extra[128];
+  snprintf(extra, sizeof(extra), ",\"false_positive_rate\":%.4f,\"counters\":%zu,\"hashes\":%d",
+           fp_rate, filter.CounterCount(), filter.HashCount());
+  Report("bloomfilter_query", param, kKeys, ns, extra);
+  if (fp_rate > kRate * 2) {
+    fprintf(stderr, "bloomfilter_query: false positive rate %.4f, expected about %.2f\n", fp_rate, kRate);
+    g_failed = true;
+  }
+}
+
+// 按IP限速：同一个IP反复请求（表中只有一个热条目）、25万个IP（表的四分之一）、800万个IP（不断淘汰），
+// 每次Allow的耗时；再检查突发量为20时一个IP连续请求只放行约20个
+void BenchRateLimiter() {
+  if (!Selected("ratelimiter_allow")) {
+    return;
+  }
+  const int kCapacity = 1 << 20;
+  // 类别0的速率足够大，不会拒绝，只测开销；类别1用于检查令牌桶
+  if (!RateLimiter::Instance()->Init(kCapacity, {{100000000, 1000000}, {10, 20}})) {
+    fprintf(stderr, "ratelimiter_allow: init failed\n");
+    g_failed = true;
+    return;
+  }
+  const int n = g_opt.quick ? 1000000 : 4000000;
+  struct Case {
+    const char *param;
+    uint32_t ip_num;
+  };
+  const Case cases[] = {{"1ip", 1}, {"256Kips", 1u << 18}, {"8Mips", 8u << 20}};
+  for (const Case &c : cases) {
+    std::mt19937 rng(42);
+    std::vector<uint32_t> ips(n);
+    for (uint32_t &ip : ips) {
+      ip = rng() % c.ip_num;
+    }
+    uint64_t evictions_before = RateLimiter::Instance()->Evictions();
+    int allowed = 0;
+    double ns = MedianNsPerOp(n, [&] {
+      allowed = 0;
+      auto begin = BenchClock::now();
+      for (uint32_t ip : ips) {
+        allowed += RateLimiter::Instance()->Allow(ip, 0);
+      }
+      return ElapsedNs(begin);
+    });
+    char extra[96];
+    snprintf(extra, sizeof(extra), ",\"allowed\":%d,\"evictions\":%llu", allowed,
+             static_cast<unsigned long long>(RateLimiter::Instance()->Evictions() - evictions_before));
+    Report("ratelimiter_allow", c.param, n, ns, extra);
+  }
+
+  int burst_allowed = 0;
+  for (int i = 0; i < 100; ++i) {
+    burst_allowed += RateLimiter::Instance()->Allow(0x0100007f, 1);
+  }
+  if (burst_allowed < 20 || burst_allowed > 22) {
+    fprintf(stderr, "ratelimiter_allow: burst of 20 allowed %d of 100 requests\n", burst_allowed);
+    g_failed = true;
+  }
+}
+
+// 热点统计：路径流中5个热点共占30%，其余为10万个冷门路径，先单线程计数，再由4个线程分别计数后合并，
+// 检查合并后的前5名正好是5个热点，并且按频率排列
+void BenchHeavyHitters() {
+  if (!Selected("heavyhitters_record")) {
+    return;
+  }
+  const int n = g_opt.quick ? 1000000 : 4000000;
+  const int kHotNum = 5;
+  const int kHotPercent[kHotNum] = {10, 8, 6, 4, 2};
+  const int kColdNum = 100000;
+  std::vector<std::string> keys;
+  for (int i = 0; i < kHotNum; ++i) {
+    keys.push_back("/hot" + std::to_string(i));
+  }
+  for (int i = 0; i < kColdNum; ++i) {
+    keys.push_back("/cold/" + std::to_string(i) + ".html");
+  }
+  std::mt19937 rng(42);
+  std::vector<int> stream(n);
+  for (int &key : stream) {
+    int roll = rng() % 100;
+    key = kHotNum + rng() % kColdNum;
+    for (int i = 0, acc = 0; i < kHotNum; ++i) {
+      acc += kHotPercent[i];
+      if (roll < acc) {
+        key = i;
+        break;
+      }
+    }
+  }
+
+  HeavyHitters single(HeavyHitters::kText);
+  double ns = MedianNsPerOp(n, [&] {
+    auto begin = BenchClock::now();
+    for (int key : stream) {
+      single.Record(keys[key].data(), keys[key].size());
+    }
+    return ElapsedNs(begin);
+  });
+  Report("heavyhitters_record", "1thread", n, ns);
+
+  const int kThreads = 4;
+  HeavyHitters merged(HeavyHitters::kText);
+  auto begin = BenchClock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = t; i < n; i += kThreads) {
+        merged.Record(keys[stream[i]].data(), keys[stream[i]].size());
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  int64_t elapsed = ElapsedNs(begin);
+  auto scrape_begin = BenchClock::now();
+  std::vector<HeavyHitters::Item> top = merged.Top(kHotNum);
+  char extra[64];
+  snprintf(extra, sizeof(extra), ",\"top_us\":%lld", static_cast<long long>(ElapsedNs(scrape_begin) / 1000));
+  Report("heavyhitters_record", "4threads", n, static_cast<double>(elapsed) / n, extra);
+  for (int i = 0; i < kHotNum; ++i) {
+    if (i >= static_cast<int>(top.size()) || top[i].key != keys[i]) {
+      fprintf(stderr, "heavyhitters_record: rank %d is %s, expected %s\n", i,
+              i < static_cast<int>(top.size()) ? top[i].key.c_str() : "(none)", keys[i].c_str());
+      g_failed = true;
+    }
+  }
+}
+
+// 本地用户存储：逐个注册后查询，再重新打开文件，检查回放出的用户数
+void BenchLocalUserStore() {
+  if (!Selected("localuserstore")) {
+    return;
+  }
+  const int kUsers = g_opt.quick ? 20000 : 200000;
+  char path[] = "/tmp/microbench_users_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return;
+  }
+  close(fd);
+  LocalUserStore *store = LocalUserStore::Instance();
+  store->Open(path);
+  char name[32];
+  auto begin = BenchClock::now();
+  for (int i = 0; i < kUsers; ++i) {
+    snprintf(name, sizeof(name), "user%d", i);
+    store->Insert(name, "12345678");
+  }
+  char param[32];
+  snprintf(param, sizeof(param), "%dusers", kUsers);
+  Report("localuserstore_insert", param, kUsers, static_cast<double>(ElapsedNs(begin)) / kUsers);
+  std::string passwd;
+  int found = 0;
+  double ns = MedianNsPerOp(kUsers, [&] {
+    found = 0;
+    auto begin = BenchClock::now();
+    for (int i = 0; i < kUsers; ++i) {
+      snprintf(name, sizeof(name), "user%d", i);
+      found += store->Query(name, &passwd) == UserStore::kOk;
+    }
+    return ElapsedNs(begin);
+  });
+  Report("localuserstore_query", param, kUsers, ns);
+  store->Close();
+  store->Open(path);
+  size_t replayed = store->Size();
+  store->Close();
+  unlink(path);
+  if (found != kUsers || replayed != static_cast<size_t>(kUsers)) {
+    fprintf(stderr, "localuserstore: found %d, replayed %zu, expected %d\n", found, replayed, kUsers);
+    g_failed = true;
+  }
+}
+
+void BenchHeapTimer() {
+  const int sizes[] = {10000, 100000, 1000000};
+  for (int n : sizes) {
+    if (g_opt.quick && n > 100000) {
+      break;
+    }
+    char param[32];
+    snprintf(param, sizeof(param), "%d", n);
+    std::mt19937 rng(n);
+    std::vector<int> timeouts(n);
+    for (int &timeout : timeouts) {
+      timeout = std::uniform_int_distribution<int>(1000, 600000)(rng);
+    }
+    TimeoutCallBack cb = [] {};
+
+    if (Selected("heaptimer_add")) {
+      double ns = MedianNsPerOp(n, [&] {
+        HeapTimer timer;
+        auto begin = BenchClock::now();
+        for (int i = 0; i < n; ++i) {
+          timer.Add(i, timeouts[i], cb);
+        }
+        return ElapsedNs(begin);
+      });
+      Report("heaptimer_add", param, n, ns);
+    }
+
+    if (Selected("heaptimer_adjust")) {
+      HeapTimer timer;
+      for (int i = 0; i < n; ++i) {
+        timer.Add(i, timeouts[i], cb);
+      }
+      double ns = MedianNsPerOp(n, [&] {
+        auto begin = BenchClock::now();
+        for (int i = 0; i < n; ++i) {
+          timer.Adjust(static_cast<int>(rng() % n), timeouts[i]);
+        }
+        return ElapsedNs(begin);
+      });
+      Report("heaptimer_adjust", param, n, ns);
+    }
+
+    if (Selected("heaptimer_tick")) {
+      // 所有节点都已超时，测量Tick逐个弹出并回调的开销
+      double ns = MedianNsPerOp(n, [&] {
+        HeapTimer timer;
+        for (int i = 0; i < n; ++i) {
+          timer.Add(i, -timeouts[i], cb);
+        }
+        auto begin = BenchClock::now();
+        timer.Tick();
+        return ElapsedNs(begin);
+      });
+      Report("heaptimer_tick", param, n, ns);
+    }
+  }
+}
+
+void BenchBlockDeque() {
+  const int pairs[] = {1, 4};
+  const int per_producer = 200000;
+  if (!Selected("blockdeque_push_pop")) {
+    return;
+  }
+  for (int p : pairs) {
+    char param[32];
+    snprintf(param, sizeof(param), "%dp%dc", p, p);
+    int64_t ops = static_cast<int64_t>(p) * per_producer;
+    double ns = MedianNsPerOp(ops, [&] {
+      BlockDeque<int> deque(1024);
+      std::vector<std::thread> threads;
+      auto begin = BenchClock::now();
+      for (int i = 0; i < p; ++i) {
+        threads.emplace_back([&deque] {
+          for (int j = 0; j < per_producer; ++j) {
+            deque.PushBack(j);
+          }
+        });
+        threads.emplace_back([&deque] {
+          int item;
+          for (int j = 0; j < per_producer; ++j) {
+            deque.Pop(item);
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      return ElapsedNs(begin);
+    });
+    Report("blockdeque_push_pop", param, ops, ns);
+  }
+}
+
+void BenchThreadPool() {
+  if (!Selected("threadpool_submit")) {
+    return;
+  }
+  const int threads[] = {1, 6};
+  const int n = 100000;
+  for (int thread_num : threads) {
+    char param[32];
+    snprintf(param, sizeof(param), "%dthreads", thread_num);
+    ThreadPool pool(thread_num);
+    std::vector<uint64_t> counts(LatencyHistogram::kBucketNum, 0);
+    double ns = MedianNsPerOp(n, [&] {
+      // 每个任务记录从提交到开始执行的延迟（纳秒）
+      std::unique_ptr<LatencyHistogram> latency(new LatencyHistogram());
+      std::atomic<int> done(0);
+      auto begin = BenchClock::now();
+      for (int i = 0; i < n; ++i) {
+        auto submitted = BenchClock::now();
+        pool.AddTask([&latency, &done, submitted] {
+          latency->Record(ElapsedNs(submitted));
+          done.fetch_add(1, std::memory_order_release);
+        });
+      }
+      int64_t elapsed = ElapsedNs(begin);
+      while (done.load(std::memory_order_acquire) < n) {
+        std::this_thread::yield();
+      }
+      counts.assign(LatencyHistogram::kBucketNum, 0);
+      latency->MergeTo(counts);
+      return elapsed;
+    });
+    char extra[128];
+    snprintf(extra, sizeof(extra), ",\"start_p50_ns\":%llu,\"start_p99_ns\":%llu",
+             static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.5)),
+             static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.99)));
+    Report("threadpool_submit", param, n, ns, extra);
+  }
+}
+
+// 以线程池处理能力两倍的速率提交任务，比较不限长度、不拒绝的队列和有准入控制（队列上限+CoDel）的队列
+// 中被执行的任务的排队时间
+void BenchThreadPoolShed() {
+  if (!Selected("threadpool_shed")) {
+    return;
+  }
+  const int thread_num = 2;
+  const int64_t task_ns = 50000;   // 每个任务忙等50us，线程池每秒最多处理4万个
+  const int64_t submit_ns = 12500; // 每秒提交8万个
+  const int64_t duration_ns = 1000000000;
+  const bool bounded[] = {false, true};
+  for (bool is_bounded : bounded) {
+    ThreadPool pool(thread_num, is_bounded ? 4096 : 0);
+    std::unique_ptr<LatencyHistogram> wait(new LatencyHistogram());  // 微秒
+    std::atomic<int64_t> finished(0);
+    std::atomic<int64_t> shed(0);
+    int64_t submitted = 0;
+    auto begin = BenchClock::now();
+    while (ElapsedNs(begin) < duration_ns) {
+      if (ElapsedNs(begin) < submitted * submit_ns) {
+        continue;
+      }
+      auto submitted_at = BenchClock::now();
+      std::function<void()> on_shed;
+      if (is_bounded) {
+        on_shed = [&shed, &finished] {
+          shed.fetch_add(1, std::memory_order_relaxed);
+          finished.fetch_add(1, std::memory_order_release);
+        };
+      }
+      bool is_added = pool.TryAddTask([&wait, &finished, submitted_at, task_ns] {
+        wait->Record(ElapsedNs(submitted_at) / 1000);
+        auto start = BenchClock::now();
+        while (ElapsedNs(start) < task_ns) {
+        }
+        finished.fetch_add(1, std::memory_order_release);
+      }, on_shed, ThreadPool::kHigh);
+      if (!is_added) {
+        on_shed();
+      }
+      ++submitted;
+    }
+    while (finished.load(std::memory_order_acquire) < submitted) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int64_t elapsed = ElapsedNs(begin);
+    std::vector<uint64_t> counts(LatencyHistogram::kBucketNum, 0);
+    wait->MergeTo(counts);
+    char extra[160];
+    snprintf(extra, sizeof(extra), ",\"executed\":%lld,\"shed\":%lld,\"wait_p50_us\":%llu,\"wait_p99_us\":%llu",
+             static_cast<long long>(submitted - shed.load()), static_cast<long long>(shed.load()),
+             static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.5)),
+             static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.99)));
+    Report("threadpool_shed", is_bounded ? "bounded_codel" : "unbounded", submitted,
+           static_cast<double>(elapsed) / submitted, extra);
+  }
+}
+
+void BenchLog() {
+  if (!Selected("log_write")) {
+    return;
+  }
+  char dir[] = "/tmp/microbench_log_XXXXXX";
+  if (mkdtemp(dir) == nullptr) {
+    return;
+  }
+  Log::Instance()->Init(1, dir, ".log", 1024);
+  int count = 0;
+  Run("log_write", "async_info", 200000, [&] {
+    LOG_INFO("%s bench line %d ============= ", "Test", ++count);
+  });
+  Run("log_write", "filtered_debug", 200000, [&] {
+    LOG_DEBUG("%s bench line %d ============= ", "Test", ++count);
+  });
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int opt_char;
+  while ((opt_char = getopt(argc, argv, "f:r:qs:")) != -1) {
+    switch (opt_char) {
+      case 'f':g_opt.filter = optarg;
+        break;
+      case 'r':g_opt.repeat = std::max(1, atoi(optarg));
+        break;
+      case 'q':g_opt.quick = true;
+        break;
+      case 's':g_opt.src_dir = optarg;
+        break;
+      default:fprintf(stderr, "Usage: %s [-f filter] [-r repeat] [-q] [-s src_dir]\n", argv[0]);
+        return 1;
+    }
+  }
+  BenchBuffer();
+  BenchHttp();
+  BenchIdleConnFootprint();
+  BenchAllocPerRequest();
+  BenchBloomFilter();
+  BenchRateLimiter();
+  BenchHeavyHitters();
+  BenchLocalUserStore();
+  BenchHeapTimer();
+  BenchBlockDeque();
+  BenchThreadPool();
+  BenchThreadPoolShed();
+  BenchLog();
+  return g_failed ? 1 : 0;
+}
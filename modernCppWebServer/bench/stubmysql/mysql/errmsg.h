@@ -0,0 +1,12 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_ERRMSG_H_
+#define MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_ERRMSG_H_
+
+#define CR_CONN_HOST_ERROR 2003
+#define CR_SERVER_GONE_ERROR 2006
+#define CR_SERVER_LOST 2013
+
+#endif //MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_ERRMSG_H_
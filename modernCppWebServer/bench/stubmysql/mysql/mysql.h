@@ -0,0 +1,112 @@
+//
+// Created by lhm on 2026/10/19.
+//
+// 压测用的MySQL客户端库替身（见stubmysql.cpp），只声明三个服务器实现用到的类型和函数，
+// 函数签名与MySQL 8.0的libmysqlclient一致，编译时把这个目录放在真正的头文件之前即可替换
+
+#ifndef MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_MYSQL_H_
+#define MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_MYSQL_H_
+
+#include <cstddef>
+
+typedef char **MYSQL_ROW;
+
+enum enum_field_types {
+  MYSQL_TYPE_LONG = 3,
+  MYSQL_TYPE_VAR_STRING = 253,
+  MYSQL_TYPE_STRING = 254,
+};
+
+enum mysql_option {
+  MYSQL_OPT_CONNECT_TIMEOUT = 0,
+  MYSQL_OPT_READ_TIMEOUT = 11,
+  MYSQL_OPT_WRITE_TIMEOUT = 12,
+  MYSQL_OPT_RECONNECT = 20,
+};
+
+enum net_async_status {
+  NET_ASYNC_COMPLETE = 0,
+  NET_ASYNC_NOT_READY,
+  NET_ASYNC_ERROR,
+  NET_ASYNC_COMPLETE_NO_MORE_RESULTS,
+};
+
+typedef struct NET {
+  int fd;  // 一直可读的eventfd，供异步接口注册到epoll
+} NET;
+
+typedef struct MYSQL {
+  NET net;
+  void *extension;  // 连接的状态，由stubmysql.cpp管理
+} MYSQL;
+
+typedef struct MYSQL_FIELD {
+  char *name;
+  unsigned long length;
+  enum enum_field_types type;
+} MYSQL_FIELD;
+
+typedef struct MYSQL_RES MYSQL_RES;
+typedef struct MYSQL_STMT MYSQL_STMT;
+
+typedef struct MYSQL_BIND {
+  unsigned long *length;
+  bool *is_null;
+  void *buffer;
+  bool *error;
+  enum enum_field_types buffer_type;
+  unsigned long buffer_length;
+  bool is_unsigned;
+} MYSQL_BIND;
+
+#define MYSQL_NO_DATA 100
+#define MYSQL_DATA_TRUNCATED 101
+
+extern "C" {
+MYSQL *mysql_init(MYSQL *mysql);
+MYSQL *mysql_real_connect(MYSQL *mysql, const char *host, const char *user, const char *passwd,
+                          const char *db, unsigned int port, const char *unix_socket, unsigned long flags);
+int mysql_options(MYSQL *mysql, enum mysql_option option, const void *arg);
+void mysql_close(MYSQL *mysql);
+int mysql_ping(MYSQL *mysql);
+bool mysql_thread_init(void);
+void mysql_thread_end(void);
+void mysql_library_end(void);
+
+int mysql_query(MYSQL *mysql, const char *query);
+int mysql_real_query(MYSQL *mysql, const char *query, unsigned long length);
+MYSQL_RES *mysql_store_result(MYSQL *mysql);
+unsigned int mysql_num_fields(MYSQL_RES *res);
+unsigned long long mysql_num_rows(MYSQL_RES *res);
+MYSQL_FIELD *mysql_fetch_fields(MYSQL_RES *res);
+MYSQL_ROW mysql_fetch_row(MYSQL_RES *res);
+unsigned long *mysql_fetch_lengths(MYSQL_RES *res);
+void mysql_free_result(MYSQL_RES *res);
+unsigned long long mysql_affected_rows(MYSQL *mysql);
+unsigned long mysql_real_escape_string(MYSQL *mysql, char *to, const char *from, unsigned long length);
+const char *mysql_error(MYSQL *mysql);
+unsigned int mysql_errno(MYSQL *mysql);
+
+bool mysql_autocommit(MYSQL *mysql, bool mode);
+bool mysql_commit(MYSQL *mysql);
+bool mysql_rollback(MYSQL *mysql);
+
+enum net_async_status mysql_real_query_nonblocking(MYSQL *mysql, const char *query, unsigned long length);
+enum net_async_status mysql_store_result_nonblocking(MYSQL *mysql, MYSQL_RES **result);
+
+MYSQL_STMT *mysql_stmt_init(MYSQL *mysql);
+int mysql_stmt_prepare(MYSQL_STMT *stmt, const char *query, unsigned long length);
+bool mysql_stmt_bind_param(MYSQL_STMT *stmt, MYSQL_BIND *bind);
+bool mysql_stmt_bind_result(MYSQL_STMT *stmt, MYSQL_BIND *bind);
+int mysql_stmt_execute(MYSQL_STMT *stmt);
+int mysql_stmt_store_result(MYSQL_STMT *stmt);
+int mysql_stmt_fetch(MYSQL_STMT *stmt);
+bool mysql_stmt_free_result(MYSQL_STMT *stmt);
+bool mysql_stmt_reset(MYSQL_STMT *stmt);
+bool mysql_stmt_close(MYSQL_STMT *stmt);
+unsigned long long mysql_stmt_affected_rows(MYSQL_STMT *stmt);
+unsigned int mysql_stmt_errno(MYSQL_STMT *stmt);
+const char *mysql_stmt_error(MYSQL_STMT *stmt);
+}
+
+#endif //MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_MYSQL_H_
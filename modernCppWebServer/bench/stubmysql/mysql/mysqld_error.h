@@ -0,0 +1,10 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_MYSQLD_ERROR_H_
+#define MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_MYSQLD_ERROR_H_
+
+#define ER_DUP_ENTRY 1062
+
+#endif //MODERNCPPWEBSERVER_BENCH_STUBMYSQL_MYSQL_MYSQLD_ERROR_H_
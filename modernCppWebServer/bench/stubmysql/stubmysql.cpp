@@ -0,0 +1,604 @@
+//
+// Created by lhm on 2026/10/19.
+//
+// 压测用的MySQL客户端库替身，编译成libmysqlclient.a后代替真正的客户端库链接到各个服务器实现中，
+// 不需要MySQL服务器就能压测登录和注册，各实现面对的数据库完全相同
+// 数据保存在进程内的一张user表（用户名 -> 密码）中，只认识各实现用到的几种语句：
+//   SELECT <列> FROM user [WHERE username = 'x' | WHERE username > 'x' ORDER BY username] [LIMIT n]
+//   INSERT INTO user(username, passwd) VALUES('x', 'y')[, ('x2', 'y2')...]
+// 其他语句直接成功；预处理语句把参数转义后代入?，再按文本语句执行
+// 通过环境变量配置：
+//   STUBMYSQL_USERS      预置用户bench0..bench<n-1>，密码与用户名相同，默认100
+//   STUBMYSQL_LATENCY_US 每条语句的耗时（模拟数据库的往返时间），默认200
+//   STUBMYSQL_DOWN_FILE  该文件存在时模拟数据库宕机：连接失败，ping和语句返回连接断开的错误
+//   STUBMYSQL_HANG_FILE  该文件存在时模拟数据库卡住：非阻塞查询一直不完成，连接的套接字不再可读
+//   STUBMYSQL_NO_UNIQUE  非空时模拟user.username上没有唯一索引（只影响information_schema的查询结果，插入仍检查重复）
+
+#include "mysql/mysql.h"
+#include "mysql/errmsg.h"
+#include "mysql/mysqld_error.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct MYSQL_RES {
+  std::vector<std::string> names;
+  std::vector<MYSQL_FIELD> fields;
+  std::vector<std::vector<std::string>> rows;
+  size_t next = 0;
+  std::vector<char *> row;  // fetch_row返回的当前行
+  std::vector<unsigned long> lengths;
+};
+
+struct MYSQL_STMT {
+  MYSQL *sql;
+  std::string query;
+  MYSQL_BIND *params = nullptr;
+  MYSQL_BIND *results = nullptr;
+  MYSQL_RES *res = nullptr;
+  unsigned long long affected_rows = 0;
+  unsigned int err = 0;
+  std::string error;
+};
+
+namespace {
+
+// 连接的状态，挂在MYSQL::extension上
+struct Conn {
+  bool owned = false;  // MYSQL结构体是否由mysql_init分配
+  unsigned int err = 0;
+  std::string error;
+  MYSQL_RES *res = nullptr;
+  unsigned long long affected_rows = 0;
+  bool query_started = false;  // 异步查询第一次调用返回NOT_READY，第二次才执行
+};
+
+struct UserTable {
+  std::mutex mtx;
+  std::map<std::string, std::string> users;  // 有序，支持按用户名分批扫描
+};
+
+int EnvInt(const char *name, int default_value) {
+  const char *value = getenv(name);
+  return value != nullptr && *value != '\0' ? atoi(value) : default_value;
+}
+
+UserTable &Table() {
+  static UserTable *table = [] {
+    UserTable *t = new UserTable;
+    int users = EnvInt("STUBMYSQL_USERS", 100);
+    for (int i = 0; i < users; ++i) {
+      std::string name = "bench" + std::to_string(i);
+      t->users[name] = name;
+    }
+    return t;
+  }();
+  return *table;
+}
+
+bool IsDown() {
+  static const char *down_file = getenv("STUBMYSQL_DOWN_FILE");
+  return down_file != nullptr && access(down_file, F_OK) == 0;
+}
+
+bool IsHang() {
+  static const char *hang_file = getenv("STUBMYSQL_HANG_FILE");
+  return hang_file != nullptr && access(hang_file, F_OK) == 0;
+}
+
+void Delay() {
+  static const int latency_us = EnvInt("STUBMYSQL_LATENCY_US", 200);
+  if (latency_us > 0) {
+    usleep(latency_us);
+  }
+}
+
+Conn *ConnOf(MYSQL *sql) {
+  return static_cast<Conn *>(sql->extension);
+}
+
+void SetError(Conn *conn, unsigned int err, const std::string &error) {
+  conn->err = err;
+  conn->error = error;
+}
+
+// 不区分大小写查找关键字
+size_t FindWord(const std::string &query, const char *word, size_t from = 0) {
+  size_t len = strlen(word);
+  for (size_t i = from; i + len <= query.size(); ++i) {
+    if (strncasecmp(query.data() + i, word, len) == 0) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+void SkipSpace(const std::string &query, size_t *pos) {
+  while (*pos < query.size() && (query[*pos] == ' ' || query[*pos] == '\t' || query[*pos] == '\n')) {
+    ++*pos;
+  }
+}
+
+// 读取单引号括起的字符串，处理mysql_real_escape_string产生的反斜杠转义
+bool ReadQuoted(const std::string &query, size_t *pos, std::string *out) {
+  SkipSpace(query, pos);
+  if (*pos >= query.size() || query[*pos] != '\'') {
+    return false;
+  }
+  out->clear();
+  for (size_t i = *pos + 1; i < query.size(); ++i) {
+    char ch = query[i];
+    if (ch == '\\' && i + 1 < query.size()) {
+      char next = query[++i];
+      out->push_back(next == '0' ? '\0' : next == 'n' ? '\n' : next == 'r' ? '\r' : next == 'Z' ? '\032' : next);
+    } else if (ch == '\'') {
+      *pos = i + 1;
+      return true;
+    } else {
+      out->push_back(ch);
+    }
+  }
+  return false;
+}
+
+MYSQL_RES *NewResult(const std::vector<std::string> &columns) {
+  MYSQL_RES *res = new MYSQL_RES;
+  res->names = columns;
+  res->fields.resize(columns.size());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    res->fields[i].name = &res->names[i][0];
+    res->fields[i].length = 255;
+    res->fields[i].type = MYSQL_TYPE_VAR_STRING;
+  }
+  return res;
+}
+
+bool Select(Conn *conn, const std::string &query) {
+  if (FindWord(query, "information_schema") != std::string::npos) {
+    // 检查唯一索引的语句，返回满足条件的索引个数
+    const char *no_unique = getenv("STUBMYSQL_NO_UNIQUE");
+    conn->res = NewResult({"COUNT(*)"});
+    conn->res->rows.push_back({no_unique != nullptr && *no_unique != '\0' ? "0" : "1"});
+    return true;
+  }
+  size_t from = FindWord(query, " FROM ");
+  if (from == std::string::npos) {
+    // 没有FROM的语句（如SELECT 1）返回一行
+    conn->res = NewResult({"1"});
+    conn->res->rows.push_back({"1"});
+    return true;
+  }
+  // 列名逗号分隔，username之外的列都当作密码
+  std::vector<std::string> columns;
+  std::vector<bool> is_name;
+  size_t pos = 6;
+  while (pos < from) {
+    size_t comma = query.find(',', pos);
+    size_t end = comma == std::string::npos || comma > from ? from : comma;
+    std::string column = query.substr(pos, end - pos);
+    column.erase(0, column.find_first_not_of(" \t"));
+    column.erase(column.find_last_not_of(" \t") + 1);
+    columns.push_back(column);
+    is_name.push_back(strcasecmp(column.c_str(), "username") == 0);
+    pos = end + 1;
+  }
+  char op = 0;
+  std::string key;
+  size_t where = FindWord(query, " WHERE ", from);
+  if (where != std::string::npos) {
+    pos = FindWord(query, "username", where);
+    if (pos == std::string::npos) {
+      SetError(conn, 1054, "stub: unsupported WHERE clause");
+      return false;
+    }
+    pos += 8;
+    SkipSpace(query, &pos);
+    op = pos < query.size() ? query[pos++] : 0;
+    if ((op != '=' && op != '>') || !ReadQuoted(query, &pos, &key)) {
+      SetError(conn, 1064, "stub: unsupported WHERE clause");
+      return false;
+    }
+  }
+  size_t limit = static_cast<size_t>(-1);
+  size_t limit_pos = FindWord(query, " LIMIT ", from);
+  if (limit_pos != std::string::npos) {
+    limit = strtoul(query.c_str() + limit_pos + 7, nullptr, 10);
+  }
+
+  MYSQL_RES *res = NewResult(columns);
+  UserTable &table = Table();
+  std::lock_guard<std::mutex> locker(table.mtx);
+  auto it = op == 0 ? table.users.begin() : op == '=' ? table.users.find(key) : table.users.upper_bound(key);
+  for (; it != table.users.end() && res->rows.size() < limit; ++it) {
+    std::vector<std::string> row;
+    for (size_t i = 0; i < columns.size(); ++i) {
+      row.push_back(is_name[i] ? it->first : it->second);
+    }
+    res->rows.push_back(row);
+    if (op == '=') {
+      break;
+    }
+  }
+  conn->res = res;
+  return true;
+}
+
+// 多行插入中任何一行的用户名已存在时整条语句失败，和唯一索引的行为一致
+bool Insert(Conn *conn, const std::string &query) {
+  size_t pos = FindWord(query, "VALUES");
+  if (pos == std::string::npos) {
+    SetError(conn, 1064, "stub: unsupported INSERT");
+    return false;
+  }
+  pos += 6;
+  std::vector<std::pair<std::string, std::string>> rows;
+  while (true) {
+    SkipSpace(query, &pos);
+    if (pos >= query.size() || query[pos] != '(') {
+      break;
+    }
+    ++pos;
+    std::string name;
+    std::string pwd;
+    if (!ReadQuoted(query, &pos, &name)) {
+      SetError(conn, 1064, "stub: unsupported INSERT");
+      return false;
+    }
+    SkipSpace(query, &pos);
+    if (pos >= query.size() || query[pos++] != ',' || !ReadQuoted(query, &pos, &pwd)) {
+      SetError(conn, 1064, "stub: unsupported INSERT");
+      return false;
+    }
+    SkipSpace(query, &pos);
+    if (pos >= query.size() || query[pos++] != ')') {
+      SetError(conn, 1064, "stub: unsupported INSERT");
+      return false;
+    }
+    rows.emplace_back(name, pwd);
+    SkipSpace(query, &pos);
+    if (pos < query.size() && query[pos] == ',') {
+      ++pos;
+    }
+  }
+  UserTable &table = Table();
+  std::lock_guard<std::mutex> locker(table.mtx);
+  for (size_t i = 0; i < rows.size(); ++i) {
+    bool duplicate = table.users.count(rows[i].first) > 0;
+    for (size_t j = 0; j < i && !duplicate; ++j) {
+      duplicate = rows[j].first == rows[i].first;
+    }
+    if (duplicate) {
+      SetError(conn, ER_DUP_ENTRY, "Duplicate entry '" + rows[i].first + "' for key 'user.username'");
+      return false;
+    }
+  }
+  for (auto &row : rows) {
+    table.users[row.first] = row.second;
+  }
+  conn->affected_rows = rows.size();
+  return true;
+}
+
+// 执行一条文本语句，结果留在连接上等待store_result取走，成功返回0
+int Execute(MYSQL *sql, const std::string &query) {
+  Conn *conn = ConnOf(sql);
+  mysql_free_result(conn->res);
+  conn->res = nullptr;
+  conn->affected_rows = 0;
+  SetError(conn, 0, "");
+  Delay();
+  if (IsDown()) {
+    SetError(conn, CR_SERVER_LOST, "Lost connection to MySQL server during query");
+    return 1;
+  }
+  size_t begin = query.find_first_not_of(" \t\n(");
+  if (begin == std::string::npos) {
+    SetError(conn, 1065, "Query was empty");
+    return 1;
+  }
+  bool ok = true;
+  if (strncasecmp(query.c_str() + begin, "SELECT", 6) == 0) {
+    ok = Select(conn, query.substr(begin));
+  } else if (strncasecmp(query.c_str() + begin, "INSERT", 6) == 0) {
+    ok = Insert(conn, query.substr(begin));
+  }
+  return ok ? 0 : 1;
+}
+
+} // namespace
+
+extern "C" {
+
+MYSQL *mysql_init(MYSQL *mysql) {
+  bool owned = mysql == nullptr;
+  if (owned) {
+    mysql = new MYSQL;
+  }
+  mysql->net.fd = -1;
+  Conn *conn = new Conn;
+  conn->owned = owned;
+  mysql->extension = conn;
+  return mysql;
+}
+
+MYSQL *mysql_real_connect(MYSQL *mysql, const char *, const char *, const char *, const char *, unsigned int,
+                          const char *, unsigned long) {
+  Table();
+  if (IsDown()) {
+    SetError(ConnOf(mysql), CR_CONN_HOST_ERROR, "Can't connect to MySQL server");
+    return nullptr;
+  }
+  mysql->net.fd = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+  return mysql;
+}
+
+int mysql_options(MYSQL *, enum mysql_option, const void *) {
+  return 0;
+}
+
+void mysql_close(MYSQL *mysql) {
+  if (mysql == nullptr) {
+    return;
+  }
+  Conn *conn = ConnOf(mysql);
+  if (mysql->net.fd >= 0) {
+    close(mysql->net.fd);
+  }
+  mysql_free_result(conn->res);
+  bool owned = conn->owned;
+  delete conn;
+  if (owned) {
+    delete mysql;
+  }
+}
+
+int mysql_ping(MYSQL *mysql) {
+  if (IsDown()) {
+    SetError(ConnOf(mysql), CR_SERVER_GONE_ERROR, "MySQL server has gone away");
+    return 1;
+  }
+  SetError(ConnOf(mysql), 0, "");
+  return 0;
+}
+
+bool mysql_thread_init(void) {
+  return false;
+}
+
+void mysql_thread_end(void) {
+}
+
+void mysql_library_end(void) {
+}
+
+int mysql_query(MYSQL *mysql, const char *query) {
+  return Execute(mysql, query);
+}
+
+int mysql_real_query(MYSQL *mysql, const char *query, unsigned long length) {
+  return Execute(mysql, std::string(query, length));
+}
+
+MYSQL_RES *mysql_store_result(MYSQL *mysql) {
+  Conn *conn = ConnOf(mysql);
+  MYSQL_RES *res = conn->res;
+  conn->res = nullptr;
+  return res;
+}
+
+unsigned int mysql_num_fields(MYSQL_RES *res) {
+  return res->fields.size();
+}
+
+unsigned long long mysql_num_rows(MYSQL_RES *res) {
+  return res->rows.size();
+}
+
+MYSQL_FIELD *mysql_fetch_fields(MYSQL_RES *res) {
+  return res->fields.data();
+}
+
+MYSQL_ROW mysql_fetch_row(MYSQL_RES *res) {
+  if (res == nullptr || res->next >= res->rows.size()) {
+    return nullptr;
+  }
+  std::vector<std::string> &row = res->rows[res->next++];
+  res->row.resize(row.size());
+  res->lengths.resize(row.size());
+  for (size_t i = 0; i < row.size(); ++i) {
+    res->row[i] = &row[i][0];
+    res->lengths[i] = row[i].size();
+  }
+  return res->row.data();
+}
+
+unsigned long *mysql_fetch_lengths(MYSQL_RES *res) {
+  return res->lengths.data();
+}
+
+void mysql_free_result(MYSQL_RES *res) {
+  delete res;
+}
+
+unsigned long long mysql_affected_rows(MYSQL *mysql) {
+  return ConnOf(mysql)->affected_rows;
+}
+
+unsigned long mysql_real_escape_string(MYSQL *, char *to, const char *from, unsigned long length) {
+  char *out = to;
+  for (unsigned long i = 0; i < length; ++i) {
+    switch (from[i]) {
+      case '\0':*out++ = '\\';
+        *out++ = '0';
+        break;
+      case '\n':*out++ = '\\';
+        *out++ = 'n';
+        break;
+      case '\r':*out++ = '\\';
+        *out++ = 'r';
+        break;
+      case '\032':*out++ = '\\';
+        *out++ = 'Z';
+        break;
+      case '\'':
+      case '"':
+      case '\\':*out++ = '\\';
+        *out++ = from[i];
+        break;
+      default:*out++ = from[i];
+    }
+  }
+  *out = '\0';
+  return out - to;
+}
+
+const char *mysql_error(MYSQL *mysql) {
+  return ConnOf(mysql)->error.c_str();
+}
+
+unsigned int mysql_errno(MYSQL *mysql) {
+  return ConnOf(mysql)->err;
+}
+
+bool mysql_autocommit(MYSQL *, bool) {
+  return false;
+}
+
+bool mysql_commit(MYSQL *) {
+  return false;
+}
+
+bool mysql_rollback(MYSQL *) {
+  return false;
+}
+
+enum net_async_status mysql_real_query_nonblocking(MYSQL *mysql, const char *query, unsigned long length) {
+  Conn *conn = ConnOf(mysql);
+  if (IsHang()) {
+    // 读空eventfd，之后套接字一直不可读，查询停在这里
+    uint64_t count = 0;
+    if (read(mysql->net.fd, &count, sizeof(count)) < 0) {
+      count = 0;
+    }
+    conn->query_started = true;
+    return NET_ASYNC_NOT_READY;
+  }
+  if (!conn->query_started) {
+    conn->query_started = true;
+    return NET_ASYNC_NOT_READY;
+  }
+  conn->query_started = false;
+  return Execute(mysql, std::string(query, length)) == 0 ? NET_ASYNC_COMPLETE : NET_ASYNC_ERROR;
+}
+
+enum net_async_status mysql_store_result_nonblocking(MYSQL *mysql, MYSQL_RES **result) {
+  *result = mysql_store_result(mysql);
+  return NET_ASYNC_COMPLETE;
+}
+
+MYSQL_STMT *mysql_stmt_init(MYSQL *mysql) {
+  MYSQL_STMT *stmt = new MYSQL_STMT;
+  stmt->sql = mysql;
+  return stmt;
+}
+
+int mysql_stmt_prepare(MYSQL_STMT *stmt, const char *query, unsigned long length) {
+  stmt->query.assign(query, length);
+  return 0;
+}
+
+bool mysql_stmt_bind_param(MYSQL_STMT *stmt, MYSQL_BIND *bind) {
+  stmt->params = bind;
+  return false;
+}
+
+bool mysql_stmt_bind_result(MYSQL_STMT *stmt, MYSQL_BIND *bind) {
+  stmt->results = bind;
+  return false;
+}
+
+// 参数转义后代入?，按文本语句执行
+int mysql_stmt_execute(MYSQL_STMT *stmt) {
+  std::string query;
+  int param = 0;
+  for (char ch : stmt->query) {
+    if (ch != '?') {
+      query.push_back(ch);
+      continue;
+    }
+    MYSQL_BIND &bind = stmt->params[param++];
+    unsigned long len = bind.length != nullptr ? *bind.length : bind.buffer_length;
+    std::string escaped(2 * len + 1, '\0');
+    escaped.resize(mysql_real_escape_string(stmt->sql, &escaped[0], static_cast<const char *>(bind.buffer), len));
+    query += "'" + escaped + "'";
+  }
+  mysql_free_result(stmt->res);
+  int ret = Execute(stmt->sql, query);
+  Conn *conn = ConnOf(stmt->sql);
+  stmt->res = mysql_store_result(stmt->sql);
+  stmt->affected_rows = conn->affected_rows;
+  stmt->err = conn->err;
+  stmt->error = conn->error;
+  return ret;
+}
+
+int mysql_stmt_store_result(MYSQL_STMT *) {
+  return 0;
+}
+
+int mysql_stmt_fetch(MYSQL_STMT *stmt) {
+  MYSQL_ROW row = mysql_fetch_row(stmt->res);
+  if (row == nullptr) {
+    return MYSQL_NO_DATA;
+  }
+  bool truncated = false;
+  for (size_t i = 0; i < stmt->res->row.size(); ++i) {
+    MYSQL_BIND &bind = stmt->results[i];
+    unsigned long len = stmt->res->lengths[i];
+    if (bind.length != nullptr) {
+      *bind.length = len;
+    }
+    if (bind.is_null != nullptr) {
+      *bind.is_null = false;
+    }
+    memcpy(bind.buffer, row[i], len < bind.buffer_length ? len : bind.buffer_length);
+    truncated = truncated || len > bind.buffer_length;
+  }
+  return truncated ? MYSQL_DATA_TRUNCATED : 0;
+}
+
+bool mysql_stmt_free_result(MYSQL_STMT *stmt) {
+  mysql_free_result(stmt->res);
+  stmt->res = nullptr;
+  return false;
+}
+
+bool mysql_stmt_reset(MYSQL_STMT *stmt) {
+  return mysql_stmt_free_result(stmt);
+}
+
+bool mysql_stmt_close(MYSQL_STMT *stmt) {
+  mysql_free_result(stmt->res);
+  delete stmt;
+  return false;
+}
+
+unsigned long long mysql_stmt_affected_rows(MYSQL_STMT *stmt) {
+  return stmt->affected_rows;
+}
+
+unsigned int mysql_stmt_errno(MYSQL_STMT *stmt) {
+  return stmt->err;
+}
+
+const char *mysql_stmt_error(MYSQL_STMT *stmt) {
+  return stmt->error.c_str();
+}
+
+} // extern "C"
@@ -0,0 +1,246 @@
+#!/bin/bash
+# 横向对比仓库中的几个服务器实现：TinyWebServer、TinyWebServer-master、WebServer-master、modernCppWebServer
+# 各实现用同样的编译选项编译，链接bench/stubmysql中的MySQL客户端库替身（进程内的user表，每条语句固定耗时），
+# 不需要MySQL服务器；依次在本机端口上启动，每个负载重启一次服务器，用loadgen跑相同的负载：
+#   small_keepalive  GET 1KB的静态页面，长连接
+#   small_close      同上，每个请求新建连接
+#   large_keepalive  GET较大的静态文件（LARGE_KB），长连接
+#   login_keepalive  POST登录（用户bench0..bench99），长连接
+# 采集吞吐、延迟分位数，以及服务器进程在压测期间的CPU占用（/proc/<pid>/stat）和峰值RSS（VmHWM），
+# 结果输出为表格，同时写入$WORK/report.md和$WORK/report.csv；压测中服务器退出时该行的状态记为server died，不输出数据
+#
+# 用法：bench/variants.sh，可用环境变量调整：
+#   WORK          编译和运行目录（默认/tmp/webserver-variants）
+#   VARIANTS      要对比的实现（默认"tiny tiny-master webserver-master modern"）
+#   WORKLOADS     要跑的负载（默认全部）
+#   DURATION      每个负载的时长（秒，默认10，另有1秒预热）
+#   CONNS         连接数（默认64）
+#   THREADS       服务器工作线程数（默认4）
+#   LOAD_THREADS  loadgen线程数（默认2）
+#   LARGE_KB      大文件的大小（默认1024）
+#   PORT          监听端口（默认9100）
+#   STUBMYSQL_LATENCY_US  每条SQL语句的耗时（默认200）
+
+set -u
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+MODERN=$ROOT/modernCppWebServer
+STUB_INC=$MODERN/bench/stubmysql
+WORK=${WORK:-/tmp/webserver-variants}
+VARIANTS=${VARIANTS:-"tiny tiny-master webserver-master modern"}
+WORKLOADS=${WORKLOADS:-"small_keepalive small_close large_keepalive login_keepalive"}
+DURATION=${DURATION:-10}
+CONNS=${CONNS:-64}
+THREADS=${THREADS:-4}
+LOAD_THREADS=${LOAD_THREADS:-2}
+LARGE_KB=${LARGE_KB:-1024}
+PORT=${PORT:-9100}
+export STUBMYSQL_LATENCY_US=${STUBMYSQL_LATENCY_US:-200}
+CXXFLAGS="-O2 -I$STUB_INC"
+LIBS="-L$WORK/stub -lmysqlclient -pthread"
+
+BIN=$WORK/bin
+mkdir -p "$WORK/stub" "$BIN" "$WORK/run" || exit 1
+BUILD_LOG=$WORK/build.log
+: > "$BUILD_LOG"
+
+die() {
+    echo "$*" >&2
+    exit 1
+}
+
+# 编译输出（各实现原有的警告很多）写入build.log，失败时打印最后几行
+build_failed() {
+    tail -20 "$BUILD_LOG" >&2
+    die "$1 build failed, see $BUILD_LOG"
+}
+
+# MySQL客户端库替身和modernCppWebServer（连同loadgen）
+build_common() {
+    echo "building stubmysql, modernCppWebServer and loadgen" >&2
+    g++ -std=c++11 $CXXFLAGS -c "$STUB_INC/stubmysql.cpp" -o "$WORK/stub/stubmysql.o" >> "$BUILD_LOG" 2>&1 \
+        || build_failed stubmysql
+    rm -f "$WORK/stub/libmysqlclient.a"
+    ar rcs "$WORK/stub/libmysqlclient.a" "$WORK/stub/stubmysql.o" || exit 1
+    cmake -S "$MODERN" -B "$WORK/build/modern" -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_FLAGS_RELEASE=-O2 \
+          -DMYSQL_INCLUDE_DIR="$STUB_INC" -DMYSQL_LIBRARY="$WORK/stub/libmysqlclient.a" >> "$BUILD_LOG" 2>&1 \
+        && cmake --build "$WORK/build/modern" -j"$(nproc)" --target modernCppWebServer loadgen >> "$BUILD_LOG" 2>&1 \
+        || build_failed modernCppWebServer
+    cp "$WORK/build/modern/modernCppWebServer" "$BIN/modern"
+    cp "$WORK/build/modern/loadgen" "$BIN/loadgen"
+}
+
+build_variant() {
+    echo "building $1" >&2
+    case $1 in
+        tiny)
+            (cd "$ROOT/TinyWebServer" && g++ -std=c++14 $CXXFLAGS -I. \
+                $(ls *.cpp */*.cpp | grep -v block_queue.cpp) -o "$BIN/tiny" $LIBS) ;;
+        tiny-master)
+            (cd "$ROOT/TinyWebServer-master" && g++ -std=c++14 $CXXFLAGS main.cpp timer/lst_timer.cpp \
+                http/http_conn.cpp log/log.cpp CGImysql/sql_connection_pool.cpp webserver.cpp config.cpp \
+                -o "$BIN/tiny-master" $LIBS) ;;
+        webserver-master)
+            # 原来的main写死了端口和线程数，并打开了日志，这里换成从命令行读取、关闭日志的main
+            cat > "$WORK/webserver_master_main.cpp" <<'MAIN'
+#include <cstdlib>
+#include "server/webserver.h"
+
+int main(int argc, char *argv[]) {
+    WebServer server(atoi(argv[1]), 3, 60000, false, 3306, "root", "root", "webserver",
+                     12, atoi(argv[2]), false, 1, 1024);
+    server.Start();
+}
+MAIN
+            (cd "$ROOT/WebServer-master/code" && g++ -std=c++14 $CXXFLAGS -I. "$WORK/webserver_master_main.cpp" \
+                log/*.cpp pool/*.cpp timer/*.cpp http/*.cpp server/*.cpp buffer/*.cpp \
+                -o "$BIN/webserver-master" $LIBS) ;;
+        modern)
+            true ;;
+        *)
+            die "unknown variant $1" ;;
+    esac >> "$BUILD_LOG" 2>&1 || build_failed $1
+}
+
+# 运行目录：静态文件目录是各实现自带页面的符号链接，再加上所有实现共用的small.html和large.html
+prepare_run_dir() {
+    local dir=$WORK/run/$1 src
+    case $1 in
+        tiny) src=$ROOT/TinyWebServer/root; docs=root ;;
+        tiny-master) src=$ROOT/TinyWebServer-master/root; docs=root ;;
+        webserver-master) src=$ROOT/WebServer-master/resources; docs=resources ;;
+        modern) src=$MODERN/resources; docs=resources ;;
+    esac
+    rm -rf "$dir"
+    mkdir -p "$dir"
+    cp -rs "$src" "$dir/$docs"
+    {
+        echo "<html><head><title>small</title></head><body>"
+        head -c 900 /dev/zero | tr '\0' 'x'
+        echo "</body></html>"
+    } > "$dir/$docs/small.html"
+    head -c $((LARGE_KB * 1024)) /dev/zero | tr '\0' 'y' > "$dir/$docs/large.html"
+    chmod 644 "$dir/$docs/small.html" "$dir/$docs/large.html"
+}
+
+start_server() {
+    (
+        cd "$WORK/run/$1" || exit 1
+        case $1 in
+            tiny) exec "$BIN/tiny" -p $PORT -t $THREADS -m 3 -c 1 ;;
+            tiny-master) exec "$BIN/tiny-master" -p $PORT -t $THREADS -m 3 -c 1 ;;
+            webserver-master) exec "$BIN/webserver-master" $PORT $THREADS ;;
+            modern) WEBSERVER_PORT=$PORT WEBSERVER_THREADS=$THREADS WEBSERVER_LOG=0 WEBSERVER_RATE_LIMIT=0 exec "$BIN/modern" ;;
+        esac
+    ) > "$WORK/run/$1/server.out" 2>&1 &
+    SERVER_PID=$!
+    for i in $(seq 1 100); do
+        if (exec 3<>/dev/tcp/127.0.0.1/$PORT) 2>/dev/null; then
+            return 0
+        fi
+        kill -0 $SERVER_PID 2>/dev/null || break
+        sleep 0.1
+    done
+    return 1
+}
+
+stop_server() {
+    kill $SERVER_PID 2>/dev/null
+    for i in $(seq 1 30); do
+        kill -0 $SERVER_PID 2>/dev/null || break
+        sleep 0.1
+    done
+    kill -9 $SERVER_PID 2>/dev/null
+    wait $SERVER_PID 2>/dev/null
+}
+
+# 各实现登录接口的路径和用户名字段不同
+workload_args() {
+    case $2 in
+        small_keepalive) echo "-u /small.html -k 1" ;;
+        small_close) echo "-u /small.html -k 0" ;;
+        large_keepalive) echo "-u /large.html -k 1" ;;
+        login_keepalive)
+            case $1 in
+                tiny|tiny-master) echo "-l 1 -L /2CGISQL.cgi -U user -k 1" ;;
+                *) echo "-l 1 -L /login.html -U username -k 1" ;;
+            esac ;;
+        *) die "unknown workload $2" ;;
+    esac
+}
+
+# 服务器是本脚本的子进程，退出后在wait之前是僵尸进程，kill -0仍然成功，所以还要看进程状态
+server_alive() {
+    kill -0 $SERVER_PID 2>/dev/null && [ "$(awk '{print $3}' /proc/$SERVER_PID/stat 2>/dev/null)" != Z ]
+}
+
+cpu_ticks() {
+    awk '{print $14 + $15}' /proc/$1/stat 2>/dev/null || echo 0
+}
+
+field() {
+    echo "$1" | sed -n "s/.*\"$2\":\([0-9.]*\).*/\1/p"
+}
+
+build_common
+for variant in $VARIANTS; do
+    build_variant $variant
+done
+
+HZ=$(getconf CLK_TCK)
+CSV=$WORK/report.csv
+MD=$WORK/report.md
+echo "variant,workload,rps,p50_us,p99_us,cpu_pct,rps_per_core,peak_rss_mb,errors,non_2xx,status" > "$CSV"
+{
+    echo "| variant | workload | req/s | p50 us | p99 us | CPU % | req/s per core | peak RSS MB | errors | non-2xx | status |"
+    echo "|---|---|---:|---:|---:|---:|---:|---:|---:|---:|---|"
+} > "$MD"
+printf "%-17s %-16s %10s %8s %8s %7s %10s %8s %7s %7s  %s\n" variant workload req/s p50_us p99_us cpu% \
+       rps/core rss_mb errors non2xx status
+for variant in $VARIANTS; do
+    prepare_run_dir $variant
+    for workload in $WORKLOADS; do
+        if ! start_server $variant; then
+            echo "$variant: server did not start, see $WORK/run/$variant/server.out" >&2
+            stop_server
+            continue
+        fi
+        ticks0=$(cpu_ticks $SERVER_PID)
+        t0=$(date +%s.%N)
+        json=$("$BIN/loadgen" -P $PORT -c $CONNS -t $LOAD_THREADS -d $DURATION -w 1 \
+               $(workload_args $variant $workload) -j | tail -1)
+        t1=$(date +%s.%N)
+        # 压测中服务器崩溃时/proc下已读不到CPU时间和峰值内存，记为失败而不是输出一行0
+        if ! server_alive; then
+            echo "$variant: server died during $workload, see $WORK/run/$variant/server.out" >&2
+            stop_server
+            printf "%-17s %-16s %10s %8s %8s %7s %10s %8s %7s %7s  %s\n" $variant $workload - - - - - - - - \
+                   "server died"
+            echo "$variant,$workload,,,,,,,,,server died" >> "$CSV"
+            echo "| $variant | $workload | - | - | - | - | - | - | - | - | server died |" >> "$MD"
+            continue
+        fi
+        ticks1=$(cpu_ticks $SERVER_PID)
+        rss_kb=$(awk '/VmHWM/ {print $2}' /proc/$SERVER_PID/status 2>/dev/null)
+        stop_server
+        rps=$(field "$json" rps)
+        row=$(awk -v rps="${rps:-0}" -v p50="$(field "$json" p50_us)" -v p99="$(field "$json" p99_us)" \
+                  -v ticks=$((ticks1 - ticks0)) -v hz=$HZ -v t0=$t0 -v t1=$t1 -v rss="${rss_kb:-0}" \
+                  -v errors="$(field "$json" errors)" -v c4="$(field "$json" status_4xx)" \
+                  -v c5="$(field "$json" status_5xx)" -v timeouts="$(field "$json" timeouts)" \
+                  'BEGIN {
+                       cpu = ticks / hz / (t1 - t0) * 100
+                       per_core = 0
+                       if (cpu > 0) {
+                           per_core = rps / (cpu / 100)
+                       }
+                       printf "%.0f %s %s %.0f %.0f %.1f %d %d", rps, p50, p99, cpu, per_core,
+                              rss / 1024, errors + timeouts, c4 + c5
+                   }')
+        set -- $row
+        printf "%-17s %-16s %10s %8s %8s %7s %10s %8s %7s %7s  %s\n" $variant $workload "$@" ok
+        echo "$variant,$workload,$1,$2,$3,$4,$5,$6,$7,$8,ok" >> "$CSV"
+        echo "| $variant | $workload | $1 | $2 | $3 | $4 | $5 | $6 | $7 | $8 | ok |" >> "$MD"
+    done
+done
+echo "report written to $MD and $CSV" >&2
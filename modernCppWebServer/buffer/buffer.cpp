@@ -4,14 +4,25 @@
 
 #include "buffer.h"
 
+const size_t Buffer::kMinReadSize;
+const size_t Buffer::kMaxReadHint;
+
+// 构造时先取一次内存池，保证内存池先于缓冲区构造完成，程序退出时后于静态对象（如日志）中的缓冲区析构
 Buffer::Buffer(int init_buffer_size)
-    : buffer_(init_buffer_size), read_pos_(0), write_pos_(0) {}
+    : buffer_(nullptr), capacity_(0), init_size_(init_buffer_size), read_pos_(0), write_pos_(0),
+      last_read_(0) {
+  BufferPool::Instance();
+}
+
+Buffer::~Buffer() {
+  BufferPool::Instance()->Release(buffer_, capacity_);
+}
 
 // 返回可读取的内容长度，即已写入长度减已读长度为未读长度
 size_t Buffer::ReadableBytes() const { return write_pos_ - read_pos_; }
 
 // 返回剩下可写入的空间大小，即缓冲区总大小减去已写入大小
-size_t Buffer::WritableBytes() const { return buffer_.size() - write_pos_; }
+size_t Buffer::WritableBytes() const { return capacity_ - write_pos_; }
 
 // 返回已读的可以重新写入的大小，即返回已读的位置
 size_t Buffer::PrependableBytes() const { return read_pos_; }
@@ -31,9 +42,9 @@ void Buffer::RetrieveUntil(const char *end) {
   Retrieve(end - Peek());
 }
 
-// 清空所有缓存，将已读已写长度置为0，将缓存空间内容全清0
+// 清空所有缓存，将已读已写长度置为0
+// 原来还会将整个缓冲区清零，缓冲区的内容只通过读写位置访问，清零是多余的开销
 void Buffer::RetrieveAll() {
-  bzero(&buffer_[0], buffer_.size());
   read_pos_ = 0;
   write_pos_ = 0;
 }
@@ -45,6 +56,17 @@ std::string Buffer::RetrieveAllToStr() {
   return str;
 }
 
+// 缓冲区没有未读内容时，将存储空间归还内存池
+void Buffer::Release() {
+  if (buffer_ != nullptr && ReadableBytes() == 0) {
+    BufferPool::Instance()->Release(buffer_, capacity_);
+    buffer_ = nullptr;
+    capacity_ = 0;
+    read_pos_ = 0;
+    write_pos_ = 0;
+  }
+}
+
 // 返回写入位置的指针，即起始指针向后移动已写长度，const版
 const char *Buffer::BeginWriteConst() const { return BeginPtr_() + write_pos_; }
 
@@ -61,6 +83,12 @@ void Buffer::Append(const std::string &str) {
   Append(str.data(), str.length());
 }
 
+// 向缓冲区写入以'\0'结尾的字符串
+void Buffer::Append(const char *str) {
+  assert(str);
+  Append(str, strlen(str));
+}
+
 // 从缓存区内写入指针str指向的len长个的字节
 void Buffer::Append(const void *data, size_t len) {
   assert(data);
@@ -92,34 +120,27 @@ void Buffer::EnsureWritable(size_t len) {
 }
 
 // 从文件描述符fd中读取内容到缓冲区，并保存可能出现的错误码，返回读取的字节数
+// 原来用readv同时读入缓冲区和栈上64KB的临时空间，超出缓冲区的部分要再经Append拷贝一次
+// 现在先确定这次大概要读多少：可写空间放得下最近一次读到的量时直接读，
+// 否则用FIONREAD向内核询问可读的字节数，一次扩容到位，数据从内核直接拷贝到缓冲区
 ssize_t Buffer::ReadFd(int fd, int *save_errno) {
-  char buff[65535]; // 开辟一个足够大的临时缓冲区（64kb）
-  struct iovec iov[2];
-  const size_t writable = WritableBytes(); // 缓冲区的可写长度
-  // 原作者注释
-  /* 分散读，保证数据全部读完 */
-  iov[0].iov_base =
-      BeginPtr_() + write_pos_; // BeginWrite()，写入缓冲区的开始位置
-  iov[0].iov_len = writable;    // 可写的长度
-  // 设置临时缓冲区
-  iov[1].iov_base = buff; //
-  iov[1].iov_len = sizeof(buff);
-
-  // 同时从fd中读取内容到临时缓冲区和对象自己的缓存区
-  const ssize_t len = readv(fd, iov, 2);
+  if (WritableBytes() < std::max(last_read_, kMinReadSize)) {
+    int pending = 0;
+    if (ioctl(fd, FIONREAD, &pending) < 0 || pending < 0) {
+      pending = 0; // 不支持FIONREAD的文件描述符，只按最近的读取量估计
+    }
+    EnsureWritable(std::max({static_cast<size_t>(pending), last_read_, kMinReadSize}));
+  }
+  const ssize_t len = read(fd, BeginWrite(), WritableBytes());
   if (len < 0) {
     // 如果读取失败，保存错误码
     *save_errno = errno;
-  } else if (static_cast<size_t>(len) <= writable) {
-    // 如果读取的字节数小于可写的缓冲区空间
-    // 往后写len字节（其实在readv已经写入，这里将写入位置的标识移动）
-    write_pos_ += len;
   } else {
-    // 如果读取的字节数大于可写的缓冲区空间
-    // 将写入位置移动到最后，调用Append从临时缓冲区中把没有写入的内容写入到缓存区
-    // （Append内部调用MakeSpace_分配足够的空间，再将写位置从当前位置后移）
-    write_pos_ = buffer_.size();
-    Append(buff, len - writable);
+    // 往后写len字节（其实在read已经写入，这里将写入位置的标识移动）
+    write_pos_ += len;
+    if (len > 0) {
+      last_read_ = std::min(static_cast<size_t>(len), kMaxReadHint);
+    }
   }
   return len;
 }
@@ -141,17 +162,26 @@ ssize_t Buffer::WriteFd(int fd, int *save_errno) {
 
 // 返回缓冲区的起始地址字符指针
 char *Buffer::BeginPtr_() {
-  return &*buffer_.begin(); // vector第一个元素的地址
+  return buffer_;
 }
 
 // 返回缓冲区的起始地址字符指针
-const char *Buffer::BeginPtr_() const { return &*buffer_.begin(); }
+const char *Buffer::BeginPtr_() const { return buffer_; }
 
 // 为缓冲区腾出len大小的空间
 void Buffer::MakeSpace_(size_t len) {
   if (WritableBytes() + PrependableBytes() < len) {
-    // 如果可写的空间加上已读的可以重新写入的空间不足len，则为缓冲区容器重新分配空间
-    buffer_.resize(write_pos_ + len + 1);
+    // 如果可写的空间加上已读的可以重新写入的空间不足len，则从内存池借一块更大的空间
+    // 按两倍增长，新空间不清零，只拷贝未读的内容，已读的部分直接丢弃，原来的空间归还内存池
+    size_t readable = ReadableBytes();
+    size_t new_capacity = std::max({capacity_ * 2, readable + len, init_size_});
+    char *new_buffer = BufferPool::Instance()->Acquire(new_capacity, &new_capacity);
+    std::copy(BeginPtr_() + read_pos_, BeginPtr_() + write_pos_, new_buffer);
+    BufferPool::Instance()->Release(buffer_, capacity_);
+    buffer_ = new_buffer;
+    capacity_ = new_capacity;
+    read_pos_ = 0;
+    write_pos_ = readable;
   } else {
     // 获取未读的大小
     size_t readable = ReadableBytes();
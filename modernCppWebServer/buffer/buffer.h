@@ -6,19 +6,23 @@
 #define MODERNCPPWEBSERVER_BUFFER_H
 
 #include <algorithm>
-#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <sys/ioctl.h>
 #include <sys/uio.h>
 #include <unistd.h>
-#include <vector>
 
+#include "bufferpool.h"
+
+// 缓冲区的存储空间从BufferPool借用，第一次写入时才借出，调用Release()后归还
 class Buffer {
 public:
   Buffer(int init_buffer_size = 1024);
-  ~Buffer() = default;
+  ~Buffer();
+  Buffer(const Buffer &) = delete;
+  Buffer &operator=(const Buffer &) = delete;
 
   // 返回剩下可写入的空间大小，为缓冲区总大小减去已写入大小
   size_t WritableBytes() const;
@@ -39,10 +43,14 @@ public:
   // 向后检索直到传入的*end指针位置
   void RetrieveUntil(const char *end);
 
-  // 清空所有缓存，将已读已写长度置为0，将缓存空间内容全清0
+  // 清空所有缓存，将已读已写长度置为0
   void RetrieveAll();
   // 检索出所有未读的数据，以string类型返回，并清空所有缓存
   std::string RetrieveAllToStr();
+  // 缓冲区没有未读内容时，将存储空间归还内存池，下次写入时再借
+  void Release();
+  // 返回当前占用的存储空间大小，未借用时为0
+  size_t Capacity() const { return capacity_; }
 
   // 返回写入位置的指针，即起始指针向后移动已写长度，const版
   const char *BeginWriteConst() const;
@@ -50,6 +58,8 @@ public:
   char *BeginWrite();
 
   void Append(const std::string &str); // 向缓冲区写入字符串str
+  // 向缓冲区写入以'\0'结尾的字符串，直接传字符串常量时不再构造临时的string
+  void Append(const char *str);
   // 从缓存区内写入指针str指向的len长个的字节
   void Append(const char *str, size_t len);
   // 从缓存区内写入指针str指向的len长个的字节
@@ -70,11 +80,20 @@ private:
   // 为缓冲区腾出len大小的空间
   void MakeSpace_(size_t len);
 
-  std::vector<char> buffer_; // 存放缓冲区的数据
-  // 已经读取缓冲区的字节数，即下一个读取的位置下标
-  std::atomic<std::size_t> read_pos_;
+  // 一个缓冲区同一时刻只属于一个连接（EPOLLONESHOT保证同一时刻只有一个线程处理该连接），
+  // 日志的缓冲区则在锁内访问，所以读写位置不需要用原子变量
+  char *buffer_; // 存放缓冲区的数据，从内存池借用，没有借用时为空指针
+  size_t capacity_; // 缓冲区总大小
+  size_t init_size_; // 第一次借用时至少借的大小
   // 已经读取缓冲区的字节数，即下一个读取的位置下标
-  std::atomic<std::size_t> write_pos_;
+  size_t read_pos_;
+  // 已经写入缓冲区的字节数，即下一个写入的位置下标
+  size_t write_pos_;
+  // 最近一次ReadFd读到的字节数，用于估计下一次读取需要的空间
+  size_t last_read_;
+
+  static const size_t kMinReadSize = 512;      // 每次读取至少保证的可写空间
+  static const size_t kMaxReadHint = 65536;    // 按最近读取量预留空间的上限
 };
 
 #endif // MODERNCPPWEBSERVER_BUFFER_H
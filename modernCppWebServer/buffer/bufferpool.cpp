@@ -0,0 +1,79 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "bufferpool.h"
+
+const size_t BufferPool::kMinClassSize;
+const size_t BufferPool::kMaxCachedPerClass;
+
+// 创建静态内存池对象，单例模式获取对象的方法
+BufferPool *BufferPool::Instance() {
+  static BufferPool pool;
+  return &pool;
+}
+
+BufferPool::~BufferPool() {
+  for (auto &size_class : classes_) {
+    for (char *block : size_class.free_blocks) {
+      delete[] block;
+    }
+  }
+}
+
+// 返回能容纳size字节的最小级别
+int BufferPool::ClassIndex_(size_t size) {
+  int index = 0;
+  size_t class_size = kMinClassSize;
+  while (class_size < size && index < kClassNum) {
+    class_size <<= 1;
+    ++index;
+  }
+  return index;
+}
+
+// 借出一块至少size字节的内存，优先从对应级别的空闲块中取，没有时再申请
+char *BufferPool::Acquire(size_t size, size_t *capacity) {
+  int index = ClassIndex_(size);
+  char *block = nullptr;
+  if (index == kClassNum) {
+    // 超过最大级别，按需申请，不经过池
+    *capacity = size;
+    block = new char[size];
+  } else {
+    *capacity = kMinClassSize << index;
+    SizeClass &size_class = classes_[index];
+    {
+      std::lock_guard<std::mutex> locker(size_class.mtx);
+      if (!size_class.free_blocks.empty()) {
+        block = size_class.free_blocks.back();
+        size_class.free_blocks.pop_back();
+        cached_bytes_.fetch_sub(*capacity, std::memory_order_relaxed);
+      }
+    }
+    if (block == nullptr) {
+      block = new char[*capacity];
+    }
+  }
+  in_use_bytes_.fetch_add(*capacity, std::memory_order_relaxed);
+  return block;
+}
+
+// 归还内存，对应级别缓存的空闲块未超过上限时放回池中，否则直接释放
+void BufferPool::Release(char *block, size_t capacity) {
+  if (block == nullptr) {
+    return;
+  }
+  in_use_bytes_.fetch_sub(capacity, std::memory_order_relaxed);
+  int index = ClassIndex_(capacity);
+  if (index < kClassNum && (kMinClassSize << index) == capacity) {
+    SizeClass &size_class = classes_[index];
+    std::lock_guard<std::mutex> locker(size_class.mtx);
+    if ((size_class.free_blocks.size() + 1) * capacity <= kMaxCachedPerClass) {
+      size_class.free_blocks.push_back(block);
+      cached_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+      return;
+    }
+  }
+  delete[] block;
+}
@@ -0,0 +1,53 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_BUFFER_BUFFERPOOL_H_
+#define MODERNCPPWEBSERVER_BUFFER_BUFFERPOOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// 所有连接共享的缓冲区内存池，按2的幂分为1KB到1MB共11个大小级别
+// 连接有数据要读写时借出一块，缓冲区读空后归还，空闲的长连接不再占用缓冲区内存
+// 每个级别缓存的空闲块总大小有上限，超过1MB的块不缓存，直接申请释放
+class BufferPool {
+ public:
+  // 创建静态内存池对象，单例模式获取对象的方法
+  static BufferPool *Instance();
+
+  // 借出一块至少size字节的内存，实际大小写入*capacity
+  char *Acquire(size_t size, size_t *capacity);
+  // 归还Acquire借出的内存，capacity为借出时得到的大小
+  void Release(char *block, size_t capacity);
+
+  // 借出未归还的内存总量
+  size_t InUseBytes() const { return in_use_bytes_.load(std::memory_order_relaxed); }
+  // 池中缓存的空闲内存总量
+  size_t CachedBytes() const { return cached_bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  BufferPool() = default;
+  ~BufferPool();
+
+  // 返回能容纳size字节的最小级别，超过最大级别时返回kClassNum
+  static int ClassIndex_(size_t size);
+
+  static const size_t kMinClassSize = 1024;
+  static const int kClassNum = 11;                     // 1KB, 2KB, ..., 1MB
+  static const size_t kMaxCachedPerClass = 8 << 20;    // 每个级别最多缓存8MB的空闲块
+
+  // 每个级别一把锁，不同级别之间不竞争
+  struct alignas(64) SizeClass {
+    std::mutex mtx;
+    std::vector<char *> free_blocks;
+  };
+
+  SizeClass classes_[kClassNum];
+  std::atomic<size_t> in_use_bytes_{0};
+  std::atomic<size_t> cached_bytes_{0};
+};
+
+#endif //MODERNCPPWEBSERVER_BUFFER_BUFFERPOOL_H_
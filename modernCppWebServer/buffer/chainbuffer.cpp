@@ -0,0 +1,186 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "chainbuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sys/ioctl.h>
+
+const size_t ChainBuffer::kBlockSize;
+const int ChainBuffer::kMaxIovec;
+const int ChainBuffer::kMaxReadBlocks;
+const size_t ChainBuffer::kMaxSpare;
+
+ChainBuffer::~ChainBuffer() {
+  for (Block *block : blocks_) {
+    delete block;
+  }
+  for (Block *block : spare_) {
+    delete block;
+  }
+}
+
+// 在尾部追加len个字节，先填满尾块剩余的空间，再依次申请新块
+void ChainBuffer::Append(const char *data, size_t len) {
+  while (len > 0) {
+    if (blocks_.empty() || blocks_.back()->write_pos == kBlockSize) {
+      blocks_.push_back(NewBlock_());
+    }
+    Block *tail = blocks_.back();
+    size_t n = std::min(len, kBlockSize - tail->write_pos);
+    memcpy(tail->data + tail->write_pos, data, n);
+    tail->write_pos += n;
+    readable_ += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::Append(const std::string &str) {
+  Append(str.data(), str.size());
+}
+
+// 丢弃开头len个字节，整块读完的块放回空闲块中
+void ChainBuffer::Retrieve(size_t len) {
+  assert(len <= readable_);
+  readable_ -= len;
+  while (len > 0) {
+    Block *head = blocks_.front();
+    size_t n = std::min(len, head->write_pos - head->read_pos);
+    head->read_pos += n;
+    len -= n;
+    if (head->read_pos == head->write_pos) {
+      blocks_.pop_front();
+      FreeBlock_(head);
+    }
+  }
+}
+
+void ChainBuffer::RetrieveAll() {
+  for (Block *block : blocks_) {
+    FreeBlock_(block);
+  }
+  blocks_.clear();
+  readable_ = 0;
+}
+
+std::string ChainBuffer::RetrieveAllToStr() {
+  std::string str;
+  str.reserve(readable_);
+  for (Block *block : blocks_) {
+    str.append(block->data + block->read_pos, block->write_pos - block->read_pos);
+  }
+  RetrieveAll();
+  return str;
+}
+
+// 将可读内容依次填入iov，最多填max个
+int ChainBuffer::PeekIovec(struct iovec *iov, int max) const {
+  int count = 0;
+  for (auto it = blocks_.begin(); it != blocks_.end() && count < max; ++it) {
+    Block *block = *it;
+    if (block->write_pos == block->read_pos) {
+      continue;
+    }
+    iov[count].iov_base = block->data + block->read_pos;
+    iov[count].iov_len = block->write_pos - block->read_pos;
+    ++count;
+  }
+  return count;
+}
+
+// 用readv从fd读入尾块剩余空间和若干新块中
+// 先用FIONREAD询问内核可读的字节数，按需准备新块（至少一个，最多kMaxReadBlocks个），
+// 读完后把没有用到的块放回空闲块，数据只从内核拷贝一次
+ssize_t ChainBuffer::ReadFd(int fd, int *save_errno) {
+  struct iovec iov[kMaxReadBlocks + 1];
+  Block *fresh[kMaxReadBlocks];
+  int count = 0;
+  Block *tail = blocks_.empty() ? nullptr : blocks_.back();
+  if (tail != nullptr && tail->write_pos < kBlockSize) {
+    iov[count].iov_base = tail->data + tail->write_pos;
+    iov[count].iov_len = kBlockSize - tail->write_pos;
+    ++count;
+  } else {
+    tail = nullptr;
+  }
+  int pending = 0;
+  if (ioctl(fd, FIONREAD, &pending) < 0 || pending < 0) {
+    pending = 0;
+  }
+  size_t tail_space = count > 0 ? iov[0].iov_len : 0;
+  size_t need = static_cast<size_t>(pending) > tail_space ? pending - tail_space : 0;
+  int fresh_num = static_cast<int>((need + kBlockSize - 1) / kBlockSize);
+  fresh_num = std::max(1, std::min(fresh_num, kMaxReadBlocks));
+  int first_fresh = count;
+  for (int i = 0; i < fresh_num; ++i) {
+    fresh[i] = NewBlock_();
+    iov[count].iov_base = fresh[i]->data;
+    iov[count].iov_len = kBlockSize;
+    ++count;
+  }
+
+  const ssize_t len = readv(fd, iov, count);
+  if (len < 0) {
+    *save_errno = errno;
+  }
+  size_t left = len > 0 ? static_cast<size_t>(len) : 0;
+  readable_ += left;
+  if (tail != nullptr) {
+    size_t n = std::min(left, iov[0].iov_len);
+    tail->write_pos += n;
+    left -= n;
+  }
+  for (int i = 0; i < fresh_num; ++i) {
+    if (left > 0) {
+      size_t n = std::min(left, iov[first_fresh + i].iov_len);
+      fresh[i]->write_pos = n;
+      left -= n;
+      blocks_.push_back(fresh[i]);
+    } else {
+      FreeBlock_(fresh[i]);
+    }
+  }
+  return len;
+}
+
+// 用writev向fd写出可读内容，一次最多kMaxIovec个块，返回后丢弃已写出的部分
+ssize_t ChainBuffer::WriteFd(int fd, int *save_errno) {
+  struct iovec iov[kMaxIovec];
+  int count = PeekIovec(iov, kMaxIovec);
+  if (count == 0) {
+    return 0;
+  }
+  const ssize_t len = writev(fd, iov, count);
+  if (len < 0) {
+    *save_errno = errno;
+    return len;
+  }
+  Retrieve(len);
+  return len;
+}
+
+// 优先复用空闲块，没有时再分配
+ChainBuffer::Block *ChainBuffer::NewBlock_() {
+  if (spare_.empty()) {
+    return new Block;
+  }
+  Block *block = spare_.back();
+  spare_.pop_back();
+  return block;
+}
+
+// 块放回空闲块前重置读写位置，超过kMaxSpare个时直接释放
+void ChainBuffer::FreeBlock_(Block *block) {
+  if (spare_.size() >= kMaxSpare) {
+    delete block;
+    return;
+  }
+  block->read_pos = 0;
+  block->write_pos = 0;
+  spare_.push_back(block);
+}
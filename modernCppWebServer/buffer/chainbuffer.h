@@ -0,0 +1,74 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_BUFFER_CHAINBUFFER_H_
+#define MODERNCPPWEBSERVER_BUFFER_CHAINBUFFER_H_
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <vector>
+
+// 由固定大小的块串成的缓冲区，写入时只在尾部追加新块，不需要整体扩容和拷贝
+// 可读内容以iovec数组的形式给出，直接用于readv/writev
+// 和Buffer一样同一时刻只属于一个线程，不加锁
+// 目前只在bench/microbench中和Buffer对比，服务器没有使用：响应是状态行和响应头（不到1KB，在Buffer中）
+// 加上mmap的文件，已经用两个iovec的writev零拷贝发出；日志经stdio的缓冲写文件，也不走writev；
+// 请求的读入在microbench中Buffer更快（4KB、64KB两档都是），换成ChainBuffer没有收益
+class ChainBuffer {
+ public:
+  static const size_t kBlockSize = 4096;  // 每个块的数据大小
+  static const int kMaxIovec = 64;        // 一次writev最多提交的块数
+  static const int kMaxReadBlocks = 16;   // 一次readv最多新用的块数
+
+  ChainBuffer() = default;
+  ~ChainBuffer();
+  ChainBuffer(const ChainBuffer &) = delete;
+  ChainBuffer &operator=(const ChainBuffer &) = delete;
+
+  // 返回可读取的内容长度
+  size_t ReadableBytes() const { return readable_; }
+
+  // 在尾部追加len个字节，尾块写满后申请新块
+  void Append(const char *data, size_t len);
+  void Append(const std::string &str);
+
+  // 丢弃开头len个字节，读完的块放回空闲块中
+  void Retrieve(size_t len);
+  // 清空所有内容
+  void RetrieveAll();
+  // 取出所有可读内容并清空，用于需要连续内容的地方
+  std::string RetrieveAllToStr();
+
+  // 将可读内容依次填入iov，最多填max个，返回填入的个数
+  int PeekIovec(struct iovec *iov, int max) const;
+
+  // 用readv从fd读入尾块剩余空间和若干新块中，新块的个数按FIONREAD得到的可读字节数决定
+  // 返回读取的字节数，失败时保存错误码
+  ssize_t ReadFd(int fd, int *save_errno);
+  // 用writev向fd写出可读内容，返回写出的字节数，失败时保存错误码
+  ssize_t WriteFd(int fd, int *save_errno);
+
+ private:
+  struct Block {
+    size_t read_pos = 0;   // 块内下一个读取的位置
+    size_t write_pos = 0;  // 块内下一个写入的位置
+    char data[kBlockSize];
+  };
+
+  // 优先复用空闲块，没有时再分配
+  Block *NewBlock_();
+  // 块用完后放回空闲块中，超过kMaxSpare个时直接释放
+  void FreeBlock_(Block *block);
+
+  static const size_t kMaxSpare = 4;
+
+  std::deque<Block *> blocks_;  // 按顺序存放有内容的块，只有最后一个块可以继续写入
+  std::vector<Block *> spare_;  // 空闲块，避免连接反复读写时频繁申请释放内存
+  size_t readable_ = 0;
+};
+
+#endif //MODERNCPPWEBSERVER_BUFFER_CHAINBUFFER_H_
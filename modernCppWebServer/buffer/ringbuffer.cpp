@@ -0,0 +1,106 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "ringbuffer.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+RingBuffer::~RingBuffer() {
+  if (base_ != nullptr) {
+    munmap(base_, capacity_ * 2);
+  }
+}
+
+// 先保留两倍容量的连续虚拟地址，再把同一个memfd固定映射到前后两半
+bool RingBuffer::Init(size_t capacity) {
+  assert(base_ == nullptr);
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t size = page_size;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  int fd = static_cast<int>(syscall(SYS_memfd_create, "ringbuffer", 0));
+  if (fd < 0) {
+    return false;
+  }
+  if (ftruncate(fd, size) < 0) {
+    close(fd);
+    return false;
+  }
+  void *addr = mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  char *base = static_cast<char *>(addr);
+  if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+      || mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(base, size * 2);
+    close(fd);
+    return false;
+  }
+  close(fd);  // 映射建立后不再需要文件描述符
+  base_ = base;
+  capacity_ = size;
+  read_pos_ = 0;
+  write_pos_ = 0;
+  return true;
+}
+
+void RingBuffer::Retrieve(size_t len) {
+  assert(len <= ReadableBytes());
+  read_pos_ += len;
+}
+
+// 读写位置回到开头，之后的读写从缓冲区开头开始，减少跨过映射边界的次数
+void RingBuffer::RetrieveAll() {
+  read_pos_ = 0;
+  write_pos_ = 0;
+}
+
+std::string RingBuffer::RetrieveAllToStr() {
+  std::string str(Peek(), ReadableBytes());
+  RetrieveAll();
+  return str;
+}
+
+bool RingBuffer::Append(const char *data, size_t len) {
+  if (len > WritableBytes()) {
+    return false;
+  }
+  memcpy(BeginWrite(), data, len);
+  HasWritten(len);
+  return true;
+}
+
+// 写入位置之后的剩余空间总是连续的，一次read即可
+ssize_t RingBuffer::ReadFd(int fd, int *save_errno) {
+  size_t writable = WritableBytes();
+  if (writable == 0) {
+    *save_errno = ENOBUFS;
+    return -1;
+  }
+  const ssize_t len = read(fd, BeginWrite(), writable);
+  if (len < 0) {
+    *save_errno = errno;
+    return len;
+  }
+  HasWritten(len);
+  return len;
+}
+
+ssize_t RingBuffer::WriteFd(int fd, int *save_errno) {
+  const ssize_t len = write(fd, Peek(), ReadableBytes());
+  if (len < 0) {
+    *save_errno = errno;
+    return len;
+  }
+  Retrieve(len);
+  return len;
+}
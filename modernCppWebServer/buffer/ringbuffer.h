@@ -0,0 +1,63 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_BUFFER_RINGBUFFER_H_
+#define MODERNCPPWEBSERVER_BUFFER_RINGBUFFER_H_
+
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+
+// 镜像环形缓冲区：用memfd创建一块内存，在相邻的两段虚拟地址上各映射一次，
+// 读写位置绕回开头时，从读位置开始的可读内容在虚拟地址上依然是连续的，
+// 不需要像普通环形缓冲区那样拆成两段，也不需要像Buffer那样把未读内容搬回开头
+// 容量固定（向上取整到页大小的整数倍），写满后不会扩容，适合读入大小有上限的内容
+class RingBuffer {
+ public:
+  RingBuffer() = default;
+  ~RingBuffer();
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  // 分配并映射至少capacity字节的空间，失败（如系统不支持memfd）时返回false
+  bool Init(size_t capacity);
+  bool IsInit() const { return base_ != nullptr; }
+
+  size_t Capacity() const { return capacity_; }
+  // 返回可读取的内容长度
+  size_t ReadableBytes() const { return write_pos_ - read_pos_; }
+  // 返回剩下可写入的空间大小
+  size_t WritableBytes() const { return capacity_ - ReadableBytes(); }
+
+  // 返回可读内容的起始地址，之后的ReadableBytes()个字节是连续的
+  const char *Peek() const { return base_ + (read_pos_ & (capacity_ - 1)); }
+  // 返回写入位置的地址，之后的WritableBytes()个字节是连续的
+  char *BeginWrite() { return base_ + (write_pos_ & (capacity_ - 1)); }
+  // 标识向后写了len个字节
+  void HasWritten(size_t len) { write_pos_ += len; }
+
+  // 检索len个字节，即读位置向后移动len
+  void Retrieve(size_t len);
+  // 清空所有内容
+  void RetrieveAll();
+  // 检索出所有未读的数据，以string类型返回，并清空所有内容
+  std::string RetrieveAllToStr();
+
+  // 写入len个字节，空间不足时返回false且不写入
+  bool Append(const char *data, size_t len);
+
+  // 从fd读入内容，最多读满剩余空间，返回读取的字节数，失败时保存错误码
+  ssize_t ReadFd(int fd, int *save_errno);
+  // 向fd写出可读内容，返回写出的字节数，失败时保存错误码
+  ssize_t WriteFd(int fd, int *save_errno);
+
+ private:
+  char *base_ = nullptr;  // 第一段映射的起始地址，第二段紧随其后
+  size_t capacity_ = 0;   // 页大小的整数倍，且为2的幂，读写位置直接取模
+  // 读写位置只增不减，两者之差即为可读的字节数
+  size_t read_pos_ = 0;
+  size_t write_pos_ = 0;
+};
+
+#endif //MODERNCPPWEBSERVER_BUFFER_RINGBUFFER_H_
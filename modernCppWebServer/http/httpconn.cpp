@@ -8,8 +8,11 @@
 bool HttpConn::isET;
 const char *HttpConn::src_dir;
 std::atomic<int> HttpConn::user_count;
+bool HttpConn::open_metrics;
 
-HttpConn::HttpConn() : fd_(-1), addr_({0}), is_close_(true) {
+HttpConn::HttpConn()
+    : fd_(-1), addr_({0}), is_close_(true), request_(&arena_),
+      is_first_write_(false), is_queued_(false), is_access_pending_(false), queue_us_(0), parse_us_(0), verify_ticket_(0), access_({0}) {
 
 }
 
@@ -22,6 +25,7 @@ void HttpConn::Init(int sock_fd, const sockaddr_in &addr) {
   assert(sock_fd > 0);
   // 连接用户+1
   ++user_count;
+  Metrics::Instance()->Add(Metrics::kConnOpened);
   // 设置客户地址
   addr_ = addr;
   // 设置套接字文件描述符
@@ -29,6 +33,13 @@ void HttpConn::Init(int sock_fd, const sockaddr_in &addr) {
   // 清空读缓重区和写缓冲区
   write_buff_.RetrieveAll();
   read_buff_.RetrieveAll();
+  // 重置访问记录，客户端ip只在连接建立时转换一次
+  access_ = {0};
+  inet_ntop(AF_INET, &addr_.sin_addr, access_.ip, sizeof(access_.ip));
+  is_queued_ = false;
+  is_access_pending_ = false;
+  is_first_write_ = true;
+  accepted_at_ = std::chrono::steady_clock::now();
   // 设置打开标识，写入日志
   is_close_ = false;
   LOG_INFO("Client[%d](%s:%d) in, user_count:%d", fd_, GetIP(), GetPort(), (int) user_count);
@@ -42,8 +53,18 @@ void HttpConn::Close() {
     // 如果连接是开启状态，则置为关闭状态，用户数减1，关闭套接字，记下日志
     is_close_ = true;
     --user_count;
-    close(fd_);
+    Metrics::Instance()->Add(Metrics::kConnClosed);
+    // 关闭后连接对象仍留在服务器的用户表中，把缓冲区的空间还给内存池
+    write_buff_.RetrieveAll();
+    read_buff_.RetrieveAll();
+    write_buff_.Release();
+    read_buff_.Release();
+    request_.Init();
+    arena_.Release();
     LOG_INFO("Client[%d](%s:%d) quit, user_count:%d", fd_, GetIP(), GetPort(), (int) user_count);
+    // 最后才关闭套接字：关闭后主线程可能马上接受一个复用这个fd的新连接，在同一个对象上Init并交给工作线程读取，
+    // 之前对缓冲区和arena的清理必须已经完成
+    close(fd_);
   }
 }
 
@@ -69,6 +90,11 @@ int HttpConn::GetPort() const {
 
 // 将套接字的内容（即请求的内容）读入读缓存区，并设置错误码（如果出错）
 ssize_t HttpConn::Read(int *save_errno) {
+  if (is_queued_) {
+    // 线程池中的工作线程开始处理读事件，记下排队时间
+    is_queued_ = false;
+    queue_us_ = ElapsedUs_(queued_at_, std::chrono::steady_clock::now());
+  }
   ssize_t len = -1;
   do {
     // 循环读取，直到读取的长度小于0（读取完毕）
@@ -76,6 +102,7 @@ ssize_t HttpConn::Read(int *save_errno) {
     if (len <= 0) {
       break;
     }
+    Metrics::Instance()->Add(Metrics::kBytesIn, len);
   } while (isET);
   return len;
 }
@@ -90,6 +117,12 @@ ssize_t HttpConn::Write(int *save_errno) {
       *save_errno = errno;
       break;
     }
+    Metrics::Instance()->Add(Metrics::kBytesOut, len);
+    if (is_first_write_) {
+      is_first_write_ = false;
+      Metrics::Instance()->RecordLatency(Metrics::kFirstByte,
+          ElapsedUs_(accepted_at_, std::chrono::steady_clock::now()));
+    }
     if (iov_[0].iov_len + iov_[1].iov_len == 0) {
       // 如果要发送的长度为0
       break; /* 原作者注释， 传输结束 */
@@ -115,34 +148,90 @@ ssize_t HttpConn::Write(int *save_errno) {
     }
   } while (ToWriteBytes()> 0);
   // } while (isET || ToWriteBytes() > 10240);
+  if (ToWriteBytes() == 0) {
+    // 响应发送完毕，写缓冲区已空，归还空间，等待下一个请求的长连接不占用写缓冲区
+    write_buff_.Release();
+    LogAccess_();
+  }
   return len;
 }
 
 // 处理http请求，并根据请求处理好响应内容，将待写入套接字的通道接入对应位置（第一个为写缓冲区，第二个为响应内容内存的映射
 bool HttpConn::Process() {
   if (request_.State() == HttpRequest::kFinish) {
-    // 如果请求处于结束（上一个请求结束）状态，初始化请求对象
+    // 如果请求处于结束（上一个请求结束）状态，初始化请求对象，上一个请求在arena中的内容一次性丢弃
     request_.Init();
+    arena_.Reset();
   }
   if (read_buff_.ReadableBytes() <= 0) {
     // 如果读缓冲区为空，说明没有从套接字读入数据，返回false
+    if (request_.State() == HttpRequest::kRequestLine) {
+      // 没有解析到一半的请求，连接进入空闲，把arena的内存块还给内存池
+      arena_.Release();
+    }
     return false;
   }
   // 解析HTTP请求
+  TimePoint parse_begin = std::chrono::steady_clock::now();
   HttpRequest::HttpCode process_state = request_.Parse(read_buff_);
-  if (process_state == HttpRequest::kGetRequest) {
-    // 如果是get请求，用解析出的请求路径初始化响应（src_dir在服务器主类中初始化）
-    LOG_DEBUG("request path %s", request_.Path().c_str());
-    response_.Init(src_dir, request_.Path(), request_.IsKeepAlive(), 200);
-  } else if (process_state == HttpRequest::kNoRequest) {
+  TimePoint parse_end = std::chrono::steady_clock::now();
+  // 读缓冲区中的请求已全部解析完时归还空间，只收到部分请求时继续保留
+  read_buff_.Release();
+  if (process_state == HttpRequest::kNoRequest) {
     // 如果解析出没有请求，直接返回
     return false;
+  }
+  Metrics::Instance()->RecordLatency(Metrics::kParse, ElapsedUs_(parse_begin, parse_end));
+  parse_us_ = ElapsedUs_(parse_begin, parse_end);
+  handler_begin_ = parse_end;
+  if (process_state == HttpRequest::kGetRequest && request_.IsVerifyPending()) {
+    // 登录/注册请求等待异步验证，由服务器提交给SqlAsync，完成后调用FinishVerify生成响应
+    return false;
+  }
+  return MakeResponse_(process_state);
+}
+
+// 异步验证完成后生成响应
+bool HttpConn::FinishVerify(bool is_verified, bool is_unavailable) {
+  request_.FinishVerify(is_verified, is_unavailable);
+  return MakeResponse_(HttpRequest::kGetRequest);
+}
+
+// 根据解析结果生成响应，将待写入套接字的通道接入对应位置
+bool HttpConn::MakeResponse_(HttpRequest::HttpCode process_state) {
+  bool is_metrics = false;
+  if (process_state == HttpRequest::kGetRequest && IsMetricsRequest_()) {
+    // 本机对统计页面的请求，响应体在内存中生成
+    std::string body;
+    Metrics::Instance()->Render(body);
+    response_.Init(src_dir, request_.Path().c_str(), request_.IsKeepAlive(), 200);
+    response_.MakeTextResponse(write_buff_, body);
+    is_metrics = true;
+  } else if (process_state == HttpRequest::kGetRequest && request_.IsUnavailable()) {
+    // 登录/注册时取不到数据库连接，返回503让客户端稍后重试，而不是让工作线程一直等下去
+    response_.Init(src_dir, request_.Path().c_str(), request_.IsKeepAlive(), 503);
+  } else if (process_state == HttpRequest::kGetRequest) {
+    // 如果是get请求，用解析出的请求路径初始化响应（src_dir在服务器主类中初始化）
+    LOG_DEBUG("request path %s", request_.Path().c_str());
+    response_.Init(src_dir, request_.Path().c_str(), request_.IsKeepAlive(), 200);
+    if (!request_.SetCookie().empty()) {
+      // 登录/注册成功，把新会话的令牌交给客户端
+      response_.SetCookie(request_.SetCookie().c_str());
+    }
   } else {
     // 否则用400错误号初始化响应对象
-    response_.Init(src_dir, request_.Path(), false, 400);
+    response_.Init(src_dir, request_.Path().c_str(), false, 400);
+  }
+  // 向写缓冲区写入响应内容，统计页面已在上面生成
+  if (!is_metrics) {
+    response_.MakeResponse(write_buff_);
+  }
+  Metrics::Instance()->AddStatus(response_.Code());
+  if (open_metrics && !request_.Path().empty()) {
+    HeavyHitters::Paths()->Record(request_.Path().data, request_.Path().size);
   }
-  // 向写缓冲区写入响应内容
-  response_.MakeResponse(write_buff_);
+  write_begin_ = std::chrono::steady_clock::now();
+  Metrics::Instance()->RecordLatency(Metrics::kMakeResponse, ElapsedUs_(handler_begin_, write_begin_));
   // 将通道1指向写缓冲区顶部（待读取的位置）
   iov_[0].iov_base = const_cast<char *>(write_buff_.Peek());
   // 将写入内容长度置为写缓冲区可读内容
@@ -155,9 +244,59 @@ bool HttpConn::Process() {
     iov_[1].iov_len = response_.FileLen();
     iov_cnt_ = 2;
   }
+
+  // 记下访问记录中请求相关的字段，耗时在发送完毕时补全
+  std::strncpy(access_.method, request_.Method().c_str(), sizeof(access_.method) - 1);
+  std::strncpy(access_.path, request_.Path().c_str(), sizeof(access_.path) - 1);
+  access_.status = response_.Code();
+  access_.bytes = ToWriteBytes();
+  access_.keep_alive = request_.IsKeepAlive();
+  ++access_.request_count;
+  access_.queue_us = queue_us_;
+  access_.parse_us = parse_us_;
+  access_.handler_us = ElapsedUs_(handler_begin_, write_begin_);
+  queue_us_ = 0;
+  is_access_pending_ = true;
   return true;
 }
 
+// 记录读事件放入线程池的时刻，由主线程在添加任务前调用，用于统计排队时间
+void HttpConn::MarkQueued() {
+  if (AccessLog::Instance()->IsOpen()) {
+    queued_at_ = std::chrono::steady_clock::now();
+    is_queued_ = true;
+  }
+}
+
+// 判断是否为本机客户端（127.0.0.0/8）对统计页面的请求
+bool HttpConn::IsMetricsRequest_() const {
+  return open_metrics && request_.Method() == "GET" && request_.Path() == "/metrics"
+      && (ntohl(addr_.sin_addr.s_addr) >> 24) == 127;
+}
+
+// 返回两个时间点间隔的微秒数
+uint32_t HttpConn::ElapsedUs_(const TimePoint &begin, const TimePoint &end) {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+}
+
+// 响应全部发送完毕后，记录发送耗时，并按采样率将访问记录放入访问日志
+void HttpConn::LogAccess_() {
+  if (!is_access_pending_) {
+    return;
+  }
+  is_access_pending_ = false;
+  access_.write_us = ElapsedUs_(write_begin_, std::chrono::steady_clock::now());
+  Metrics::Instance()->RecordLatency(Metrics::kWrite, access_.write_us);
+  AccessLog *access_log = AccessLog::Instance();
+  if (!access_log->IsOpen() || !access_log->ShouldSample(access_.status)) {
+    return;
+  }
+  access_.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  access_log->Push(access_);
+}
+
 
 
 
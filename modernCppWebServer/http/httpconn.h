@@ -10,10 +10,14 @@
 #include <arpa/inet.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <chrono>
 
 #include "../log/log.h"
-#include "../pool/sqlconnRAII.h"
+#include "../log/accesslog.h"
+#include "../metrics/metrics.h"
+#include "../metrics/heavyhitters.h"
 #include "../buffer/buffer.h"
+#include "../pool/arena.h"
 #include "httprequest.h"
 #include "httpresponse.h"
 
@@ -49,6 +53,39 @@ class HttpConn {
   // 处理http请求，并根据请求处理好响应内容，将待写入套接字的通道接入对应位置（第一个为写缓冲区，第二个为响应内容内存的映射
   bool Process();
 
+  // 连接上没有解析到一半的请求，下一次读到的数据是一个新请求的开头
+  bool IsRequestStart() const {
+    return request_.State() == HttpRequest::kFinish
+        || (request_.State() == HttpRequest::kRequestLine && read_buff_.ReadableBytes() == 0);
+  }
+
+  // 上一个请求已处理完，读缓冲区中还有同一次读入的后续请求（流水线），这些请求不经过主线程的读事件
+  bool HasPipelinedRequest() const {
+    return request_.State() == HttpRequest::kFinish && read_buff_.ReadableBytes() > 0;
+  }
+  // 读缓冲区中已读入、还没有解析的数据
+  const Buffer &ReadBuffer() const {
+    return read_buff_;
+  }
+
+  // 请求是否在等待异步的数据库验证，此时连接上不注册任何事件
+  bool IsWaitingSql() const {
+    return request_.IsVerifyPending();
+  }
+  // 返回等待验证的请求
+  const HttpRequest &Request() const {
+    return request_;
+  }
+  // 异步验证完成后生成响应，返回值同Process；is_unavailable为true时（取不到数据库连接）返回503
+  bool FinishVerify(bool is_verified, bool is_unavailable = false);
+  // 每次提交异步验证时递增，回调据此判断连接是否还是提交时的那个请求
+  uint32_t NextVerifyTicket() {
+    return ++verify_ticket_;
+  }
+  uint32_t VerifyTicket() const {
+    return verify_ticket_;
+  }
+
   // 待发送给套接字的字节数，即两个通道中待写入的长度
   int ToWriteBytes() {
     return iov_[0].iov_len + iov_[1].iov_len;
@@ -59,11 +96,26 @@ class HttpConn {
     return request_.IsKeepAlive();
   }
 
+  // 记录读事件放入线程池的时刻，由主线程在添加任务前调用，用于统计排队时间
+  void MarkQueued();
+
   static bool isET;
   static const char *src_dir;
   static std::atomic<int> user_count;
+  static bool open_metrics; // 是否向本机客户端提供/metrics统计页面
 
  private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  // 返回两个时间点间隔的微秒数
+  static uint32_t ElapsedUs_(const TimePoint &begin, const TimePoint &end);
+  // 响应全部发送完毕后，按采样率将访问记录放入访问日志
+  void LogAccess_();
+  // 判断是否为本机客户端（127.0.0.0/8）对统计页面的请求
+  bool IsMetricsRequest_() const;
+  // 根据解析结果生成响应，将待写入套接字的通道接入对应位置
+  bool MakeResponse_(HttpRequest::HttpCode process_state);
+
   int fd_;
   struct sockaddr_in addr_;
 
@@ -75,8 +127,21 @@ class HttpConn {
   Buffer read_buff_;
   Buffer write_buff_;
 
+  Arena arena_; // 存放一次请求解析出的内容，下一个请求开始时重置，连接空闲时归还内存块
   HttpRequest request_;
   HttpResponse response_;
+
+  bool is_first_write_;  // 当前连接是否还没有向客户端写出过数据
+  TimePoint accepted_at_; // 连接建立的时刻
+  bool is_queued_;  // 读事件是否刚从线程池队列中取出
+  bool is_access_pending_;  // 是否有已生成但未发送完的响应需要记录访问日志
+  uint32_t queue_us_; // 本次读事件在线程池队列中等待的时间
+  uint32_t parse_us_; // 本次请求的解析耗时
+  uint32_t verify_ticket_; // 异步验证的序号
+  TimePoint handler_begin_; // 开始生成响应的时刻，异步验证时包含等待数据库的时间
+  TimePoint queued_at_; // 读事件放入线程池的时刻
+  TimePoint write_begin_; // 响应生成完毕，开始发送的时刻
+  AccessRecord access_; // 当前请求的访问记录，定长结构体，作为成员复用
 };
 
 #endif //MODERNCPPWEBSERVER_HTTP_HTTPCONN_H_
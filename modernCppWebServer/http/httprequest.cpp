@@ -12,28 +12,76 @@ const std::unordered_map<std::string, int> HttpRequest::kDefaultHtmlTag{
     {"/register.html", 0}, {"/login.html", 1}
 };
 
+// 图片和视频页面在首页就有链接，对所有人开放，只有登录成功后跳转的欢迎页面需要会话
+const std::unordered_set<std::string> HttpRequest::kSessionHtml{
+    "/welcome.html"
+};
+
+bool HttpRequest::async_verify = false;
+
 // 将解析的内容置为空，解析状态置为解析请求行（从解析请求行开始）
+// 只丢弃对arena中内容的引用，arena由持有者重置，使用自己的arena时在这里重置
 void HttpRequest::Init() {
-  method_ = "";
-  path_ = "";
-  version_ = "";
-  body_ = "";
+  if (arena_ == &own_arena_) {
+    own_arena_.Reset();
+  }
+  method_ = ArenaString();
+  path_ = ArenaString();
+  version_ = ArenaString();
+  body_ = nullptr;
+  body_len_ = 0;
   state_ = kRequestLine;
-  header_.clear();
-  post_.clear();
+  header_ = nullptr;
+  post_ = nullptr;
+  is_verify_pending_ = false;
+  is_unavailable_ = false;
+  set_cookie_ = ArenaString();
+  verify_is_login_ = false;
+  verify_name_ = ArenaString();
+  verify_pwd_ = ArenaString();
+}
+
+// 异步验证完成，根据结果设置跳转的页面
+void HttpRequest::FinishVerify(bool is_verified, bool is_unavailable) {
+  assert(is_verify_pending_);
+  is_verify_pending_ = false;
+  is_unavailable_ = is_unavailable;
+  if (is_verified) {
+    StartSession_(verify_name_);
+  }
+  path_.data = is_verified ? "/welcome.html" : "/error.html";
+  path_.size = strlen(path_.data);
 }
 
 // 判断请求是否为长连接
 bool HttpRequest::IsKeepAlive() const {
-  if (header_.count("Connection") == 1) {
+  const ArenaString *connection = FindField_(header_, "Connection", true);
+  if (connection != nullptr) {
     // 如果请求头中有connection，判断http协议版本为1.1且请求Connection为keep-alive
-    return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
-    // 函数IsKeepAlive是const，所以也不能用重载的[]
-    // return header_["Connection"] == "keep-alive" && version_ == "1.1";
+    return *connection == "keep-alive" && version_ == "1.1";
   }
   return false;
 }
 
+// 在链表头部加入一个键值对
+void HttpRequest::AddField_(Field *&head, const char *key, size_t key_len, const char *value, size_t value_len) {
+  Field *field = arena_->New<Field>();
+  field->key = arena_->CopyString(key, key_len);
+  field->value = arena_->CopyString(value, value_len);
+  field->next = head;
+  head = field;
+}
+
+// 在链表中查找键对应的值，链表很短（一般十几个请求头），顺序查找即可
+const ArenaString *HttpRequest::FindField_(const Field *head, const char *key, bool ignore_case) {
+  for (const Field *field = head; field != nullptr; field = field->next) {
+    if ((ignore_case ? strcasecmp(field->key.data, key) : strcmp(field->key.data, key)) == 0) {
+      return &field->value;
+    }
+  }
+  return nullptr;
+}
+
 // 解析HTTP请求, 相比于原作者，修改了返回值
 HttpRequest::HttpCode HttpRequest::Parse(Buffer &buff) {
   const char CRLF[] = "\r\n"; // 请求行和请求头每行结尾为CRLF
@@ -46,12 +94,12 @@ HttpRequest::HttpCode HttpRequest::Parse(Buffer &buff) {
   while (buff.ReadableBytes() && state_ != kFinish) {
     // 根据CRLF找到缓冲区中一行的结尾，然后取出这一行，line_end为'\r'位置，即\r\n的开头，也即一行有效字符的后一个字符
     const char *line_end = std::search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-    // 根据查找到的位置，初始化一个字符串，即一行的有效字符内容。
-    std::string line(buff.Peek(), line_end);
+    // [Peek(), line_end)即一行的有效字符内容，直接在缓冲区上解析，需要保留的部分再复制到arena中
+    const char *line_begin = buff.Peek();
     switch (state_) {
       case kRequestLine:
         // 解析请求行，解析完成后state_变为kHeaders
-        if (!ParseRequestLine_(line)) {
+        if (!ParseRequestLine_(line_begin, line_end)) {
           return kBadRequest;
           // return false;
         }
@@ -60,7 +108,7 @@ HttpRequest::HttpCode HttpRequest::Parse(Buffer &buff) {
         break;
       case kHeaders:
         // 解析请求头，解析完成后state_变为kBody
-        ParseHeader_(line);
+        ParseHeader_(line_begin, line_end);
         // if (buff.ReadableBytes() <= 2) {
         //   state_ = kFinish;
         // }
@@ -68,14 +116,17 @@ HttpRequest::HttpCode HttpRequest::Parse(Buffer &buff) {
         if (state_ == kBody && method_ == "GET") {
           state_ = kFinish; // get请求，到此就可以结束，状态变为finish
           buff.RetrieveAll(); // 清空缓冲区
+          RequireSession_();
           return kGetRequest; // 返回状态为kGetRequest
         }
         break;
       case kBody:
-        if (!ParseBody_(line)) {
+        if (!ParseBody_(line_begin, line_end)) {
           // 解析请求体失败
           return kNoRequest;
         }
+        // 请求体已复制到arena中，从缓冲区中取走，原来留在缓冲区中，长连接的下一次解析会把它当作请求行
+        buff.RetrieveUntil(line_end == buff.BeginWrite() ? line_end : line_end + 2);
         return kGetRequest;
       default:
         return kInternalError;
@@ -93,14 +144,15 @@ HttpRequest::HttpCode HttpRequest::Parse(Buffer &buff) {
 // 解析请求路径，将完整路径信息赋值给成员变量path_
 void HttpRequest::ParsePath_() {
   if (path_ == "/") {
-    // 如果路径为/ ，将路径置为主页，即index.html
-    path_ = "/index.html";
+    // 如果路径为/ ，将路径置为主页，即index.html（指向字符串常量，不需要复制）
+    path_.data = "/index.html";
+    path_.size = strlen(path_.data);
   } else {
     for (auto &item : kDefaultHtml) {
       // 否则，从预定义的页面中查找，如果找到，则添加.html后缀后返回
       // 允许请求的都是静态变量，且是在程序中预先定义“写死”的，不写死或许可以初始化时读取路径然后写入字典
-      if (item == path_) {
-        path_ += ".html";
+      if (item == path_.data) {
+        path_ = arena_->Concat(path_.data, path_.size, ".html", 5);
         break;
       }
     }
@@ -108,16 +160,18 @@ void HttpRequest::ParsePath_() {
 }
 
 // 解析HTTP请求的请求行，将对应信息写入对象成员变量
-bool HttpRequest::ParseRequestLine_(const std::string &line) {
-  // 不包含空格的连续字符+空格+不包含空格的连续字符+空格+HTTP/不包含空格的连续字符，
-  // ^[^ ]* [^ ]* HTTP/[^ ]*$ 是匹配整个串的正则，加上括号应该是为了给sub_match填充对应的值
-  // std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-  std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-  std::smatch sub_match;
-  if (std::regex_match(line, sub_match, patten)) {
-    method_ = sub_match[1];
-    path_ = sub_match[2];
-    version_ = sub_match[3];
+// 原来用正则^([^ ]*) ([^ ]*) HTTP/([^ ]*)$匹配，每次都要构造正则对象，这里按同样的规则手工切分：
+// 不包含空格的连续字符+空格+不包含空格的连续字符+空格+HTTP/不包含空格的连续字符
+bool HttpRequest::ParseRequestLine_(const char *begin, const char *end) {
+  const char *method_end = std::find(begin, end, ' ');
+  const char *path_begin = method_end + 1;
+  const char *path_end = method_end == end ? end : std::find(path_begin, end, ' ');
+  const char *version_begin = path_end + 5;
+  if (method_end != end && path_end != end && end - path_end > 5
+      && memcmp(path_end + 1, "HTTP/", 5) == 0 && std::find(version_begin, end, ' ') == end) {
+    method_ = arena_->CopyString(begin, method_end - begin);
+    path_ = arena_->CopyString(path_begin, path_end - path_begin);
+    version_ = arena_->CopyString(version_begin + 1, end - version_begin - 1);
     state_ = kHeaders;  // 将解析状态置为kHeaders，接下来解析请求头
     return true;
   }
@@ -127,14 +181,17 @@ bool HttpRequest::ParseRequestLine_(const std::string &line) {
 }
 
 // 解析请求头的一行，即一个键值对信息（整个解析动作是一行一行读取的，请求头可能有多个键值对）
-void HttpRequest::ParseHeader_(const std::string &line) {
+void HttpRequest::ParseHeader_(const char *begin, const char *end) {
   // 请求头一行为keystr: valstr
-  // 正则表达式为：非:的连续字符 + : + 0个或1个空格 + 除换行符之外的连续字符
-  std::regex patten("^([^:]*): ?(.*)$");
-  std::smatch sub_match;
-  if (std::regex_match(line, sub_match, patten)) {
-    // 匹配成功，将键值对放入请求头的hash表中
-    header_[sub_match[1]] = sub_match[2];
+  // 原来的正则为：非:的连续字符 + : + 0个或1个空格 + 除换行符之外的连续字符，这里同样以第一个冒号切分
+  const char *colon = std::find(begin, end, ':');
+  if (colon != end) {
+    // 匹配成功，将键值对放入请求头的链表中
+    const char *value = colon + 1;
+    if (value != end && *value == ' ') {
+      ++value;
+    }
+    AddField_(header_, begin, colon - begin, value, end - value);
   } else {
     // 匹配失败，此时的行应该为回车符+换行符，http协议中用于分割请求头和请求体，状态置为kBody接下来解析请求体
     state_ = kBody;
@@ -142,13 +199,18 @@ void HttpRequest::ParseHeader_(const std::string &line) {
 }
 
 // 解析请求体，Post请求有请求体，所以调用ParsePost_()来解析
-bool HttpRequest::ParseBody_(const std::string &line) {
-  body_ = line; // 将请求体内容赋值给成员变量
+bool HttpRequest::ParseBody_(const char *begin, const char *end) {
+  // 将请求体内容复制到arena中，表单解码时会原地修改
+  ArenaString body = arena_->CopyString(begin, end - begin);
+  body_ = const_cast<char *>(body.data);
+  body_len_ = body.size;
+  // 在登录/注册改写跳转页面之前检查，验证通过后跳转的欢迎页面不受影响
+  RequireSession_();
   if (!ParsePost_()) {
     return false;
   }; // 解析post请求（如果是post请求的话）
   state_ = kFinish; // 将解析状态置为解析完成
-  LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());  // 日志记下解析信息
+  LOG_DEBUG("Body:%s, len:%d", body_, static_cast<int>(body_len_));  // 日志记下解析信息
   return true;
 }
 
@@ -165,44 +227,105 @@ int HttpRequest::ConverHex(char ch) {
 
 // 解析post请求，本项目中post请求只有登录请求，所以此方法作用仅为验证账号密码是否正确从而跳转到对应页面
 bool HttpRequest::ParsePost_() {
-  if (body_.size() < atol(header_["Content-Length"].c_str())) {
+  const ArenaString *content_length = FindField_(header_, "Content-Length", true);
+  if (content_length != nullptr && body_len_ < static_cast<size_t>(atol(content_length->data))) {
     // 判断post数据是否接收完整，不完整返回false
     return false;
   }
-  if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+  const ArenaString *content_type = FindField_(header_, "Content-Type", true);
+  if (method_ == "POST" && content_type != nullptr && *content_type == "application/x-www-form-urlencoded") {
     // 如果是POST，"application/x-www-form-urlencoded"表示将post将表单内的数据转换为Key-Value。
     ParseFromUrlencoded_();
-    if (kDefaultHtmlTag.count(path_)) {
-      int tag = kDefaultHtmlTag.find(path_)->second;
+    auto tag_it = kDefaultHtmlTag.find(path_.data);
+    if (tag_it != kDefaultHtmlTag.end()) {
+      int tag = tag_it->second;
       LOG_DEBUG("Tag:%d", tag);
       if (tag == 0 || tag == 1) {
         bool is_login = (tag == 1);
-        // 验证账户密码是否正确
-        if (UserVerify(post_["username"], post_["password"], is_login)) {
-          path_ = "/welcome.html";
-        } else {
-          path_ = "/error.html";
+        const ArenaString *username = FindField_(post_, "username", false);
+        const ArenaString *password = FindField_(post_, "password", false);
+        bool is_verified = false;
+        if (is_login && username != nullptr && HasSession_(username)) {
+          // 已带有该用户有效会话的登录，查一次内存即可确认身份，不再验证密码，也不访问数据库
+          path_.data = "/welcome.html";
+          path_.size = strlen(path_.data);
+          return true;
+        }
+        if (async_verify && username != nullptr && password != nullptr
+            && !username->empty() && !password->empty()
+            && !VerifyFromCache_(username->data, password->data, is_login, &is_verified)) {
+          // 异步验证：记下账号密码，由连接提交给SqlAsync，完成后调用FinishVerify设置跳转页面
+          verify_name_ = *username;
+          verify_pwd_ = *password;
+          verify_is_login_ = is_login;
+          is_verify_pending_ = true;
+          return true;
         }
+        if (!async_verify) {
+          // 验证账户密码是否正确，并统计数据库往返的耗时
+          auto verify_begin = std::chrono::steady_clock::now();
+          is_verified = UserVerify(username != nullptr ? username->data : "",
+                                   password != nullptr ? password->data : "", is_login, &is_unavailable_);
+          Metrics::Instance()->RecordLatency(Metrics::kSqlVerify,
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - verify_begin).count());
+        }
+        if (is_verified) {
+          StartSession_(*username);
+        }
+        path_.data = is_verified ? "/welcome.html" : "/error.html";
+        path_.size = strlen(path_.data);
       }
     }
   }
   return true;
 }
 
+// 请求的Cookie中带有name的有效会话，name为空指针时不限用户
+bool HttpRequest::HasSession_(const ArenaString *name) const {
+  const ArenaString *cookie = FindField_(header_, "Cookie", true);
+  std::string user;
+  if (cookie == nullptr || !SessionStore::Instance()->Find(cookie->data, cookie->size, &user)) {
+    return false;
+  }
+  return name == nullptr || (user.size() == name->size && memcmp(user.data(), name->data, name->size) == 0);
+}
+
+// 没有登录就请求欢迎页面时返回登录页面，和原来登录失败跳转错误页面一样用200返回页面内容
+void HttpRequest::RequireSession_() {
+  for (auto &item : kSessionHtml) {
+    // 和ParsePath_一样逐个比较，不为查找构造临时字符串
+    if (item == path_.data) {
+      if (!HasSession_(nullptr)) {
+        path_.data = "/login.html";
+        path_.size = strlen(path_.data);
+      }
+      return;
+    }
+  }
+}
+
+// 登录或注册成功，创建会话，响应时通过Set-Cookie交给客户端
+void HttpRequest::StartSession_(const ArenaString &name) {
+  std::string cookie = SessionStore::Instance()->Create(name.data, name.size);
+  if (!cookie.empty()) {
+    set_cookie_ = arena_->CopyString(cookie.data(), cookie.size());
+  }
+}
+
 // 解析post请求中的各组key = value
+// 键值对直接引用body_中的位置，复制到arena中作为post_的一项
 void HttpRequest::ParseFromUrlencoded_() {
   // username=admin&password=123456
-  if (body_.size() == 0) {
+  if (body_len_ == 0) {
     // 请求体为空，直接返回
     return;
   }
-  // if (body_.empty()) {
-  //   return ;
-  // }
-  std::string key;
-  std::string value;
+  const char *key = body_;
+  size_t key_len = 0;
+  bool has_key = false;
   int num = 0;
-  int n = body_.size();
+  int n = body_len_;
   int i = 0;
   int j = 0;
 
@@ -211,7 +334,9 @@ void HttpRequest::ParseFromUrlencoded_() {
     switch (ch) {
       case '=':
         // 等号之前是key
-        key = body_.substr(j, i - j);
+        key = body_ + j;
+        key_len = i - j;
+        has_key = true;
         j = i + 1;
         break;
       case '+':
@@ -220,6 +345,9 @@ void HttpRequest::ParseFromUrlencoded_() {
         break;
       case '%':
         // 浏览器会将非字母字符编码为%16进制，将其复原
+        if (i + 2 >= n) {
+          break;
+        }
         num = ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2]);
         body_[i + 2] = num % 10 + '0';
         body_[i + 1] = num / 10 + '0';
@@ -227,136 +355,134 @@ void HttpRequest::ParseFromUrlencoded_() {
         break;
       case '&':
         // 解析完一组键值，也即&前是value
-        value = body_.substr(j, i - j);
+        // 将解析好的键值放到post请求的链表中
+        AddField_(post_, key, key_len, body_ + j, i - j);
+        LOG_DEBUG("%s = %s", post_->key.data, post_->value.data);
+        has_key = false;
         j = i + 1;
-        // 将解析好的键值放到post请求字典中
-        post_[key] = value;
-        LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
         break;
       default:
         break;
     }
   }
   assert(j <= i);
-  if (post_.count(key) == 0 && j < i) {
-    // 将最后一对键值放到post请求字典中
-    value = body_.substr(j, i - j);
-    post_[key] = value;
+  if (has_key && j < i) {
+    // 将最后一对键值放到post请求的链表中
+    AddField_(post_, key, key_len, body_ + j, i - j);
   }
 }
 
 // 验证输入的账户密码是否正确，即是否在数据库里面。根据is_login执行登录或注册
-bool HttpRequest::UserVerify(const std::string &name, const std::string &pwd, bool is_login) {
-  if (name == "" || pwd == "") {
+bool HttpRequest::UserVerify(const char *name, const char *pwd, bool is_login, bool *is_unavailable) {
+  if (*name == '\0' || *pwd == '\0') {
     // 如果用户名和密码为空，直接返回false
     return false;
   }
-  LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-  // 从数据库连接池中取出一个连接，连接池初始化时已经指定了数据库名
-  MYSQL *sql;
-  // 使用RAII机制, 这里原作者没用临时变量，构造后立马就析构了，这样连接池内存在和当前重复的连接
-  // SqlConnRAII (&sql, SqlConnPool::Instance());
-  // 我加了个tmp临时变量，令其在作用域结束，也就是这个函数结束时再析构。
-  SqlConnRAII tmp(&sql, SqlConnPool::Instance());
-  assert(sql);
-
-  // 初始化mysql的一些接收信息的结构体指针
-  bool flag = false;  // 标识是否是注册
-  unsigned int j = 0;
-  char order[256] = {0};
-  MYSQL_FIELD *fields = nullptr;
-  MYSQL_RES *res = nullptr;
-
-  if (!is_login) {
-    // 如果为注册，flag设为true
-    flag = true;
+  LOG_INFO("Verify name:%s pwd:%s", name, pwd);
+  // 先查用户缓存，用户存在或登录的用户不存在时不需要访问数据库
+  UserCache *cache = UserCache::Instance();
+  std::string cached_passwd;
+  UserCache::Result cached = cache->Get(name, &cached_passwd);
+  if (cached == UserCache::kFound) {
+    return is_login && cached_passwd == pwd;
   }
-  /* 原作者注释， 查询用户及密码 */
-  snprintf(order, 256, "SELECT username, passwd FROM user WHERE username='%s' LIMIT 1", name.c_str());
-  LOG_DEBUG("%s", order);
-
-  // 执行查询
-  if (mysql_query(sql, order)) {
-    // 如果查询失败（成功为0，识别非0），释放结果集
-    mysql_free_result(res);
+  if (cached == UserCache::kAbsent && is_login) {
     return false;
   }
-  //
-  res = mysql_store_result(sql);
-  j = mysql_num_fields(res);
-  fields = mysql_fetch_fields(res);
-
-  // 从查询结果中一行行取出，然后判断账号和密码是否正确（理论上应该只查询出一行）
-  while (MYSQL_ROW row = mysql_fetch_row(res)) {
-    LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-    std::string password(row[1]);
-    /* 原作者注释 注册行为 且 用户名未被使用 */
+  UserStore *store = UserStore::Instance();
+  bool need_query = cached == UserCache::kMiss;
+  if (need_query && !is_login && !store->MayExist(name, strlen(name))) {
+    // 注册时确定不存在的用户名（如MySQL后端的布隆过滤器）同样跳过查询
+    need_query = false;
+  }
+  if (need_query) {
+    /* 原作者注释， 查询用户及密码 */
+    // 注册时缓存中确定不存在的用户名跳过查询，直接插入
+    std::string passwd;
+    UserStore::Status status = store->Query(name, &passwd);
+    if (status == UserStore::kUnavailable) {
+      // 取不到数据库连接（连接池等待超时或数据库不可用），原来在这里assert
+      *is_unavailable = true;
+      return false;
+    }
+    if (status == UserStore::kError) {
+      return false;
+    }
+    bool is_found = status == UserStore::kOk;
+    if (is_found) {
+      cache->Put(name, passwd);
+    } else {
+      cache->PutAbsent(name);
+    }
     if (is_login) {
-      if (pwd == password) {
-        flag = true;
-      } else {
-        flag = false;
+      // 登录行为，用户存在且密码一致
+      bool is_verified = is_found && passwd == pwd;
+      if (!is_verified) {
         LOG_DEBUG("pwd error");
       }
-    } else {
-      flag = false;
+      return is_verified;
+    }
+    if (is_found) {
       LOG_DEBUG("user used!");
+      return false;
     }
   }
-  // 释放结果集，防止内存泄漏
-  mysql_free_result(res);
-
   /* 原作者注释 注册行为 且 用户名未被使用 */
-  if (!is_login && flag == true) {
-    LOG_DEBUG("register!");
-    bzero(order, 256);
-    snprintf(order, 256, "INSERT INTO user(username, passwd) VALUES('%s', '%s')", name.c_str(), pwd.c_str());
-    LOG_DEBUG("%s", order);
-    if (mysql_query(sql, order)) {
-      LOG_DEBUG("Insert error!");
-      flag = false;
-    }
-    flag = true;
+  LOG_DEBUG("register!");
+  // 原来插入失败时仍然返回true，这里改为返回插入的结果
+  // 插入成功后写入缓存，失败时（如其他连接刚注册了同名用户）删除缓存，下次重新查询
+  UserStore::Status status = store->Insert(name, pwd);
+  if (status != UserStore::kOk) {
+    *is_unavailable = status == UserStore::kUnavailable;
+    cache->Erase(name);
+    return false;
   }
-  // SqlConnPool::Instance()->FreeConn(sql);  // 作用域结束自动释放不需要在这释放
-  LOG_DEBUG("UserVerify success!!");
-  return flag;
+  cache->Put(name, pwd);
+  return true;
 }
 
-// 返回解析好的路径
-std::string HttpRequest::Path() const {
-  return path_;
+// 只用用户缓存验证（异步验证提交前调用）：用户存在时登录比较密码、注册失败；用户不存在时登录失败，注册仍需插入数据库
+bool HttpRequest::VerifyFromCache_(const char *name, const char *pwd, bool is_login, bool *is_verified) {
+  std::string passwd;
+  UserCache::Result result = UserCache::Instance()->Get(name, &passwd);
+  if (result == UserCache::kFound) {
+    *is_verified = is_login && passwd == pwd;
+    return true;
+  }
+  if (result == UserCache::kAbsent && is_login) {
+    *is_verified = false;
+    return true;
+  }
+  return false;
 }
 
 // 返回解析好的路径
-std::string &HttpRequest::Path() {
+const ArenaString &HttpRequest::Path() const {
   return path_;
 }
 
 // 返回解析好的请求方法
-std::string HttpRequest::Method() const {
+const ArenaString &HttpRequest::Method() const {
   return method_;
 }
 
 // 返回请求好的版本
-std::string HttpRequest::Version() const {
+const ArenaString &HttpRequest::Version() const {
   return version_;
 }
 
 // 在post请求体中根据给定的键获取对应的值，如果不存在则放回空字符串
 std::string HttpRequest::GetPost(const std::string &key) const {
   assert(key != "");
-  if (post_.count(key) == 1) {
-    return post_.find(key)->second;
-  }
-  return "";
+  return GetPost(key.c_str());
 }
 
 // 上个函数的const char* 字符串重载版本
 std::string HttpRequest::GetPost(const char *key) const {
   assert(key != nullptr);
-  if (post_.count(key) == 1) {
-    return post_.find(key)->second;
+  const ArenaString *value = FindField_(post_, key, false);
+  if (value != nullptr) {
+    return value->data;
   }
   return "";
 }
@@ -364,22 +490,3 @@ std::string HttpRequest::GetPost(const char *key) const {
 HttpRequest::ParseState HttpRequest::State() const {
   return state_;
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
@@ -8,15 +8,17 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <regex>
 #include <errno.h>
+#include <chrono>
 // #include <cerrno>
-#include <mysql/mysql.h>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
-#include "../pool/sqlconnpool.h"
-#include "../pool/sqlconnRAII.h"
+#include "../metrics/metrics.h"
+#include "../pool/arena.h"
+#include "../pool/usercache.h"
+#include "../pool/userstore.h"
+#include "sessionstore.h"
 
 class HttpRequest {
  public:
@@ -38,8 +40,10 @@ class HttpRequest {
     kClosedConnection,
   };
 
+  // 解析出的字符串、请求头和表单字段都存放在arena中，arena由连接持有，请求结束时由连接重置
+  // 不传arena时使用对象自己的arena，每次Init()时重置
   // 调用Init()成员方法，解析内容置为空，解析状态置为解析请求行（从解析请求行开始）
-  HttpRequest() {
+  explicit HttpRequest(Arena *arena = nullptr) : arena_(arena != nullptr ? arena : &own_arena_) {
     Init();
   }
 
@@ -50,13 +54,12 @@ class HttpRequest {
   // 解析HTTP请求
   HttpCode Parse(Buffer &buff);
 
-  // 返回解析好的路径
-  std::string Path() const;
-  std::string &Path();
+  // 返回解析好的路径，以下返回的字符串有效期到arena重置为止
+  const ArenaString &Path() const;
   // 返回解析好的请求方法
-  std::string Method() const;
+  const ArenaString &Method() const;
   // 返回请求好的版本
-  std::string Version() const;
+  const ArenaString &Version() const;
   // 在post请求体中根据给定的键获取对应的值，如果不存在则放回空字符串
   std::string GetPost(const std::string &key) const;
   std::string GetPost(const char *key) const;
@@ -64,6 +67,33 @@ class HttpRequest {
   // 判断请求是否为长连接
   bool IsKeepAlive() const;
 
+  // 是否有等待异步验证的登录/注册请求，账号密码的有效期到arena重置为止
+  bool IsVerifyPending() const {
+    return is_verify_pending_;
+  }
+  const ArenaString &VerifyName() const {
+    return verify_name_;
+  }
+  const ArenaString &VerifyPwd() const {
+    return verify_pwd_;
+  }
+  bool VerifyIsLogin() const {
+    return verify_is_login_;
+  }
+  // 异步验证完成，根据结果设置跳转的页面；is_unavailable为true时和同步验证一样标记为取不到数据库连接
+  void FinishVerify(bool is_verified, bool is_unavailable = false);
+  // 验证时取不到数据库连接（连接池等待超时或数据库不可用），应返回503
+  bool IsUnavailable() const {
+    return is_unavailable_;
+  }
+  // 登录/注册成功时新建会话的Set-Cookie值，没有新建会话时为空
+  const ArenaString &SetCookie() const {
+    return set_cookie_;
+  }
+
+  // 为true时登录/注册的数据库验证不在解析时同步执行，而是由连接提交给SqlAsync异步执行
+  static bool async_verify;
+
   ParseState State() const;
 
   /*
@@ -73,12 +103,24 @@ class HttpRequest {
    */
 
  private:
-  // 解析HTTP请求的请求行，将对应信息写入对象成员变量
-  bool ParseRequestLine_(const std::string &line);
+  // 请求头或表单中的一个键值对，存放在arena中，按解析顺序的倒序串成链表
+  struct Field {
+    ArenaString key;
+    ArenaString value;
+    Field *next;
+  };
+
+  // 解析HTTP请求的请求行，将对应信息写入对象成员变量，[begin, end)为一行的内容
+  bool ParseRequestLine_(const char *begin, const char *end);
   // 解析请求头的一行，即一个键值对信息（整个解析动作是一行一行读取的，请求头可能有多个键值对）
-  void ParseHeader_(const std::string &line);
+  void ParseHeader_(const char *begin, const char *end);
   // 解析请求体，Post请求有请求体，所以调用ParsePost_()来解析
-  bool ParseBody_(const std::string &line);
+  bool ParseBody_(const char *begin, const char *end);
+
+  // 在链表头部加入一个键值对，同名的键后加入的在前，查找时覆盖先加入的
+  void AddField_(Field *&head, const char *key, size_t key_len, const char *value, size_t value_len);
+  // 在链表中查找键对应的值，请求头的键不区分大小写，找不到时返回nullptr
+  static const ArenaString *FindField_(const Field *head, const char *key, bool ignore_case);
 
   // 解析请求路径，将完整路径信息赋值给成员变量path_
   void ParsePath_();
@@ -89,18 +131,39 @@ class HttpRequest {
   void ParseFromUrlencoded_();
 
   // 验证输入的账户密码是否正确，即是否在数据库里面。根据is_login执行登录或注册
-  static bool UserVerify(const std::string &name, const std::string &pwd, bool is_login);
+  // 取不到数据库连接时返回false并将is_unavailable置为true
+  static bool UserVerify(const char *name, const char *pwd, bool is_login, bool *is_unavailable);
+  // 请求的Cookie中带有该用户的有效会话，name为空指针时任一用户的会话都可以
+  bool HasSession_(const ArenaString *name) const;
+  // 请求的是登录后才能访问的页面而没有有效会话时，改为返回登录页面
+  void RequireSession_();
+  // 为验证通过的用户创建会话，Set-Cookie的值存放在arena中
+  void StartSession_(const ArenaString &name);
+  // 只用用户缓存验证，能得出结果时写入is_verified并返回true，需要访问数据库时返回false
+  static bool VerifyFromCache_(const char *name, const char *pwd, bool is_login, bool *is_verified);
+
+  Arena own_arena_; // 没有传入arena时使用，不使用时不占用内存块
+  Arena *arena_;  // 存放本次请求解析出的内容
 
   ParseState state_;  // 记录当前对http请求的解析状态
-  std::string method_;  // 记录http请求的请求方法
-  std::string path_;  // 记录http请求的资源路径
-  std::string version_; // 记录http请求的当前版本（当前一般为1.1）
-  std::string body_;  // 记录请求体内容
-  std::unordered_map<std::string, std::string> header_; // 记录http请求的请求头键值对
-  std::unordered_map<std::string, std::string> post_; // 记录post请求的请求体中的键值对
+  ArenaString method_;  // 记录http请求的请求方法
+  ArenaString path_;  // 记录http请求的资源路径
+  ArenaString version_; // 记录http请求的当前版本（当前一般为1.1）
+  char *body_;  // 记录请求体内容，解码时原地修改，所以不用ArenaString
+  size_t body_len_;
+  Field *header_; // 记录http请求的请求头键值对
+  Field *post_; // 记录post请求的请求体中的键值对
+
+  bool is_verify_pending_;  // 是否有等待异步验证的登录/注册请求
+  bool is_unavailable_; // 同步验证时取不到数据库连接
+  ArenaString set_cookie_;  // 新建会话的Set-Cookie值
+  bool verify_is_login_;  // 等待验证的是登录还是注册
+  ArenaString verify_name_;
+  ArenaString verify_pwd_;
 
   static const std::unordered_set<std::string> kDefaultHtml;  // 可以请求的静态资源名称（不带后缀）
   static const std::unordered_map<std::string, int> kDefaultHtmlTag;  // 注册页面标识0， 登录页面标识1
+  static const std::unordered_set<std::string> kSessionHtml;  // 登录后才能访问的页面（带后缀）
   // 将16进制的字母转换为10进制数值，如果小于10直接返回，即A 10, B 11, C 12, D 13, E 14, F, 15
   static int ConverHex(char ch);
 };
@@ -31,22 +31,24 @@ const std::unordered_map<int, std::string> HttpResponse::kCodeStatus = {
     {400, "Bad Request"},
     {403, "Forbidden"},
     {404, "Not Found"},
+    {503, "Service Unavailable"},
 };
 
 const std::unordered_map<int, std::string> HttpResponse::kCodePath = {
     {400, "/400.html"},
     {403, "/403.html"},
     {404, "/404.html"},
+    {503, "/503.html"},
 };
 
 HttpResponse::HttpResponse()
     : code_(-1),
+      is_keep_alive_(false),
       path_(""),
       src_dir_(""),
-      is_keep_alive_(false),
+      set_cookie_(nullptr),
       mm_file_(nullptr),
       mm_file_stat_({0}) {
-
 }
 
 HttpResponse::~HttpResponse() {
@@ -54,9 +56,9 @@ HttpResponse::~HttpResponse() {
 }
 
 // 执行响应对象的初始化
-void HttpResponse::Init(const std::string &src_dir, std::string &path,
+void HttpResponse::Init(const char *src_dir, const char *path,
                         bool is_keep_alive, int code) {
-  assert(src_dir != "");
+  assert(src_dir != nullptr && *src_dir != '\0');
   // assert(!src_dir.empty());
   if (mm_file_) {
     // 如果已经存在内存映射，则取消映射
@@ -67,6 +69,7 @@ void HttpResponse::Init(const std::string &src_dir, std::string &path,
   is_keep_alive_ = is_keep_alive;
   path_ = path;
   src_dir_ = src_dir;
+  set_cookie_ = nullptr;
   mm_file_ = nullptr;
   mm_file_stat_ = {0};
 }
@@ -79,7 +82,10 @@ void HttpResponse::MakeResponse(Buffer &buff) {
   // int c = errno;
   // perror("stat");
   // const char *str = (src_dir_ + path_).data();
-  if (stat((src_dir_ + path_).data(), &mm_file_stat_) < 0
+  // 完整路径只在生成响应时用到，拼接在栈上，不占用每个连接的内存
+  char file_path[PATH_MAX];
+  MakeFilePath_(file_path, sizeof(file_path));
+  if (stat(file_path, &mm_file_stat_) < 0
       || S_ISDIR(mm_file_stat_.st_mode)) {
     // 如果获取文件信息失败或者是一个目录，则code_设为404
     code_ = 404;
@@ -91,11 +97,25 @@ void HttpResponse::MakeResponse(Buffer &buff) {
     code_ = 200;
   }
   // 如果有错误，将路径指向错误页面
-  ErrorHtml_();
+  ErrorHtml_(file_path, sizeof(file_path));
   // 将状态行，响应头，响应体（出错时错误信息的响应体）放到缓冲区
   AddStateLine_(buff);
   AddHeader_(buff);
-  AddContent_(buff);
+  AddContent_(buff, file_path);
+}
+
+// 将工作目录和资源路径拼接到file_path中，过长的路径被截断后找不到文件，按404处理
+void HttpResponse::MakeFilePath_(char *file_path, size_t size) const {
+  snprintf(file_path, size, "%s%s", src_dir_, path_);
+}
+
+// 响应内容在内存中动态生成，不对应资源文件，直接将响应体放入缓冲区
+void HttpResponse::MakeTextResponse(Buffer &buff, const std::string &body) {
+  code_ = 200;
+  AddStateLine_(buff);
+  AddHeader_(buff);
+  buff.Append("Content-length: " + std::to_string(body.size()) + "\r\n\r\n");
+  buff.Append(body);
 }
 
 // 返回响应文件映射到内存的起始地址指针，即返回mm_file_
@@ -109,27 +129,28 @@ size_t HttpResponse::FileLen() const {
 }
 
 // 根据错误的状态码信息（如果code_时错误码），将路径指向标识错误的html页面
-void HttpResponse::ErrorHtml_() {
+void HttpResponse::ErrorHtml_(char *file_path, size_t size) {
   if (kCodePath.count(code_) == 1) {
     // 如果错误码在错误码页面字典中，获取错误码页面，并获取错误码页面的信息
-    path_ = kCodePath.find(code_)->second;
+    path_ = kCodePath.find(code_)->second.c_str();
     // path_ = kCodePath[code_];  // 重载的运算符[]是非const的，不存在map中会添加默认值
-    stat((src_dir_ + path_).data(), &mm_file_stat_);
+    MakeFilePath_(file_path, size);
+    stat(file_path, &mm_file_stat_);
   }
 }
 
 // 为响应消息添加状态行
 void HttpResponse::AddStateLine_(Buffer &buff) {
-  std::string status;
   // 如果当前状态码再状态码字典中，设置响应状态为对应的信息，否则统一设置为400
-  if (kCodeStatus.count(code_) == 1) {
-    status = kCodeStatus.find(code_)->second;
-  } else {
+  auto status = kCodeStatus.find(code_);
+  if (status == kCodeStatus.end()) {
     code_ = 400;
-    status = kCodeStatus.find(400)->second;
+    status = kCodeStatus.find(400);
   }
-  // 将响应消息状态行放进缓冲区，以\r\n结尾
-  buff.Append("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
+  // 将响应消息状态行放进缓冲区，以\r\n结尾，在栈上格式化，不拼接临时字符串
+  char line[64];
+  int len = snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", code_, status->second.c_str());
+  buff.Append(line, std::min(static_cast<size_t>(len), sizeof(line) - 1));
 }
 
 // 为响应消息添加消息报头，这里只添加是否为长连接的信息
@@ -143,12 +164,23 @@ void HttpResponse::AddHeader_(Buffer &buff) {
   } else {
     buff.Append("close\r\n");
   }
-  buff.Append("Content-type: " + GetFileType_() + "\r\n");
+  if (set_cookie_ != nullptr) {
+    buff.Append("Set-Cookie: ");
+    buff.Append(set_cookie_);
+    buff.Append("\r\n");
+  }
+  if (code_ == 503) {
+    // 数据库暂时不可用，提示客户端1秒后重试
+    buff.Append("Retry-After: 1\r\n");
+  }
+  buff.Append("Content-type: ");
+  buff.Append(GetFileType_());
+  buff.Append("\r\n");
 }
 
 // 添加响应体，如果出现错误就添加错误信息的响应体，否则只添加一个包含相应体长度信息的响应头字段
-void HttpResponse::AddContent_(Buffer &buff) {
-  int src_fd = open((src_dir_ + path_).data(), O_RDONLY);
+void HttpResponse::AddContent_(Buffer &buff, const char *file_path) {
+  int src_fd = open(file_path, O_RDONLY);
   if (src_fd < 0) {
     // 打开文件失败，则缓冲区写入错误信息的页面，直接返回
     ErrorContent(buff, "File NotFound!");
@@ -158,7 +190,7 @@ void HttpResponse::AddContent_(Buffer &buff) {
   /* 原作者注释 */
   /* 将文件映射到内存提高文件的访问速度，MAP_PRIVATE 建立一个写入时拷贝的私有映射 */
   // 写入日志
-  LOG_DEBUG("file path %s", (src_dir_ + path_).data());
+  LOG_DEBUG("file path %s", file_path);
   // 将响应文件的内容映射到当前进程内存虚拟地址0开始的空间
   int *mm_ret = (int *) mmap(0, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
   // int *mm_ret = static_cast<int*> (mmap(0, mm_file_stat_.st_size, PROT_READ, MAP_PRIVATE, src_fd, 0));
@@ -173,7 +205,9 @@ void HttpResponse::AddContent_(Buffer &buff) {
   // 关闭文件描述符
   close(src_fd);
   // 为响应内容的长度添加响应头，有响应体的http的请求和响应才有这个内容，以\r\n\r\n结尾
-  buff.Append("Content-length: " + std::to_string(mm_file_stat_.st_size) + "\r\n\r\n");
+  char line[64];
+  int len = snprintf(line, sizeof(line), "Content-length: %lld\r\n\r\n", static_cast<long long>(mm_file_stat_.st_size));
+  buff.Append(line, len);
 }
 
 // 删除响应文件在内存中的映射
@@ -186,18 +220,18 @@ void HttpResponse::UnmapFile() {
 }
 
 // 获取响应的文件的类型
-std::string HttpResponse::GetFileType_() {
+const char *HttpResponse::GetFileType_() const {
   /* 原作者注释  判断文件类型 */
   // 获取文件的后缀名
-  std::string::size_type idx = path_.find_last_of('.');
-  if (idx == std::string::npos) {
+  const char *suffix = strrchr(path_, '.');
+  if (suffix == nullptr) {
     // 如果没有后缀名，则认为是text文件
     return "text/plain";
   }
-  // 如果后缀名在文件类型字典中，则返回对应文件类型
-  std::string suffix = path_.substr(idx);
-  if (kSuffixType.count(suffix) == 1) {
-    return kSuffixType.find(suffix)->second;
+  // 如果后缀名在文件类型字典中，则返回对应文件类型（后缀名都很短，构造查找用的string不会申请堆内存）
+  auto type = kSuffixType.find(suffix);
+  if (type != kSuffixType.end()) {
+    return type->second.c_str();
   }
   return "text/plain";
 }
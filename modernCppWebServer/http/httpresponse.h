@@ -6,6 +6,7 @@
 #define MODERNCPPWEBSERVER_HTTP_HTTPRESPONSE_H_
 
 #include <unordered_map>
+#include <climits>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -19,11 +20,18 @@ class HttpResponse {
   HttpResponse();
   ~HttpResponse();
 
-  // 执行响应对象的初始化
-  void Init(const std::string &src_dir, std::string &path,
+  // 执行响应对象的初始化，src_dir和path只保存指针，在生成响应前需保持有效
+  // （src_dir为服务器的静态资源目录，path在请求的arena中，到下一个请求开始时才失效）
+  void Init(const char *src_dir, const char *path,
             bool is_keep_alive = false, int code = -1);
+  // 设置Set-Cookie头的值，和path一样只保存指针，Init时清空
+  void SetCookie(const char *cookie) {
+    set_cookie_ = cookie;
+  }
   // 获取并拼接响应信息放入缓冲区
   void MakeResponse(Buffer &buff);
+  // 响应内容在内存中动态生成（如/metrics），不对应资源文件，直接将响应体放入缓冲区
+  void MakeTextResponse(Buffer &buff, const std::string &body);
   // 删除响应文件在内存中的映射
   void UnmapFile();
   // 返回响应文件映射到内存的起始地址指针，即返回mm_file_
@@ -42,17 +50,20 @@ class HttpResponse {
   // 为响应消息添加消息报头
   void AddHeader_(Buffer &buff);
   // 添加响应体，如果出现错误就添加错误信息的响应题，否则只添加一个包含相应体长度信息的响应头字段
-  void AddContent_(Buffer &buff);
+  void AddContent_(Buffer &buff, const char *file_path);
 
-  // 根据错误的状态码信息（如果code_时错误码），将路径指向标识错误的html页面
-  void ErrorHtml_();
+  // 根据错误的状态码信息（如果code_时错误码），将路径指向标识错误的html页面，并重新拼接file_path
+  void ErrorHtml_(char *file_path, size_t size);
   // 获取响应的文件的类型
-  std::string GetFileType_();
+  const char *GetFileType_() const;
+  // 将工作目录和资源路径拼接到file_path中
+  void MakeFilePath_(char *file_path, size_t size) const;
 
   int code_;  // 当前响应的状态码
   bool is_keep_alive_;  // 标识是否为长连接
-  std::string path_;  // 工作目录下的资源路径的字符串
-  std::string src_dir_; // 工作目录路径的字符串
+  const char *path_;  // 工作目录下的资源路径的字符串
+  const char *src_dir_; // 工作目录路径的字符串
+  const char *set_cookie_;  // Set-Cookie头的值，为空指针时不添加
 
   char *mm_file_; // 响应文件内容映射到内存的指针
   struct stat mm_file_stat_;  // 响应读取的文件的信息
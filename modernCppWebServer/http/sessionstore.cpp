@@ -0,0 +1,212 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "sessionstore.h"
+
+#include <cstring>
+#include <random>
+
+namespace {
+
+inline uint64_t Rotl(uint64_t x, int b) {
+  return (x << b) | (x >> (64 - b));
+}
+
+inline void SipRound(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3) {
+  v0 += v1; v1 = Rotl(v1, 13); v1 ^= v0; v0 = Rotl(v0, 32);
+  v2 += v3; v3 = Rotl(v3, 16); v3 ^= v2;
+  v0 += v3; v3 = Rotl(v3, 21); v3 ^= v0;
+  v2 += v1; v1 = Rotl(v1, 17); v1 ^= v2; v2 = Rotl(v2, 32);
+}
+
+// 只对一个8字节的消息计算SipHash-2-4
+uint64_t SipHash24(const uint64_t key[2], uint64_t m) {
+  uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+  uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+  uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+  uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+  v3 ^= m;
+  SipRound(v0, v1, v2, v3);
+  SipRound(v0, v1, v2, v3);
+  v0 ^= m;
+  const uint64_t last = 8ULL << 56;  // 最后一块只有长度
+  v3 ^= last;
+  SipRound(v0, v1, v2, v3);
+  SipRound(v0, v1, v2, v3);
+  v0 ^= last;
+  v2 ^= 0xff;
+  for (int i = 0; i < 4; ++i) {
+    SipRound(v0, v1, v2, v3);
+  }
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+void ToHex(uint64_t value, char *out) {
+  static const char kDigits[] = "0123456789abcdef";
+  for (int i = 15; i >= 0; --i) {
+    out[i] = kDigits[value & 0xf];
+    value >>= 4;
+  }
+}
+
+bool FromHex(const char *in, uint64_t *value) {
+  uint64_t result = 0;
+  for (int i = 0; i < 16; ++i) {
+    char ch = in[i];
+    int digit;
+    if (ch >= '0' && ch <= '9') {
+      digit = ch - '0';
+    } else if (ch >= 'a' && ch <= 'f') {
+      digit = ch - 'a' + 10;
+    } else {
+      return false;
+    }
+    result = (result << 4) | digit;
+  }
+  *value = result;
+  return true;
+}
+
+// 每个线程一个随机数引擎，由random_device播种；会话号不需要不可预测，令牌的安全性由签名保证
+uint64_t RandomId() {
+  static thread_local std::mt19937_64 engine(
+      (static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()());
+  return engine();
+}
+
+} // namespace
+
+const int SessionStore::kTickMs;
+const int SessionStore::kShardNum;
+const size_t SessionStore::kTokenLen;
+const char SessionStore::kCookieName[] = "sid";
+
+SessionStore::SessionStore() : key_{0, 0}, ttl_sec_(0), capacity_(0), size_(0), hits_(0), cursor_(0) {
+}
+
+// 创建静态对象，单例模式获取对象的方法
+SessionStore *SessionStore::Instance() {
+  static SessionStore session_store;
+  return &session_store;
+}
+
+// 设置有效期和容量，签名密钥每次启动重新生成，重启后旧的令牌全部失效
+void SessionStore::Init(int ttl_sec, size_t capacity) {
+  std::random_device rd;
+  key_[0] = (static_cast<uint64_t>(rd()) << 32) | rd();
+  key_[1] = (static_cast<uint64_t>(rd()) << 32) | rd();
+  ttl_sec_ = ttl_sec;
+  capacity_ = capacity;
+  wheel_.assign(ttl_sec + 2, std::vector<uint64_t>());
+  cursor_ = 0;
+}
+
+uint64_t SessionStore::Sign_(uint64_t id) const {
+  return SipHash24(key_, id);
+}
+
+// 创建会话，挂到ttl_sec_+1个刻度之后的槽上，保证删除时至少已经过了ttl_sec_秒
+std::string SessionStore::Create(const char *user, size_t len) {
+  if (capacity_ == 0 || size_.load(std::memory_order_relaxed) >= capacity_) {
+    return std::string();
+  }
+  Session session{std::string(user, len), Clock::now() + std::chrono::seconds(ttl_sec_)};
+  uint64_t id;
+  while (true) {
+    id = RandomId();
+    Shard &shard = ShardOf_(id);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    if (shard.sessions.emplace(id, session).second) {
+      break;
+    }
+  }
+  size_.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> locker(wheel_mtx_);
+    wheel_[(cursor_ + ttl_sec_ + 1) % wheel_.size()].push_back(id);
+  }
+  char token[kTokenLen + 1];
+  ToHex(id, token);
+  token[16] = '.';
+  ToHex(Sign_(id), token + 17);
+  token[kTokenLen] = '\0';
+  return std::string(kCookieName) + "=" + token + "; Max-Age=" + std::to_string(ttl_sec_)
+      + "; Path=/; HttpOnly; SameSite=Lax";
+}
+
+// 在Cookie头的各个name=value中找到会话令牌，检查格式和签名
+bool SessionStore::ParseToken_(const char *cookie, size_t len, uint64_t *id) const {
+  const size_t name_len = sizeof(kCookieName) - 1;
+  const char *end = cookie + len;
+  const char *p = cookie;
+  while (p < end) {
+    while (p < end && (*p == ' ' || *p == ';')) {
+      ++p;
+    }
+    const char *item_end = static_cast<const char *>(memchr(p, ';', end - p));
+    if (item_end == nullptr) {
+      item_end = end;
+    }
+    if (static_cast<size_t>(item_end - p) == name_len + 1 + kTokenLen
+        && memcmp(p, kCookieName, name_len) == 0 && p[name_len] == '=') {
+      const char *token = p + name_len + 1;
+      uint64_t sign;
+      return token[16] == '.' && FromHex(token, id) && FromHex(token + 17, &sign) && sign == Sign_(*id);
+    }
+    p = item_end;
+  }
+  return false;
+}
+
+// 先验证签名，伪造或被篡改的令牌不会去查表
+bool SessionStore::Find(const char *cookie, size_t len, std::string *user) {
+  uint64_t id;
+  if (capacity_ == 0 || !ParseToken_(cookie, len, &id)) {
+    return false;
+  }
+  Shard &shard = ShardOf_(id);
+  std::lock_guard<std::mutex> locker(shard.mtx);
+  auto it = shard.sessions.find(id);
+  if (it == shard.sessions.end() || it->second.expires <= Clock::now()) {
+    // 已过期但还没轮到删除的会话同样无效
+    return false;
+  }
+  *user = it->second.user;
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+// 推进一格，删除这一格中的会话；主线程调用晚了时可能有会话还差一点才到期，挂到下一格
+void SessionStore::Tick() {
+  if (wheel_.empty()) {
+    return;
+  }
+  std::vector<uint64_t> expired;
+  {
+    std::lock_guard<std::mutex> locker(wheel_mtx_);
+    cursor_ = (cursor_ + 1) % wheel_.size();
+    expired.swap(wheel_[cursor_]);
+  }
+  std::vector<uint64_t> not_yet;
+  Clock::time_point now = Clock::now();
+  for (uint64_t id : expired) {
+    Shard &shard = ShardOf_(id);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.sessions.find(id);
+    if (it == shard.sessions.end()) {
+      continue;
+    }
+    if (it->second.expires > now) {
+      not_yet.push_back(id);
+      continue;
+    }
+    shard.sessions.erase(it);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  if (!not_yet.empty()) {
+    std::lock_guard<std::mutex> locker(wheel_mtx_);
+    std::vector<uint64_t> &slot = wheel_[(cursor_ + 1) % wheel_.size()];
+    slot.insert(slot.end(), not_yet.begin(), not_yet.end());
+  }
+}
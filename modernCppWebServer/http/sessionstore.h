@@ -0,0 +1,89 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_HTTP_SESSIONSTORE_H_
+#define MODERNCPPWEBSERVER_HTTP_SESSIONSTORE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 登录/注册成功后的会话，保存在内存中，客户端以Cookie携带令牌，之后的请求查表即可确认身份，不再访问数据库
+// 令牌为 64位随机会话号 + 会话号的SipHash-2-4签名（密钥在Init时随机生成），都以16进制表示，
+// 签名不对的令牌直接拒绝，不需要查表，伪造令牌要猜中密钥
+// 会话按会话号分片存放，每个分片一把锁；过期用时间轮处理：每个会话按到期的秒数挂在轮上的一个槽里，
+// 主线程每秒调用一次Tick()，只处理当前槽中的会话，每个会话的过期开销为O(1)，不需要扫描全表
+class SessionStore {
+ public:
+  // 创建静态对象，单例模式获取对象的方法
+  static SessionStore *Instance();
+
+  // 设置会话有效期（秒）和最多保存的会话数，生成签名密钥，需在服务器启动前调用，未调用时不创建会话
+  void Init(int ttl_sec, size_t capacity);
+
+  // 为用户创建会话，返回Set-Cookie头的值（含有效期等属性），会话数已满或未初始化时返回空字符串
+  std::string Create(const char *user, size_t len);
+  // 从请求的Cookie头中取出令牌，签名正确且会话未过期时写入用户名并返回true
+  bool Find(const char *cookie, size_t len, std::string *user);
+  // 推进时间轮，删除到期的会话，由主线程每kTickMs调用一次
+  void Tick();
+
+  // 当前保存的会话数
+  size_t Size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+  // 通过会话确认身份的次数
+  uint64_t Hits() const {
+    return hits_.load(std::memory_order_relaxed);
+  }
+
+  static const int kTickMs = 1000;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  SessionStore();
+  ~SessionStore() = default;
+
+  struct Session {
+    std::string user;
+    Clock::time_point expires;
+  };
+
+  // 每个分片按缓存行对齐，不同分片的锁不会发生伪共享
+  struct alignas(64) Shard {
+    std::mutex mtx;
+    std::unordered_map<uint64_t, Session> sessions;
+  };
+
+  Shard &ShardOf_(uint64_t id) {
+    return shards_[id % kShardNum];
+  }
+  // 计算会话号的签名
+  uint64_t Sign_(uint64_t id) const;
+  // 从"a=b; sid=xxx"形式的Cookie头中取出令牌并解析为会话号，签名不对返回false
+  bool ParseToken_(const char *cookie, size_t len, uint64_t *id) const;
+
+  static const int kShardNum = 16;
+  static const char kCookieName[];
+  static const size_t kTokenLen = 33;  // 16位会话号 + '.' + 16位签名
+
+  Shard shards_[kShardNum];
+  uint64_t key_[2];  // SipHash的128位密钥
+  int ttl_sec_;
+  size_t capacity_;
+  std::atomic<size_t> size_;
+  std::atomic<uint64_t> hits_;
+
+  // 时间轮，槽数为有效期的秒数加一，当前槽之后第ttl_sec_个槽存放此刻创建的会话
+  std::mutex wheel_mtx_;
+  std::vector<std::vector<uint64_t>> wheel_;
+  size_t cursor_;
+};
+
+#endif //MODERNCPPWEBSERVER_HTTP_SESSIONSTORE_H_
@@ -0,0 +1,163 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "accesslog.h"
+
+#include <cassert>
+#include <cstring>
+#include <sys/stat.h>
+
+AccessLog::AccessLog()
+    : is_open_(false),
+      is_close_(false),
+      sample_rate_(1),
+      format_(kJsonLines),
+      fp_(nullptr),
+      head_(0),
+      size_(0),
+      dropped_(0) {
+
+}
+
+AccessLog::~AccessLog() {
+  if (write_thread_ && write_thread_->joinable()) {
+    {
+      std::lock_guard<std::mutex> locker(mtx_);
+      is_close_ = true;
+    }
+    // 唤醒写线程，写线程会把队列中剩余的记录写完再退出
+    cond_.notify_one();
+    write_thread_->join();
+  }
+  if (fp_) {
+    std::fclose(fp_);
+  }
+}
+
+// 创建静态访问日志对象，单例模式获取对象的方法
+AccessLog *AccessLog::Instance() {
+  static AccessLog inst;
+  return &inst;
+}
+
+// 初始化访问日志，所有内存在这里一次性分配好，之后记录请求时不再分配
+void AccessLog::Init(const char *path, int sample_rate, Format format, size_t capacity) {
+  assert(capacity > 0);
+  if (is_open_) {
+    return;
+  }
+  sample_rate_ = sample_rate > 0 ? sample_rate : 1;
+  format_ = format;
+  ring_.resize(capacity);
+  batch_.resize(kBatchSize);
+
+  char file_name[256] = {0};
+  std::snprintf(file_name, sizeof(file_name) - 1, "%s/access%s", path,
+                format_ == kBinary ? ".bin" : ".log");
+  fp_ = std::fopen(file_name, "a");
+  if (fp_ == nullptr) {
+    // 打开失败可能是目录不存在，新建目录后再次打开
+    mkdir(path, 0777);
+    fp_ = std::fopen(file_name, "a");
+  }
+  assert(fp_ != nullptr);
+
+  is_open_ = true;
+  write_thread_.reset(new std::thread([this] { WriteLoop_(); }));
+}
+
+// 判断当前请求是否需要记录，错误响应总是记录，其余按1/N采样
+bool AccessLog::ShouldSample(int status) const {
+  if (status >= 400 || sample_rate_ == 1) {
+    return true;
+  }
+  static thread_local uint32_t count = 0;
+  return ++count % sample_rate_ == 0;
+}
+
+// 将一条记录拷贝到环形队列的空位中，队列满时丢弃
+void AccessLog::Push(const AccessRecord &record) {
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (size_ == ring_.size()) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    ring_[(head_ + size_) % ring_.size()] = record;
+    ++size_;
+  }
+  cond_.notify_one();
+}
+
+// 写线程，每次取出一批记录后立即释放锁，格式化和写文件都在锁外进行
+void AccessLog::WriteLoop_() {
+  while (true) {
+    size_t n = 0;
+    {
+      std::unique_lock<std::mutex> locker(mtx_);
+      while (size_ == 0 && !is_close_) {
+        cond_.wait(locker);
+      }
+      if (size_ == 0 && is_close_) {
+        break;
+      }
+      while (n < kBatchSize && size_ > 0) {
+        batch_[n++] = ring_[head_];
+        head_ = (head_ + 1) % ring_.size();
+        --size_;
+      }
+    }
+    if (format_ == kBinary) {
+      std::fwrite(&batch_[0], sizeof(AccessRecord), n, fp_);
+    } else {
+      for (size_t i = 0; i < n; ++i) {
+        std::fwrite(line_, 1, FormatJson_(batch_[i]), fp_);
+      }
+    }
+    std::fflush(fp_);
+  }
+}
+
+// 将一条记录格式化为json行，方法和路径来自客户端，其中的引号、反斜杠和控制字符需要转义
+size_t AccessLog::FormatJson_(const AccessRecord &record) {
+  char method[sizeof(record.method) * 6 + 1];
+  char path[sizeof(record.path) * 6 + 1];
+  EscapeJson_(record.method, sizeof(record.method), method);
+  EscapeJson_(record.path, sizeof(record.path), path);
+
+  int len = std::snprintf(line_, kLineSize,
+                          "{\"ts\":%lld,\"ip\":\"%s\",\"method\":\"%s\",\"path\":\"%s\","
+                          "\"status\":%d,\"bytes\":%lld,\"keep_alive\":%s,\"req\":%u,"
+                          "\"queue_us\":%u,\"parse_us\":%u,\"handler_us\":%u,\"write_us\":%u}\n",
+                          static_cast<long long>(record.timestamp_us), record.ip, method, path,
+                          record.status, static_cast<long long>(record.bytes),
+                          record.keep_alive ? "true" : "false", record.request_count,
+                          record.queue_us, record.parse_us, record.handler_us, record.write_us);
+  if (len < 0) {
+    return 0;
+  }
+  // kLineSize按最坏情况计算，截断会留下不完整的json对象，只可能是格式串改了而kLineSize没有跟着改
+  assert(static_cast<size_t>(len) < kLineSize);
+  if (static_cast<size_t>(len) >= kLineSize) {
+    line_[kLineSize - 1] = '\n';
+    return kLineSize;
+  }
+  return len;
+}
+
+void AccessLog::EscapeJson_(const char *src, size_t size, char *dst) {
+  size_t j = 0;
+  for (size_t i = 0; i < size && src[i]; ++i) {
+    unsigned char ch = src[i];
+    if (ch == '"' || ch == '\\') {
+      dst[j++] = '\\';
+      dst[j++] = ch;
+    } else if (ch < 0x20) {
+      j += std::snprintf(dst + j, 7, "\\u%04x", ch);
+    } else {
+      dst[j++] = ch;
+    }
+  }
+  dst[j] = '\0';
+}
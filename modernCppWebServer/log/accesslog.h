@@ -0,0 +1,98 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_LOG_ACCESSLOG_H_
+#define MODERNCPPWEBSERVER_LOG_ACCESSLOG_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+
+// 一条访问日志记录，全部为定长字段，填写和入队时不会分配内存
+struct AccessRecord {
+  int64_t timestamp_us;       // 请求完成时刻，unix时间戳（微秒）
+  char ip[INET_ADDRSTRLEN];   // 客户端ip
+  char method[8];             // 请求方法
+  char path[128];             // 请求路径，超长部分截断
+  int32_t status;             // 响应状态码
+  int64_t bytes;              // 响应总字节数（响应头 + 响应体）
+  uint32_t keep_alive;        // 是否为长连接
+  uint32_t request_count;     // 当前连接上的第几个请求
+  uint32_t queue_us;          // 读事件在线程池队列中等待的时间
+  uint32_t parse_us;          // 解析请求的时间（包括post表单的处理）
+  uint32_t handler_us;        // 生成响应的时间
+  uint32_t write_us;          // 从响应生成到最后一个字节写入套接字的时间
+};
+
+class AccessLog {
+ public:
+  enum Format {
+    kJsonLines = 0, // 每条记录一行json
+    kBinary,        // 直接写入AccessRecord结构体，便于离线工具批量解析
+  };
+
+  // 创建静态访问日志对象，单例模式获取对象的方法
+  static AccessLog *Instance();
+
+  // 初始化访问日志，sample_rate为N表示每N个请求记录一个（错误响应总是记录），capacity为环形队列容量
+  void Init(const char *path = "./log", int sample_rate = 1,
+            Format format = kJsonLines, size_t capacity = 4096);
+
+  bool IsOpen() const {
+    return is_open_;
+  }
+
+  // 判断当前请求是否需要记录，每个线程独立计数，不需要加锁
+  bool ShouldSample(int status) const;
+
+  // 将一条记录拷贝到环形队列中，队列满时丢弃并计数，不会阻塞工作线程
+  void Push(const AccessRecord &record);
+
+  // 返回因队列满而丢弃的记录数
+  uint64_t Dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  AccessLog();
+  ~AccessLog();
+
+  // 写线程，批量取出队列中的记录，格式化后写入文件
+  void WriteLoop_();
+  // 将一条记录格式化为json行，写入line_中，返回长度
+  size_t FormatJson_(const AccessRecord &record);
+  // 把最长size字节、以'\0'结尾的字符串转义为json字符串的内容写入dst，dst至少要有size * 6 + 1字节
+  static void EscapeJson_(const char *src, size_t size, char *dst);
+
+  static const size_t kBatchSize = 256; // 写线程每次从队列中取出的最大记录数
+  // 一条json行的最大长度：键名和标点共128字节，加上ip、转义后最长的method和path、各数值的最大位数
+  // （ts和bytes 20位，status 11位，5个uint32各10位，keep_alive 5个字符）和结尾的'\0'，整行总能放下
+  static const size_t kLineSize = 128 + INET_ADDRSTRLEN + sizeof(AccessRecord::method) * 6
+      + sizeof(AccessRecord::path) * 6 + 20 * 2 + 11 + 10 * 5 + 5 + 1;
+
+  bool is_open_;
+  bool is_close_;
+  int sample_rate_;
+  Format format_;
+  std::FILE *fp_;
+
+  std::vector<AccessRecord> ring_;  // 预先分配好的环形队列
+  size_t head_; // 下一个被写线程取出的位置
+  size_t size_; // 队列中的记录数
+  std::vector<AccessRecord> batch_; // 写线程的批量缓冲区，只由写线程访问
+  char line_[kLineSize];  // 写线程格式化json行的缓冲区
+
+  std::atomic<uint64_t> dropped_;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  std::unique_ptr<std::thread> write_thread_;
+};
+
+#endif //MODERNCPPWEBSERVER_LOG_ACCESSLOG_H_
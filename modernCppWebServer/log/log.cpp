@@ -3,6 +3,7 @@
 //
 
 #include "log.h"
+#include "../metrics/metrics.h"
 
 Log::Log()
     : line_count_(0),
@@ -146,7 +147,8 @@ void Log::Write(int level, const char *format, ...) {
     // std::unique_lock<std::mutex> locker(mtx_); // 这里unique_lock和lock_guard都可以吧
     std::lock_guard<std::mutex> locker(mtx_);
     ++line_count_;
-    // 将当前时间信息写入缓冲区
+    // 将当前时间信息写入缓冲区（缓冲区的空间从内存池借用，写之前先确保空间足够）
+    buff_.EnsureWritable(128);
     int n = snprintf(buff_.BeginWrite(), 128, "%d_%02d_%02d %02d:%02d:%02d.%06ld ", t.tm_year + 1900,
                      t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
     buff_.HasWritten(n);  // 更新缓冲区已写位置
@@ -154,8 +156,19 @@ void Log::Write(int level, const char *format, ...) {
 
     // 将valist的信息（也就是Write( format之后的...参数)，写入到缓冲区
     va_start(valist, format);
+    va_list valist_copy;
+    va_copy(valist_copy, valist);
     int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, valist);
     va_end(valist);
+    if (m >= 0 && static_cast<size_t>(m) >= buff_.WritableBytes()) {
+      // 可写空间不够时内容被截断，扩容后重新写一次
+      buff_.EnsureWritable(m + 1);
+      m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, valist_copy);
+    }
+    va_end(valist_copy);
+    if (m < 0) {
+      m = 0;  // 格式化出错时丢弃这部分内容
+    }
 
     // 标识已写长度
     buff_.HasWritten(m);
@@ -167,6 +180,9 @@ void Log::Write(int level, const char *format, ...) {
       deque_->PushBack(buff_.RetrieveAllToStr());
     } else {
       // 否则直接将缓冲区内容写入文件
+      if (is_async_) {
+        Metrics::Instance()->Add(Metrics::kLogQueueFull);
+      }
       std::fputs(buff_.Peek(), fp_);
     }
     buff_.RetrieveAll();
@@ -4,8 +4,15 @@
 // #include "./test/test.h"
 
 #include <unistd.h>
+#include <cstdlib>
 #include "server/webserver.h"
 
+// 读取环境变量，没有设置时返回默认值
+static const char *EnvOr(const char *name, const char *default_value) {
+  const char *value = getenv(name);
+  return value != nullptr && *value != '\0' ? value : default_value;
+}
+
 int main() {
   // tmp_test::TestLog();
   // tmp_test::TestThreadPool();
@@ -13,10 +20,19 @@ int main() {
   // 并在编译选项添加-L/usr/lib64/mysql -lmysqlclient -I/usr/include/mysql
   // 将GCC升级到4.9以上，支持正则
   // 注意路径名过长，导致response判断路径的stat错误
+  // 端口、线程数、日志开关和数据库配置可由环境变量覆盖（压测脚本bench/variants.sh使用），
+  // 设置WEBSERVER_USER_LOG时用户存放在该本地文件中，不连接MySQL
+  // 按客户端IP限速默认关闭：同一NAT或代理后面的用户共用一个IP，按单个IP设的阈值会误伤他们；
+  // 直接面对客户端部署时设置WEBSERVER_RATE_LIMIT=1开启，阈值见WebServer的kRequestRate、kLoginRate等常量
   WebServer server(
-      1316, 3, 60000, false,  /* 端口 ET模式 timeout_ms 优雅退出  */
-      3306, "jiyu", "L248132240", "tinywebserver",  /* Mysql配置 */
-      12, 6, true, 1, 1024);  /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+      atoi(EnvOr("WEBSERVER_PORT", "1316")), 3, 60000, false,  /* 端口 ET模式 timeout_ms 优雅退出  */
+      atoi(EnvOr("WEBSERVER_SQL_PORT", "3306")), EnvOr("WEBSERVER_SQL_USER", "jiyu"),
+      EnvOr("WEBSERVER_SQL_PWD", "L248132240"), EnvOr("WEBSERVER_SQL_DB", "tinywebserver"),  /* Mysql配置 */
+      12, atoi(EnvOr("WEBSERVER_THREADS", "6")), atoi(EnvOr("WEBSERVER_LOG", "1")) != 0, 1, 1024,
+      /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+      0, true, true,  /* 访问日志采样率1/N，0为关闭 本机/metrics统计页面开关 异步数据库验证开关 */
+      EnvOr("WEBSERVER_USER_LOG", nullptr),  /* 本地用户文件 */
+      atoi(EnvOr("WEBSERVER_RATE_LIMIT", "0")) != 0);  /* 按客户端IP限速，默认关闭 */
 
   server.Start();
   return 0;
@@ -0,0 +1,348 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "heavyhitters.h"
+
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <unordered_map>
+
+const int HeavyHitters::kWindowSec;
+const size_t HeavyHitters::kMaxKeyLen;
+const size_t HeavyHitters::kReportNum;
+const int HeavyHitters::kDepth;
+const int HeavyHitters::kWidth;
+const int HeavyHitters::kCandidates;
+const int HeavyHitters::kMaxShards;
+const int HeavyHitters::kKeyWords;
+
+namespace {
+
+// 每个线程的编号，所有HeavyHitters对象共用，线程第一次计数时分配
+std::atomic<int> g_thread_count(0);
+
+int ThreadIndex() {
+  static thread_local int index = -1;
+  if (index < 0) {
+    index = g_thread_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  return index;
+}
+
+} // namespace
+
+HeavyHitters::HeavyHitters(KeyType type) : type_(type) {
+  for (std::atomic<Shard *> &shard : shards_) {
+    shard.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+HeavyHitters::~HeavyHitters() {
+  for (std::atomic<Shard *> &shard : shards_) {
+    Shard *ptr = shard.load(std::memory_order_relaxed);
+    if (ptr != nullptr) {
+      ptr->~Shard();
+      munmap(ptr, sizeof(Shard));
+    }
+  }
+}
+
+// 创建静态对象，单例模式获取对象的方法
+HeavyHitters *HeavyHitters::Clients() {
+  static HeavyHitters clients(kIpv4);
+  return &clients;
+}
+
+HeavyHitters *HeavyHitters::Paths() {
+  static HeavyHitters paths(kText);
+  return &paths;
+}
+
+// 分片用mmap分配，按页对齐并且已经清零；分配后以release发布，抓取线程看到指针时也能看到初始化后的内容
+HeavyHitters::Shard *HeavyHitters::LocalShard_() {
+  int index = ThreadIndex();
+  if (index >= kMaxShards) {
+    return nullptr;
+  }
+  Shard *shard = shards_[index].load(std::memory_order_relaxed);
+  if (shard == nullptr) {
+    void *mem = mmap(nullptr, sizeof(Shard), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      return nullptr;
+    }
+    shard = new(mem) Shard();
+    shard->epoch.store(NowEpoch_(), std::memory_order_relaxed);
+    shards_[index].store(shard, std::memory_order_release);
+  }
+  return shard;
+}
+
+// 粗粒度时钟只读vDSO中的值，窗口以秒计，精度足够
+int64_t HeavyHitters::NowEpoch_() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return static_cast<int64_t>(ts.tv_sec) / kWindowSec;
+}
+
+// FNV-1a后再用murmur3的收尾混合，让高32位和低32位都足够均匀
+uint64_t HeavyHitters::Hash_(const char *key, size_t len) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<unsigned char>(key[i]);
+    hash *= 1099511628211ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// 保守更新：只增加等于最小值的那几行，估计值为最小值加1，比每行都加1的误差小得多
+void HeavyHitters::Record(const void *key, size_t len) {
+  Shard *shard = LocalShard_();
+  if (shard == nullptr) {
+    return;
+  }
+  int64_t epoch = NowEpoch_();
+  if (epoch != shard->epoch.load(std::memory_order_relaxed)) {
+    Decay_(*shard, epoch);
+  }
+  const char *data = static_cast<const char *>(key);
+  len = std::min(len, kMaxKeyLen);
+  uint64_t hash = Hash_(data, len);
+  int cells[kDepth];
+  uint32_t count = UINT32_MAX;
+  for (int row = 0; row < kDepth; ++row) {
+    cells[row] = Cell_(hash, row);
+    count = std::min(count, shard->sketch[cells[row]].load(std::memory_order_relaxed));
+  }
+  if (count == UINT32_MAX) {
+    return;
+  }
+  ++count;
+  // 只有本线程写这个分片，读出再写回即可，不需要原子读改写
+  for (int row = 0; row < kDepth; ++row) {
+    if (shard->sketch[cells[row]].load(std::memory_order_relaxed) < count) {
+      shard->sketch[cells[row]].store(count, std::memory_order_relaxed);
+    }
+  }
+  UpdateTop_(*shard, hash, data, len, count);
+}
+
+// 计数右移经过的窗口数；移位不改变计数的大小关系，堆不需要调整
+// 抓取线程可能读到衰减到一半的sketch，最多让这一次的结果偏差一个窗口
+void HeavyHitters::Decay_(Shard &shard, int64_t epoch) {
+  int64_t steps = epoch - shard.epoch.load(std::memory_order_relaxed);
+  int shift = steps >= 32 || steps < 0 ? 32 : static_cast<int>(steps);
+  for (std::atomic<uint32_t> &cell : shard.sketch) {
+    uint32_t value = cell.load(std::memory_order_relaxed);
+    if (value != 0) {
+      cell.store(shift >= 32 ? 0 : value >> shift, std::memory_order_relaxed);
+    }
+  }
+  int slot_num = shard.slot_num.load(std::memory_order_relaxed);
+  for (int i = 0; i < slot_num; ++i) {
+    shard.top_count[i] = shift >= 32 ? 0 : shard.top_count[i] >> shift;
+  }
+  shard.epoch.store(epoch, std::memory_order_release);
+}
+
+// 已是候选键时更新计数；候选未满时加入；否则只有超过堆顶（最小的候选）时才替换它
+// 候选键的估计值只增不减（衰减时和堆一起右移），这次一定大于记下的计数，所以候选已满时不超过堆顶的键不可能是候选，
+// 长尾中的大多数键不需要逐个比较候选
+void HeavyHitters::UpdateTop_(Shard &shard, uint64_t hash, const char *key, size_t len, uint32_t count) {
+  int slot_num = shard.slot_num.load(std::memory_order_relaxed);
+  if (slot_num == kCandidates && count <= shard.top_count[shard.heap[0]]) {
+    return;
+  }
+  for (int i = 0; i < slot_num; ++i) {
+    if (shard.top_hash[i] == hash) {
+      shard.top_count[i] = count;
+      SiftDown_(shard, shard.heap_pos[i]);
+      return;
+    }
+  }
+  if (slot_num < kCandidates) {
+    int slot = slot_num;
+    WriteSlot_(shard.slots[slot], hash, key, len);
+    shard.top_hash[slot] = hash;
+    shard.top_count[slot] = count;
+    shard.heap[slot_num] = slot;
+    shard.heap_pos[slot] = slot_num;
+    shard.slot_num.store(slot_num + 1, std::memory_order_release);
+    SiftUp_(shard, slot_num);
+    return;
+  }
+  int slot = shard.heap[0];
+  WriteSlot_(shard.slots[slot], hash, key, len);
+  shard.top_hash[slot] = hash;
+  shard.top_count[slot] = count;
+  SiftDown_(shard, 0);
+}
+
+void HeavyHitters::SwapHeap_(Shard &shard, int a, int b) {
+  std::swap(shard.heap[a], shard.heap[b]);
+  shard.heap_pos[shard.heap[a]] = a;
+  shard.heap_pos[shard.heap[b]] = b;
+}
+
+void HeavyHitters::SiftUp_(Shard &shard, int pos) {
+  while (pos > 0) {
+    int parent = (pos - 1) / 2;
+    if (shard.top_count[shard.heap[parent]] <= shard.top_count[shard.heap[pos]]) {
+      break;
+    }
+    SwapHeap_(shard, pos, parent);
+    pos = parent;
+  }
+}
+
+void HeavyHitters::SiftDown_(Shard &shard, int pos) {
+  int size = shard.slot_num.load(std::memory_order_relaxed);
+  while (true) {
+    int child = pos * 2 + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && shard.top_count[shard.heap[child + 1]] < shard.top_count[shard.heap[child]]) {
+      ++child;
+    }
+    if (shard.top_count[shard.heap[pos]] <= shard.top_count[shard.heap[child]]) {
+      break;
+    }
+    SwapHeap_(shard, pos, child);
+    pos = child;
+  }
+}
+
+// 顺序锁：写之前序号变为奇数，写完变为偶数
+void HeavyHitters::WriteSlot_(Slot &slot, uint64_t hash, const char *key, size_t len) {
+  uint64_t words[kKeyWords] = {};
+  memcpy(words, key, len);
+  uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.hash.store(hash, std::memory_order_relaxed);
+  slot.len.store(static_cast<uint32_t>(len), std::memory_order_relaxed);
+  for (int i = 0; i < kKeyWords; ++i) {
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+// 读前后序号相同且为偶数时读到的是完整的键；一直在被改写的候选键本来就不稳定，重试几次后放弃
+bool HeavyHitters::ReadSlot_(const Slot &slot, uint64_t *hash, std::string *key) {
+  for (int attempt = 0; attempt < 4; ++attempt) {
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+    uint64_t words[kKeyWords];
+    *hash = slot.hash.load(std::memory_order_relaxed);
+    uint32_t len = slot.len.load(std::memory_order_relaxed);
+    for (int i = 0; i < kKeyWords; ++i) {
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) == seq) {
+      key->assign(reinterpret_cast<const char *>(words), std::min<size_t>(len, kMaxKeyLen));
+      return true;
+    }
+  }
+  return false;
+}
+
+// 合并sketch时，落后当前窗口的分片（线程最近没有计数，还没有衰减）按落后的窗口数折算
+std::vector<HeavyHitters::Item> HeavyHitters::Top(size_t k) const {
+  int64_t epoch = NowEpoch_();
+  std::vector<double> sketch(kDepth * kWidth, 0.0);
+  std::unordered_map<uint64_t, std::string> candidates;
+  uint64_t hash;
+  std::string key;
+  for (const std::atomic<Shard *> &ptr : shards_) {
+    const Shard *shard = ptr.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    int64_t behind = epoch - shard->epoch.load(std::memory_order_acquire);
+    if (behind >= 32) {
+      continue;
+    }
+    double scale = behind > 0 ? std::ldexp(1.0, -static_cast<int>(behind)) : 1.0;
+    for (int i = 0; i < kDepth * kWidth; ++i) {
+      sketch[i] += scale * shard->sketch[i].load(std::memory_order_relaxed);
+    }
+    int slot_num = shard->slot_num.load(std::memory_order_acquire);
+    for (int i = 0; i < slot_num; ++i) {
+      if (ReadSlot_(shard->slots[i], &hash, &key)) {
+        candidates.emplace(hash, key);
+      }
+    }
+  }
+
+  std::vector<Item> items;
+  items.reserve(candidates.size());
+  for (auto &candidate : candidates) {
+    double count = sketch[Cell_(candidate.first, 0)];
+    for (int row = 1; row < kDepth; ++row) {
+      count = std::min(count, sketch[Cell_(candidate.first, row)]);
+    }
+    if (count >= 1.0) {
+      items.push_back({std::move(candidate.second), count});
+    }
+  }
+  std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+    return a.count > b.count;
+  });
+  if (items.size() > k) {
+    items.resize(k);
+  }
+  return items;
+}
+
+// 路径来自客户端，输出前转义引号和反斜杠，不可打印的字节换成'?'
+void HeavyHitters::Render(std::string &out, const char *name, const char *help, const char *label) const {
+  out += "# HELP ";
+  out += name;
+  out += ' ';
+  out += help;
+  out += "\n# TYPE ";
+  out += name;
+  out += " gauge\n";
+  char value[INET_ADDRSTRLEN + 32];
+  for (const Item &item : Top(kReportNum)) {
+    out += name;
+    out += '{';
+    out += label;
+    out += "=\"";
+    if (type_ == kIpv4 && item.key.size() == sizeof(in_addr)) {
+      in_addr addr;
+      memcpy(&addr, item.key.data(), sizeof(addr));
+      inet_ntop(AF_INET, &addr, value, sizeof(value));
+      out += value;
+    } else {
+      for (char c : item.key) {
+        if (c == '"' || c == '\\') {
+          out += '\\';
+          out += c;
+        } else if (c < 0x20 || c == 0x7f) {
+          out += '?';
+        } else {
+          out += c;
+        }
+      }
+    }
+    snprintf(value, sizeof(value), "\"} %.0f\n", item.count);
+    out += value;
+  }
+}
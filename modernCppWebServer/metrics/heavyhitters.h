@@ -0,0 +1,105 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_METRICS_HEAVYHITTERS_H_
+#define MODERNCPPWEBSERVER_METRICS_HEAVYHITTERS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 找出当前请求最多的键（客户端IP、请求路径），不为每个键保存状态
+// 每个线程一个分片：一个Count-Min Sketch（保守更新）加一个候选键的小顶堆，只由所属线程写，不加锁也没有原子读改写
+// 计数按时间衰减：每经过一个窗口（kWindowSec秒）减半，近似为最近两个窗口内的请求数，过去的热点会逐渐退出
+// 抓取时合并：各分片的sketch逐项相加（没有及时衰减的空闲分片按落后的窗口数折算），
+// 所有分片的候选键用合并后的sketch重新估计后排序；估计值只会偏大，偏大的量不超过总数的e/kWidth
+class HeavyHitters {
+ public:
+  // 键的类型，决定输出时的格式
+  enum KeyType {
+    kIpv4,  // 4字节网络字节序的IPv4地址
+    kText,  // 字符串，如请求路径
+  };
+
+  struct Item {
+    std::string key;
+    double count;  // 衰减后的请求数
+  };
+
+  // 按客户端IP和按请求路径统计的两个对象，单例模式获取对象的方法
+  static HeavyHitters *Clients();
+  static HeavyHitters *Paths();
+
+  explicit HeavyHitters(KeyType type);
+  ~HeavyHitters();
+
+  // 在当前线程的分片上给键计数一次，超过kMaxKeyLen的部分被截掉
+  void Record(const void *key, size_t len);
+
+  // 合并所有分片，返回估计请求数最多的k个键，从多到少排列
+  std::vector<Item> Top(size_t k) const;
+
+  // 以Prometheus文本格式输出前kReportNum个键，每个键一行，标签名为label
+  void Render(std::string &out, const char *name, const char *help, const char *label) const;
+
+  static const int kWindowSec = 10;
+  static const size_t kMaxKeyLen = 64;
+  static const size_t kReportNum = 10;
+
+ private:
+  static const int kDepth = 4;
+  static const int kWidth = 2048;
+  static const int kCandidates = 32;   // 每个分片保留的候选键数
+  static const int kMaxShards = 64;    // 超过这么多线程时，多出的线程不计数
+  static const int kKeyWords = kMaxKeyLen / 8;
+
+  // 候选键，所属线程写、抓取线程读，用顺序锁保证读到的键是完整的
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> len;
+    std::atomic<uint64_t> hash;
+    std::atomic<uint64_t> words[kKeyWords];
+  };
+
+  struct alignas(64) Shard {
+    std::atomic<uint32_t> sketch[kDepth * kWidth];
+    std::atomic<int64_t> epoch;       // 计数对应的窗口编号
+    std::atomic<int> slot_num;        // 已使用的候选键数
+    Slot slots[kCandidates];
+    // 以下只由所属线程访问：按计数排列的小顶堆，元素为候选键下标
+    uint64_t top_hash[kCandidates];
+    uint32_t top_count[kCandidates];
+    int heap[kCandidates];
+    int heap_pos[kCandidates];
+  };
+
+  // 返回当前线程的分片，第一次调用时分配
+  Shard *LocalShard_();
+
+  // 把分片的计数衰减到epoch窗口
+  static void Decay_(Shard &shard, int64_t epoch);
+  static void UpdateTop_(Shard &shard, uint64_t hash, const char *key, size_t len, uint32_t count);
+  static void WriteSlot_(Slot &slot, uint64_t hash, const char *key, size_t len);
+  static bool ReadSlot_(const Slot &slot, uint64_t *hash, std::string *key);
+  static void SiftUp_(Shard &shard, int pos);
+  static void SiftDown_(Shard &shard, int pos);
+  static void SwapHeap_(Shard &shard, int a, int b);
+
+  static uint64_t Hash_(const char *key, size_t len);
+  static int64_t NowEpoch_();
+
+  // 第row行中hash对应的下标
+  static int Cell_(uint64_t hash, int row) {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    return row * kWidth + static_cast<int>((h1 + row * h2) & (kWidth - 1));
+  }
+
+  KeyType type_;
+  std::atomic<Shard *> shards_[kMaxShards];
+};
+
+#endif //MODERNCPPWEBSERVER_METRICS_HEAVYHITTERS_H_
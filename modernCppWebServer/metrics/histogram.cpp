@@ -0,0 +1,64 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "histogram.h"
+
+#include <cassert>
+
+// 将本直方图的计数加到counts中，返回数值总和
+uint64_t LatencyHistogram::MergeTo(std::vector<uint64_t> &counts) const {
+  assert(counts.size() == static_cast<size_t>(kBucketNum));
+  for (int i = 0; i < kBucketNum; ++i) {
+    counts[i] += counts_[i].load(std::memory_order_relaxed);
+  }
+  return sum_.load(std::memory_order_relaxed);
+}
+
+// 返回值所在的桶的下标
+// 值v的最高位为msb时，取最高的kSubBucketBits+1位作为子桶，移位数shift = msb - kSubBucketBits决定所在区间
+int LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < static_cast<uint64_t>(kSubBucketCount)) {
+    return static_cast<int>(value);
+  }
+  int msb = 63 - __builtin_clzll(value);
+  int shift = msb - kSubBucketBits;
+  if (shift > kMaxShift) {
+    return kBucketNum - 1;
+  }
+  int sub = static_cast<int>(value >> shift) - kSubBucketCount;
+  return kSubBucketCount + shift * kSubBucketCount + sub;
+}
+
+// 返回桶内的最大值
+uint64_t LatencyHistogram::BucketUpper(int index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  int shift = (index - kSubBucketCount) / kSubBucketCount;
+  uint64_t sub = (index - kSubBucketCount) % kSubBucketCount + kSubBucketCount;
+  return ((sub + 1) << shift) - 1;
+}
+
+// 根据合并后的计数求分位数q，从小到大累加计数，直到超过总数的q倍
+uint64_t LatencyHistogram::Quantile(const std::vector<uint64_t> &counts, double q) {
+  uint64_t total = 0;
+  for (uint64_t count : counts) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(q * total);
+  if (rank >= total) {
+    rank = total - 1;
+  }
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketNum; ++i) {
+    seen += counts[i];
+    if (seen > rank) {
+      return BucketUpper(i);
+    }
+  }
+  return BucketUpper(kBucketNum - 1);
+}
@@ -0,0 +1,44 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_METRICS_HISTOGRAM_H_
+#define MODERNCPPWEBSERVER_METRICS_HISTOGRAM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 对数线性分桶的延迟直方图（HdrHistogram的分桶方式），数值单位为微秒
+// 小于16的值每个值一个桶，之后每个2的幂区间再线性均分为16个子桶，相对误差不超过1/16
+// 只由所属线程写入（relaxed原子加），读取时多个直方图的计数直接相加，不需要加锁
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 4;
+  static const int kSubBucketCount = 1 << kSubBucketBits;
+  static const int kMaxShift = 36;  // 最大可记录约2^41微秒（约25天），更大的值记在最后一个桶
+  static const int kBucketNum = kSubBucketCount + (kMaxShift + 1) * kSubBucketCount;
+
+  // 记录一个值
+  void Record(uint64_t value) {
+    counts_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  // 将本直方图的计数加到counts中（counts大小为kBucketNum），返回数值总和
+  uint64_t MergeTo(std::vector<uint64_t> &counts) const;
+
+  // 返回值所在的桶的下标
+  static int BucketIndex(uint64_t value);
+  // 返回桶内的最大值，用于估计分位数
+  static uint64_t BucketUpper(int index);
+  // 根据合并后的计数求分位数q（0到1之间），没有数据时返回0
+  static uint64_t Quantile(const std::vector<uint64_t> &counts, double q);
+
+ private:
+  std::atomic<uint64_t> counts_[kBucketNum];
+  std::atomic<uint64_t> sum_;
+};
+
+#endif //MODERNCPPWEBSERVER_METRICS_HISTOGRAM_H_
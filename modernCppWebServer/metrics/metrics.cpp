@@ -0,0 +1,208 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "../log/log.h"
+
+namespace {
+
+// 计数器在输出中的名字、标签和说明，顺序与Metrics::Counter一致
+struct CounterDesc {
+  const char *name;
+  const char *label;
+  const char *help;
+};
+
+const CounterDesc kCounterDesc[Metrics::kCounterNum] = {
+    {"webserver_accepts_total", "", "Accepted connections."},
+    {"webserver_accept_rejects_total", "", "Connections rejected because the server was full."},
+    {"webserver_connections_opened_total", "", "Client connections opened."},
+    {"webserver_connections_closed_total", "", "Client connections closed."},
+    {"webserver_bytes_in_total", "", "Bytes read from client sockets."},
+    {"webserver_bytes_out_total", "", "Bytes written to client sockets."},
+    {"webserver_responses_total", "code=\"2xx\"", "HTTP responses by status code."},
+    {"webserver_responses_total", "code=\"400\"", ""},
+    {"webserver_responses_total", "code=\"403\"", ""},
+    {"webserver_responses_total", "code=\"404\"", ""},
+    {"webserver_responses_total", "code=\"4xx\"", ""},
+    {"webserver_responses_total", "code=\"503\"", ""},
+    {"webserver_responses_total", "code=\"5xx\"", ""},
+    {"webserver_sql_pool_waits_total", "", "GetConn calls that had to wait for a free connection."},
+    {"webserver_sql_pool_timeouts_total", "", "GetConn calls that failed because no connection became available in time."},
+    {"webserver_sql_conn_discards_total", "", "SQL connections closed after a lost connection, a failed ping or a query timeout."},
+    {"webserver_log_queue_full_total", "", "Log lines written synchronously because the async queue was full."},
+    {"webserver_timer_expirations_total", "", "Connections closed by the idle timer."},
+    {"webserver_shed_total", "reason=\"queue_full\"", "Requests answered with 503 instead of being processed."},
+    {"webserver_shed_total", "reason=\"queue_delay\"", ""},
+};
+
+const char *const kStageName[Metrics::kStageNum] = {
+    "accept_to_first_byte", "queue_wait", "parse", "make_response", "sql_verify", "sql_pool_wait",
+    "write", "timer_tick", "event_dispatch",
+};
+
+const double kQuantiles[] = {0.5, 0.99, 0.999};
+
+} // namespace
+
+const int Metrics::kMaxShards;
+
+// 单例为静态对象，分片中的计数器和直方图在程序启动时已经零初始化
+Metrics::Metrics() : shard_count_(0) {
+  for (auto &last : last_latency_) {
+    last.assign(LatencyHistogram::kBucketNum, 0);
+  }
+}
+
+// 创建静态统计对象，单例模式获取对象的方法
+Metrics *Metrics::Instance() {
+  static Metrics inst;
+  return &inst;
+}
+
+// 返回当前线程的分片，线程第一次调用时分配
+Metrics::Shard &Metrics::LocalShard_() {
+  static thread_local int index = -1;
+  if (index < 0) {
+    index = shard_count_.fetch_add(1, std::memory_order_relaxed) % kMaxShards;
+  }
+  return shards_[index];
+}
+
+// 将状态码映射到对应的计数器
+Metrics::Counter Metrics::StatusCounter_(int code) {
+  switch (code) {
+    case 400:return kResp400;
+    case 403:return kResp403;
+    case 404:return kResp404;
+    case 503:return kResp503;
+    default:break;
+  }
+  if (code >= 500) {
+    return kResp5xxOther;
+  }
+  if (code >= 400) {
+    return kResp4xxOther;
+  }
+  return kResp2xx;
+}
+
+// 汇总所有分片，返回计数器的当前值
+uint64_t Metrics::Get(Counter counter) const {
+  uint64_t sum = 0;
+  int n = std::min(shard_count_.load(std::memory_order_relaxed), kMaxShards);
+  for (int i = 0; i < n; ++i) {
+    sum += shards_[i].counters[counter].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+// 合并所有分片上某个阶段的直方图，返回数值总和
+uint64_t Metrics::MergeLatency_(Stage stage, std::vector<uint64_t> &counts) const {
+  counts.assign(LatencyHistogram::kBucketNum, 0);
+  uint64_t sum = 0;
+  int n = std::min(shard_count_.load(std::memory_order_relaxed), kMaxShards);
+  for (int i = 0; i < n; ++i) {
+    sum += shards_[i].latency[stage].MergeTo(counts);
+  }
+  return sum;
+}
+
+// 注册一个在抓取时才求值的瞬时值
+void Metrics::RegisterGauge(const char *name, const char *help,
+                            std::function<double()> getter, bool is_counter) {
+  std::lock_guard<std::mutex> locker(gauge_mtx_);
+  gauges_.push_back({name, help, is_counter ? "counter" : "gauge", std::move(getter)});
+}
+
+void Metrics::RegisterSection(std::function<void(std::string &)> render) {
+  std::lock_guard<std::mutex> locker(gauge_mtx_);
+  sections_.push_back(std::move(render));
+}
+
+// 以Prometheus文本格式输出所有统计项
+void Metrics::Render(std::string &out) const {
+  char line[256];
+  for (int i = 0; i < kCounterNum; ++i) {
+    const CounterDesc &desc = kCounterDesc[i];
+    if (desc.help[0] != '\0') {
+      // 同名带标签的计数器只在第一个输出HELP和TYPE
+      snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n", desc.name, desc.help, desc.name);
+      out += line;
+    }
+    unsigned long long value = Get(static_cast<Counter>(i));
+    if (desc.label[0] != '\0') {
+      snprintf(line, sizeof(line), "%s{%s} %llu\n", desc.name, desc.label, value);
+    } else {
+      snprintf(line, sizeof(line), "%s %llu\n", desc.name, value);
+    }
+    out += line;
+  }
+
+  // 当前连接数由各线程上的建立、关闭计数相减得到，不需要一个全局竞争的计数器
+  long long connections = static_cast<long long>(Get(kConnOpened)) - static_cast<long long>(Get(kConnClosed));
+  snprintf(line, sizeof(line),
+           "# HELP webserver_connections Open client connections.\n"
+           "# TYPE webserver_connections gauge\nwebserver_connections %lld\n", connections);
+  out += line;
+
+  // 各阶段延迟以summary类型输出，分位数为启动以来的累计值
+  out += "# HELP webserver_stage_latency_us Per-stage latency in microseconds.\n"
+         "# TYPE webserver_stage_latency_us summary\n";
+  std::vector<uint64_t> counts;
+  for (int stage = 0; stage < kStageNum; ++stage) {
+    unsigned long long sum = MergeLatency_(static_cast<Stage>(stage), counts);
+    unsigned long long total = 0;
+    for (uint64_t count : counts) {
+      total += count;
+    }
+    for (double q : kQuantiles) {
+      snprintf(line, sizeof(line), "webserver_stage_latency_us{stage=\"%s\",quantile=\"%g\"} %llu\n",
+               kStageName[stage], q,
+               static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, q)));
+      out += line;
+    }
+    snprintf(line, sizeof(line), "webserver_stage_latency_us_sum{stage=\"%s\"} %llu\n"
+                                 "webserver_stage_latency_us_count{stage=\"%s\"} %llu\n",
+             kStageName[stage], sum, kStageName[stage], total);
+    out += line;
+  }
+
+  std::lock_guard<std::mutex> locker(gauge_mtx_);
+  for (const Gauge &gauge : gauges_) {
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %g\n",
+             gauge.name, gauge.help, gauge.name, gauge.type, gauge.name, gauge.getter());
+    out += line;
+  }
+  for (const auto &render : sections_) {
+    render(out);
+  }
+}
+
+// 将上次调用以来各阶段延迟的分位数写入日志，用两次累计计数之差得到区间内的分布
+void Metrics::LogLatencySummary() {
+  std::vector<uint64_t> counts;
+  for (int stage = 0; stage < kStageNum; ++stage) {
+    MergeLatency_(static_cast<Stage>(stage), counts);
+    std::vector<uint64_t> &last = last_latency_[stage];
+    unsigned long long total = 0;
+    for (int i = 0; i < LatencyHistogram::kBucketNum; ++i) {
+      uint64_t now = counts[i];
+      counts[i] -= last[i];
+      last[i] = now;
+      total += counts[i];
+    }
+    if (total == 0) {
+      continue;
+    }
+    LOG_INFO("latency %s: count=%llu p50=%lluus p99=%lluus p999=%lluus", kStageName[stage], total,
+             static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.5)),
+             static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.99)),
+             static_cast<unsigned long long>(LatencyHistogram::Quantile(counts, 0.999)));
+  }
+}
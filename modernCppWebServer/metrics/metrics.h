@@ -0,0 +1,130 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_METRICS_METRICS_H_
+#define MODERNCPPWEBSERVER_METRICS_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+// 运行时统计，计数器按线程分片，每个分片独占一个缓存行，抓取（scrape）时再汇总
+class Metrics {
+ public:
+  enum Counter {
+    kAccepts = 0,     // accept成功的连接数
+    kAcceptRejects,   // 因连接数已满而拒绝的连接数
+    kConnOpened,      // 建立的连接数
+    kConnClosed,      // 关闭的连接数
+    kBytesIn,         // 从套接字读入的字节数
+    kBytesOut,        // 向套接字写出的字节数
+    kResp2xx,         // 各状态码的响应数，见StatusCounter_()
+    kResp400,
+    kResp403,
+    kResp404,
+    kResp4xxOther,
+    kResp503,
+    kResp5xxOther,
+    kSqlPoolWaits,    // 获取数据库连接时需要等待的次数
+    kSqlPoolTimeouts, // 获取数据库连接超时（或数据库不可用）而失败的次数
+    kSqlConnDiscards, // 因断开、ping失败、查询超时或连接池关闭而关闭的数据库连接数
+    kLogQueueFull,    // 日志异步队列已满，退化为同步写的次数
+    kTimerExpired,    // 定时器超时关闭的连接数
+    kShedQueueFull,   // 线程池队列已满而拒绝的请求数
+    kShedQueueDelay,  // 排队时间持续过长（CoDel）而拒绝的请求数
+    kCounterNum,
+  };
+
+  // 分阶段统计的延迟，单位为微秒
+  enum Stage {
+    kFirstByte = 0, // 从accept到向客户端写出第一个字节
+    kQueueWait,     // 任务在线程池队列中的等待时间
+    kParse,         // HttpRequest::Parse
+    kMakeResponse,  // HttpResponse::MakeResponse
+    kSqlVerify,     // HttpRequest::UserVerify的数据库往返
+    kSqlPoolWait,   // 没有空闲数据库连接时在连接池上等待的时间
+    kWrite,         // 响应生成后到全部写入套接字
+    kTimerTick,     // 主线程每轮事件循环中HeapTimer::GetNextTick的耗时
+    kEventDispatch, // 主线程处理epoll_wait返回的一批就绪事件的耗时
+    kStageNum,
+  };
+
+  // 创建静态统计对象，单例模式获取对象的方法
+  static Metrics *Instance();
+
+  // 在当前线程的分片上给计数器加n
+  void Add(Counter counter, uint64_t n = 1) {
+    LocalShard_().counters[counter].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  // 按响应状态码计数
+  void AddStatus(int code) {
+    Add(StatusCounter_(code));
+  }
+
+  // 在当前线程的分片上记录一次延迟
+  void RecordLatency(Stage stage, uint64_t us) {
+    LocalShard_().latency[stage].Record(us);
+  }
+
+  // 汇总所有分片，返回计数器的当前值
+  uint64_t Get(Counter counter) const;
+
+  // 注册一个在抓取时才求值的瞬时值，如线程池队列长度，需在服务器启动前注册
+  // 其他模块自己维护的累计值（如访问日志丢弃数）也通过这里导出，is_counter为true
+  void RegisterGauge(const char *name, const char *help,
+                     std::function<double()> getter, bool is_counter = false);
+
+  // 注册一段在抓取时才生成的带标签的多行输出（如请求最多的客户端），在所有统计项之后输出，需在服务器启动前注册
+  void RegisterSection(std::function<void(std::string &)> render);
+
+  // 以Prometheus文本格式输出所有统计项
+  void Render(std::string &out) const;
+
+  // 将上次调用以来各阶段延迟的p50/p99/p999写入日志，只由主线程定期调用
+  void LogLatencySummary();
+
+ private:
+  Metrics();
+  ~Metrics() = default;
+
+  // 每个分片按缓存行对齐，不同线程的计数器不会发生伪共享
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> counters[kCounterNum];
+    LatencyHistogram latency[kStageNum];
+  };
+
+  struct Gauge {
+    const char *name;
+    const char *help;
+    const char *type;
+    std::function<double()> getter;
+  };
+
+  // 返回当前线程的分片，线程第一次调用时分配，超过kMaxShards个线程时复用已有分片
+  Shard &LocalShard_();
+
+  static Counter StatusCounter_(int code);
+
+  // 合并所有分片上某个阶段的直方图，返回数值总和
+  uint64_t MergeLatency_(Stage stage, std::vector<uint64_t> &counts) const;
+
+  static const int kMaxShards = 64;
+
+  Shard shards_[kMaxShards];
+  std::atomic<int> shard_count_;
+
+  mutable std::mutex gauge_mtx_;
+  std::vector<Gauge> gauges_;
+  std::vector<std::function<void(std::string &)>> sections_;
+
+  std::vector<uint64_t> last_latency_[kStageNum];  // 上次输出日志摘要时的累计计数，用于求区间内的分位数
+};
+
+#endif //MODERNCPPWEBSERVER_METRICS_METRICS_H_
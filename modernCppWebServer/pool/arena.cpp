@@ -0,0 +1,89 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "arena.h"
+
+#include <cstdint>
+
+#include "../buffer/bufferpool.h"
+
+const size_t Arena::kBlockSize;
+
+Arena::~Arena() {
+  Release();
+}
+
+// 分配size字节，当前块剩余空间不够时换块
+void *Arena::Allocate(size_t size, size_t align) {
+  uintptr_t aligned = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+  if (ptr_ == nullptr || aligned + size > reinterpret_cast<uintptr_t>(end_)) {
+    NextBlock_(size, align);
+    aligned = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+  }
+  ptr_ = reinterpret_cast<char *>(aligned + size);
+  return reinterpret_cast<void *>(aligned);
+}
+
+ArenaString Arena::CopyString(const char *data, size_t len) {
+  return Concat(data, len, "", 0);
+}
+
+ArenaString Arena::Concat(const char *first, size_t first_len, const char *second, size_t second_len) {
+  char *dest = static_cast<char *>(Allocate(first_len + second_len + 1, 1));
+  memcpy(dest, first, first_len);
+  memcpy(dest + first_len, second, second_len);
+  dest[first_len + second_len] = '\0';
+  ArenaString str;
+  str.data = dest;
+  str.size = first_len + second_len;
+  return str;
+}
+
+// 指针回到第一个块的开头，之后的块在需要时按顺序复用
+void Arena::Reset() {
+  current_ = head_;
+  if (head_ != nullptr) {
+    ptr_ = head_->Data();
+    end_ = ptr_ + head_->capacity;
+  }
+}
+
+void Arena::Release() {
+  Block *block = head_;
+  while (block != nullptr) {
+    Block *next = block->next;
+    BufferPool::Instance()->Release(reinterpret_cast<char *>(block), block->capacity + sizeof(Block));
+    block = next;
+  }
+  head_ = nullptr;
+  current_ = nullptr;
+  ptr_ = nullptr;
+  end_ = nullptr;
+}
+
+// 依次尝试当前块之后已有的块，都放不下（或没有）时借一个新块，大的分配单独借一个足够大的块
+void Arena::NextBlock_(size_t size, size_t align) {
+  size_t need = size + align;
+  Block *next = current_ != nullptr ? current_->next : head_;
+  while (next != nullptr && next->capacity < need) {
+    next = next->next;
+  }
+  if (next == nullptr) {
+    size_t capacity = 0;
+    size_t want = need + sizeof(Block) > kBlockSize ? need + sizeof(Block) : kBlockSize;
+    char *memory = BufferPool::Instance()->Acquire(want, &capacity);
+    next = reinterpret_cast<Block *>(memory);
+    next->capacity = capacity - sizeof(Block);
+    if (current_ == nullptr) {
+      next->next = head_;
+      head_ = next;
+    } else {
+      next->next = current_->next;
+      current_->next = next;
+    }
+  }
+  current_ = next;
+  ptr_ = next->Data();
+  end_ = ptr_ + next->capacity;
+}
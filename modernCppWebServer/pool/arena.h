@@ -0,0 +1,85 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_ARENA_H_
+#define MODERNCPPWEBSERVER_POOL_ARENA_H_
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 竞技场中的字符串（或指向字符串常量），以'\0'结尾，有效期到所属竞技场Reset()为止
+struct ArenaString {
+  const char *data = "";
+  size_t size = 0;
+
+  const char *c_str() const {
+    return data;
+  }
+  bool empty() const {
+    return size == 0;
+  }
+  bool operator==(const char *str) const {
+    return strcmp(data, str) == 0;
+  }
+  bool operator!=(const char *str) const {
+    return !(*this == str);
+  }
+};
+
+// 按请求重置的线性分配器（bump allocator），由HttpConn持有，存放一次请求解析出的字符串、请求头和表单字段
+// 分配只移动指针，请求结束时Reset()把指针移回第一个块的开头，O(1)释放本次请求的全部内容，块留着给下一个请求用
+// 块从BufferPool借用，连接空闲时Release()归还，所以保持连接的请求不会调用malloc/free
+// 只能存放不需要析构的对象
+class Arena {
+ public:
+  static const size_t kBlockSize = 4096;
+
+  Arena() = default;
+  ~Arena();
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // 分配size字节，按align对齐
+  void *Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+  // 在竞技场中构造一个对象
+  template<typename T, typename... Args>
+  T *New(Args &&... args) {
+    static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+    return new(Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // 复制一段字符串，末尾补'\0'
+  ArenaString CopyString(const char *data, size_t len);
+  // 复制两段字符串的拼接，如路径加后缀
+  ArenaString Concat(const char *first, size_t first_len, const char *second, size_t second_len);
+
+  // 丢弃所有已分配的内容，保留已借的块
+  void Reset();
+  // 丢弃所有已分配的内容，并把块还给内存池
+  void Release();
+
+ private:
+  // 块头部，后面紧跟数据
+  struct Block {
+    Block *next;
+    size_t capacity;  // 数据部分的大小
+    char *Data() {
+      return reinterpret_cast<char *>(this + 1);
+    }
+  };
+
+  // 当前块放不下时，换到下一个足够大的块，没有则借一个新块接在当前块后面
+  void NextBlock_(size_t size, size_t align);
+
+  Block *head_ = nullptr;     // 第一个块
+  Block *current_ = nullptr;  // 正在分配的块
+  char *ptr_ = nullptr;       // 当前块中下一次分配的位置
+  char *end_ = nullptr;       // 当前块的末尾
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_ARENA_H_
@@ -0,0 +1,84 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "bloomfilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+const uint8_t CountingBloomFilter::kMaxCount;
+
+CountingBloomFilter::CountingBloomFilter() : size_(0), hash_count_(0) {
+}
+
+// 计数器个数 m = -n * ln(p) / (ln2)^2，哈希函数个数 k = m / n * ln2
+void CountingBloomFilter::Init(size_t expected, double false_positive_rate) {
+  expected = std::max<size_t>(expected, 1);
+  double ln2 = std::log(2.0);
+  double m = -static_cast<double>(expected) * std::log(false_positive_rate) / (ln2 * ln2);
+  size_ = std::max<size_t>(static_cast<size_t>(m), 64);
+  hash_count_ = std::min(16, std::max(1, static_cast<int>(std::round(m / expected * ln2))));
+  counters_.reset(new std::atomic<uint8_t>[size_]);
+  for (size_t i = 0; i < size_; ++i) {
+    counters_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+// 64位FNV-1a，再用splitmix64的混合步骤从中导出第二个哈希值
+void CountingBloomFilter::Hash_(const char *key, size_t len, uint64_t *h1, uint64_t *h2) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<unsigned char>(key[i]);
+    hash *= 1099511628211ULL;
+  }
+  uint64_t mix = hash + 0x9e3779b97f4a7c15ULL;
+  mix = (mix ^ (mix >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  mix = (mix ^ (mix >> 27)) * 0x94d049bb133111ebULL;
+  mix ^= mix >> 31;
+  *h1 = hash;
+  *h2 = mix | 1;  // 第二个哈希为奇数，各个位置不会全部重合
+}
+
+void CountingBloomFilter::Add(const char *key, size_t len) {
+  if (size_ == 0) {
+    return;
+  }
+  uint64_t h1, h2;
+  Hash_(key, len, &h1, &h2);
+  for (int i = 0; i < hash_count_; ++i) {
+    std::atomic<uint8_t> &counter = counters_[(h1 + i * h2) % size_];
+    uint8_t count = counter.load(std::memory_order_relaxed);
+    while (count < kMaxCount && !counter.compare_exchange_weak(count, count + 1, std::memory_order_relaxed)) {
+    }
+  }
+}
+
+void CountingBloomFilter::Remove(const char *key, size_t len) {
+  if (size_ == 0) {
+    return;
+  }
+  uint64_t h1, h2;
+  Hash_(key, len, &h1, &h2);
+  for (int i = 0; i < hash_count_; ++i) {
+    std::atomic<uint8_t> &counter = counters_[(h1 + i * h2) % size_];
+    uint8_t count = counter.load(std::memory_order_relaxed);
+    while (count > 0 && count < kMaxCount
+        && !counter.compare_exchange_weak(count, count - 1, std::memory_order_relaxed)) {
+    }
+  }
+}
+
+bool CountingBloomFilter::MayContain(const char *key, size_t len) const {
+  if (size_ == 0) {
+    return true;
+  }
+  uint64_t h1, h2;
+  Hash_(key, len, &h1, &h2);
+  for (int i = 0; i < hash_count_; ++i) {
+    if (counters_[(h1 + i * h2) % size_].load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,47 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_BLOOMFILTER_H_
+#define MODERNCPPWEBSERVER_POOL_BLOOMFILTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// 计数布隆过滤器，每个位置是一个8位计数器而不是一个比特，因此支持删除
+// 查询结果为不存在时一定不存在，为存在时有一定概率误判
+// 计数器用原子操作增减，可以在多个线程中同时插入、删除和查询，不需要加锁；
+// 计数器加到255后不再变化（也不再减少），避免溢出后被减成0造成漏判
+class CountingBloomFilter {
+ public:
+  CountingBloomFilter();
+
+  // 按预计元素个数和期望误判率确定计数器个数和哈希函数个数，需在使用前调用
+  void Init(size_t expected, double false_positive_rate);
+
+  void Add(const char *key, size_t len);
+  void Remove(const char *key, size_t len);
+  // 可能存在时返回true，一定不存在时返回false，未初始化时总是返回true
+  bool MayContain(const char *key, size_t len) const;
+
+  size_t CounterCount() const {
+    return size_;
+  }
+  int HashCount() const {
+    return hash_count_;
+  }
+
+ private:
+  // 对key求两个哈希值，第i个位置取 (h1 + i * h2) % size_（双重哈希）
+  static void Hash_(const char *key, size_t len, uint64_t *h1, uint64_t *h2);
+
+  static const uint8_t kMaxCount = 255;
+
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  size_t size_;
+  int hash_count_;
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_BLOOMFILTER_H_
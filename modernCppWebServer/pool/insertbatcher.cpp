@@ -0,0 +1,155 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "insertbatcher.h"
+#include "mysqluserstore.h"
+
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <unordered_set>
+
+InsertBatcher::InsertBatcher()
+    : max_rows_(1), max_delay_(0), is_open_(false), is_stop_(false), batches_(0), rows_(0), fallbacks_(0) {
+}
+
+InsertBatcher::~InsertBatcher() {
+  Close();
+}
+
+// 创建静态对象，单例模式获取对象的方法
+InsertBatcher *InsertBatcher::Instance() {
+  static InsertBatcher insert_batcher;
+  return &insert_batcher;
+}
+
+void InsertBatcher::Init(int max_rows, int max_delay_ms) {
+  assert(max_rows > 0);
+  max_rows_ = max_rows;
+  max_delay_ = std::chrono::milliseconds(max_delay_ms);
+  is_stop_ = false;
+  is_open_ = true;
+  flusher_ = std::thread(&InsertBatcher::Run_, this);
+}
+
+void InsertBatcher::Close() {
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    is_stop_ = true;
+  }
+  cond_.notify_all();
+  if (flusher_.joinable()) {
+    flusher_.join();
+  }
+  is_open_ = false;
+}
+
+void InsertBatcher::Submit(const std::string &name, const std::string &pwd, Callback callback) {
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    queue_.push_back(Row{name, pwd, std::move(callback), Clock::now()});
+  }
+  cond_.notify_one();
+}
+
+InsertBatcher::Result InsertBatcher::Insert(const std::string &name, const std::string &pwd) {
+  std::shared_ptr<std::promise<Result>> result = std::make_shared<std::promise<Result>>();
+  std::future<Result> future = result->get_future();
+  Submit(name, pwd, [result](Result res) { result->set_value(res); });
+  return future.get();
+}
+
+// 刷写线程：等到队列中有max_rows行或最早的一行等待了max_delay，取出一批写入
+void InsertBatcher::Run_() {
+  std::vector<Row> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> locker(mtx_);
+      cond_.wait(locker, [this] { return is_stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      Clock::time_point deadline = queue_.front().submitted_at + max_delay_;
+      cond_.wait_until(locker, deadline, [this] {
+        return is_stop_ || static_cast<int>(queue_.size()) >= max_rows_;
+      });
+      size_t count = std::min(queue_.size(), static_cast<size_t>(max_rows_));
+      batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + count));
+      queue_.erase(queue_.begin(), queue_.begin() + count);
+    }
+    Flush_(batch);
+    batch.clear();
+  }
+}
+
+// 写入一批：重复的用户名只保留第一行，先整批插入，失败时逐行插入，最后逐个调用回调
+void InsertBatcher::Flush_(std::vector<Row> &batch) {
+  std::vector<Result> results(batch.size(), kFailed);
+  std::vector<const Row *> rows;
+  std::vector<size_t> indexes;
+  std::unordered_set<std::string> names;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (names.insert(batch[i].name).second) {
+      rows.push_back(&batch[i]);
+      indexes.push_back(i);
+    }
+  }
+  {
+    MYSQL *sql;
+    SqlConnRAII tmp(&sql, SqlConnPool::Instance());
+    if (sql == nullptr) {
+      results.assign(batch.size(), kUnavailable);
+    } else if (rows.size() > 1 && InsertBatch_(sql, rows)) {
+      for (size_t i : indexes) {
+        results[i] = kInserted;
+      }
+    } else {
+      if (rows.size() > 1) {
+        fallbacks_.fetch_add(1, std::memory_order_relaxed);
+      }
+      for (size_t j = 0; j < rows.size(); ++j) {
+        // 单行（包括只有一行的批）走连接上缓存的预处理语句
+        results[indexes[j]] = MySqlUserStore::InsertUser(sql, rows[j]->name.c_str(), rows[j]->pwd.c_str())
+            ? kInserted : kFailed;
+      }
+    }
+  }
+  batches_.fetch_add(1, std::memory_order_relaxed);
+  rows_.fetch_add(batch.size(), std::memory_order_relaxed);
+  LOG_DEBUG("InsertBatcher: flushed %d rows, %d duplicated",
+            static_cast<int>(batch.size()), static_cast<int>(batch.size() - rows.size()));
+  for (size_t i = 0; i < batch.size(); ++i) {
+    batch[i].callback(results[i]);
+  }
+}
+
+// 关闭自动提交，执行一条多行INSERT后提交，失败时回滚，最后恢复自动提交
+bool InsertBatcher::InsertBatch_(MYSQL *sql, const std::vector<const Row *> &rows) {
+  std::string query = "INSERT INTO user(username, passwd) VALUES";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    query += i == 0 ? "('" : ", ('";
+    AppendEscaped_(sql, query, rows[i]->name);
+    query += "', '";
+    AppendEscaped_(sql, query, rows[i]->pwd);
+    query += "')";
+  }
+  mysql_autocommit(sql, false);
+  bool ok = mysql_real_query(sql, query.data(), query.size()) == 0;
+  if (ok) {
+    ok = !mysql_commit(sql);
+  }
+  if (!ok) {
+    LOG_DEBUG("InsertBatcher: batch insert error: %s", mysql_error(sql));
+    mysql_rollback(sql);
+  }
+  mysql_autocommit(sql, true);
+  return ok;
+}
+
+void InsertBatcher::AppendEscaped_(MYSQL *sql, std::string &query, const std::string &str) {
+  size_t pos = query.size();
+  query.resize(pos + str.size() * 2 + 1);
+  query.resize(pos + mysql_real_escape_string(sql, &query[pos], str.data(), str.size()));
+}
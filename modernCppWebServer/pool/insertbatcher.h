@@ -0,0 +1,106 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_INSERTBATCHER_H_
+#define MODERNCPPWEBSERVER_POOL_INSERTBATCHER_H_
+
+#include <mysql/mysql.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../log/log.h"
+#include "sqlconnpool.h"
+#include "sqlconnRAII.h"
+
+// 注册插入的组提交（group commit）：各线程提交的插入进入同一个队列，
+// 由一个刷写线程每攒够max_rows行或最早的一行等待了max_delay_ms毫秒时，
+// 在一个事务中用一条多行INSERT写入，再逐个通知提交者各自的结果
+// 同一批中重复的用户名只插入第一行，后面的行直接失败，不让一个重复的用户名拖累整批
+// 多行INSERT中只要有一行失败（如用户名已存在，或只有大小写不同而排序规则不区分大小写）整条语句都会失败，
+// 此时回滚，退化为逐行插入得到每一行的结果
+// 取不到数据库连接（连接池等待超时）时整批返回kUnavailable，调用者应返回503而不是注册失败
+// 刷写线程上一批还没写完时新的插入继续排队，数据库越忙每批越大
+class InsertBatcher {
+ public:
+  // 一行插入的结果
+  enum Result {
+    kFailed,       // 插入失败，多半是用户名已存在
+    kInserted,     // 插入成功
+    kUnavailable,  // 取不到数据库连接，没有执行
+  };
+  // 插入完成的回调，参数为这一行的结果，在刷写线程中调用
+  typedef std::function<void(Result)> Callback;
+
+  // 创建静态对象，单例模式获取对象的方法
+  static InsertBatcher *Instance();
+
+  // 启动刷写线程，需在数据库连接池初始化之后调用
+  void Init(int max_rows, int max_delay_ms);
+  bool IsOpen() const {
+    return is_open_;
+  }
+  // 停止刷写线程，队列中剩余的插入写完后返回，需在关闭数据库连接池之前调用
+  void Close();
+
+  // 提交一行插入，完成后在刷写线程中调用callback
+  void Submit(const std::string &name, const std::string &pwd, Callback callback);
+  // 提交一行插入并等待结果，调用者不能持有数据库连接，否则连接池只有一个连接时会死锁
+  Result Insert(const std::string &name, const std::string &pwd);
+
+  uint64_t Batches() const {
+    return batches_.load(std::memory_order_relaxed);
+  }
+  uint64_t Rows() const {
+    return rows_.load(std::memory_order_relaxed);
+  }
+  uint64_t Fallbacks() const {
+    return fallbacks_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  InsertBatcher();
+  ~InsertBatcher();
+
+  struct Row {
+    std::string name;
+    std::string pwd;
+    Callback callback;
+    Clock::time_point submitted_at;
+  };
+
+  // 刷写线程
+  void Run_();
+  // 写入一批，逐个调用回调
+  void Flush_(std::vector<Row> &batch);
+  // 在一个事务中用一条多行INSERT写入rows中的行，成功返回true
+  // 每批的行数不同，每种行数都要单独预处理，所以用转义后的文本语句
+  bool InsertBatch_(MYSQL *sql, const std::vector<const Row *> &rows);
+  // 把转义后的字符串追加到query中
+  static void AppendEscaped_(MYSQL *sql, std::string &query, const std::string &str);
+
+  int max_rows_;
+  Clock::duration max_delay_;
+  bool is_open_;
+  bool is_stop_;
+
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  std::vector<Row> queue_;
+  std::thread flusher_;
+
+  std::atomic<uint64_t> batches_;
+  std::atomic<uint64_t> rows_;
+  std::atomic<uint64_t> fallbacks_;
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_INSERTBATCHER_H_
@@ -0,0 +1,174 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "localuserstore.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+
+const size_t LocalUserStore::kHeaderLen;
+const uint32_t LocalUserStore::kMaxFieldLen;
+
+LocalUserStore::LocalUserStore() : fd_(-1), end_(0) {
+}
+
+LocalUserStore::~LocalUserStore() {
+  Close();
+}
+
+// 创建静态对象，单例模式获取对象的方法
+LocalUserStore *LocalUserStore::Instance() {
+  static LocalUserStore store;
+  return &store;
+}
+
+// 读入整个文件回放，截掉末尾不完整的记录
+bool LocalUserStore::Open(const char *path) {
+  std::lock_guard<std::mutex> locker(mtx_);
+  index_.clear();
+  fd_ = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd_ < 0) {
+    LOG_ERROR("LocalUserStore: open %s error: %s", path, strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) < 0) {
+    LOG_ERROR("LocalUserStore: stat %s error: %s", path, strerror(errno));
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  std::string data(st.st_size, '\0');
+  off_t done = 0;
+  while (done < st.st_size) {
+    ssize_t len = pread(fd_, &data[done], st.st_size - done, done);
+    if (len <= 0) {
+      break;
+    }
+    done += len;
+  }
+  data.resize(done);
+  end_ = Replay_(data);
+  if (end_ < st.st_size) {
+    LOG_WARN("LocalUserStore: truncate %s from %lld to %lld bytes",
+             path, static_cast<long long>(st.st_size), static_cast<long long>(end_));
+    if (ftruncate(fd_, end_) < 0) {
+      LOG_ERROR("LocalUserStore: truncate error: %s", strerror(errno));
+    }
+  }
+  LOG_INFO("LocalUserStore: %s, %d users", path, static_cast<int>(index_.size()));
+  return true;
+}
+
+// 逐条校验记录，同一用户名只会出现一次（插入前检查过），遇到第一条不完整或校验失败的记录就停止
+off_t LocalUserStore::Replay_(const std::string &data) {
+  size_t pos = 0;
+  while (data.size() - pos >= kHeaderLen) {
+    uint32_t header[3];
+    memcpy(header, data.data() + pos, kHeaderLen);
+    uint32_t name_len = header[0];
+    uint32_t pwd_len = header[1];
+    if (name_len == 0 || name_len > kMaxFieldLen || pwd_len > kMaxFieldLen
+        || data.size() - pos - kHeaderLen < name_len + pwd_len) {
+      break;
+    }
+    const char *name = data.data() + pos + kHeaderLen;
+    if (Checksum_(name, name_len, name + name_len, pwd_len) != header[2]) {
+      break;
+    }
+    index_[std::string(name, name_len)] = Location{static_cast<off_t>(pos + kHeaderLen + name_len), pwd_len};
+    pos += kHeaderLen + name_len + pwd_len;
+  }
+  return pos;
+}
+
+// FNV-1a，覆盖两个长度和全部内容
+uint32_t LocalUserStore::Checksum_(const char *name, uint32_t name_len, const char *pwd, uint32_t pwd_len) {
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](const char *data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 16777619u;
+    }
+  };
+  mix(reinterpret_cast<const char *>(&name_len), sizeof(name_len));
+  mix(reinterpret_cast<const char *>(&pwd_len), sizeof(pwd_len));
+  mix(name, name_len);
+  mix(pwd, pwd_len);
+  return hash;
+}
+
+// 在索引中找到密码的位置，到文件中读出
+UserStore::Status LocalUserStore::Query(const char *name, std::string *passwd) {
+  Location location;
+  int fd;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = index_.find(name);
+    if (it == index_.end()) {
+      return kNotFound;
+    }
+    location = it->second;
+    fd = fd_;
+  }
+  if (fd < 0) {
+    return kUnavailable;
+  }
+  passwd->resize(location.len);
+  if (location.len > 0 && pread(fd, &(*passwd)[0], location.len, location.offset)
+      != static_cast<ssize_t>(location.len)) {
+    LOG_ERROR("LocalUserStore: read error: %s", strerror(errno));
+    return kError;
+  }
+  return kOk;
+}
+
+// 检查用户名不存在后把记录追加到文件末尾，写入成功才加入索引；写了一部分时截掉，不留下损坏的记录
+UserStore::Status LocalUserStore::Insert(const char *name, const char *pwd) {
+  uint32_t name_len = strlen(name);
+  uint32_t pwd_len = strlen(pwd);
+  if (name_len > kMaxFieldLen || pwd_len > kMaxFieldLen) {
+    return kError;
+  }
+  std::string record(kHeaderLen + name_len + pwd_len, '\0');
+  uint32_t header[3] = {name_len, pwd_len, Checksum_(name, name_len, pwd, pwd_len)};
+  memcpy(&record[0], header, kHeaderLen);
+  memcpy(&record[kHeaderLen], name, name_len);
+  memcpy(&record[kHeaderLen + name_len], pwd, pwd_len);
+
+  std::lock_guard<std::mutex> locker(mtx_);
+  if (fd_ < 0) {
+    return kUnavailable;
+  }
+  if (index_.count(name) > 0) {
+    return kError;
+  }
+  if (pwrite(fd_, record.data(), record.size(), end_) != static_cast<ssize_t>(record.size())) {
+    LOG_ERROR("LocalUserStore: write error: %s", strerror(errno));
+    if (ftruncate(fd_, end_) < 0) {
+      LOG_ERROR("LocalUserStore: truncate error: %s", strerror(errno));
+    }
+    return kError;
+  }
+  index_[name] = Location{static_cast<off_t>(end_ + kHeaderLen + name_len), pwd_len};
+  end_ += record.size();
+  return kOk;
+}
+
+size_t LocalUserStore::Size() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  return index_.size();
+}
+
+// 刷盘并关闭文件，之后的插入返回kUnavailable
+void LocalUserStore::Close() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  if (fd_ >= 0) {
+    fdatasync(fd_);
+    close(fd_);
+    fd_ = -1;
+  }
+}
@@ -0,0 +1,62 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_LOCALUSERSTORE_H_
+#define MODERNCPPWEBSERVER_POOL_LOCALUSERSTORE_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../log/log.h"
+#include "userstore.h"
+
+// 本地用户存储，不依赖外部数据库，用于压测登录/注册路径、没有MySQL的小节点，以及把服务器本身的开销和数据库开销分开分析
+// 用户记录只追加写入一个日志文件，内存中的哈希表记录每个用户名对应的密码在文件中的位置，查询时pread读出
+// 记录格式：[用户名长度 4字节][密码长度 4字节][校验和 4字节][用户名][密码]，整数为本机字节序
+// 启动时从头回放整个文件重建索引，末尾写了一半的记录（校验失败）被截掉
+// 每次插入只write到页缓存，不fsync：进程崩溃不丢数据，机器掉电可能丢失最近的注册，关闭时fdatasync
+class LocalUserStore : public UserStore {
+ public:
+  // 创建静态对象，单例模式获取对象的方法
+  static LocalUserStore *Instance();
+
+  // 打开（不存在时创建）日志文件并建立索引，失败返回false
+  bool Open(const char *path);
+  // 刷盘并关闭文件
+  void Close();
+
+  Status Query(const char *name, std::string *passwd) override;
+  Status Insert(const char *name, const char *pwd) override;
+
+  // 已保存的用户数
+  size_t Size();
+
+ private:
+  LocalUserStore();
+  ~LocalUserStore();
+
+  // 密码在文件中的位置
+  struct Location {
+    off_t offset;
+    uint32_t len;
+  };
+
+  // 回放[0, size)中的记录建立索引，返回最后一条完整记录的结尾
+  off_t Replay_(const std::string &data);
+  static uint32_t Checksum_(const char *name, uint32_t name_len, const char *pwd, uint32_t pwd_len);
+
+  static const size_t kHeaderLen = 12;
+  static const uint32_t kMaxFieldLen = 4096;  // 用户名和密码的最大长度，超过的记录视为损坏
+
+  int fd_;
+  off_t end_;  // 文件中最后一条完整记录的结尾，下一条记录写在这里
+  // 用户名 -> 密码位置，插入时加锁；记录写入后不再修改，查到位置后在锁外pread
+  std::unordered_map<std::string, Location> index_;
+  std::mutex mtx_;
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_LOCALUSERSTORE_H_
@@ -0,0 +1,186 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "mysqluserstore.h"
+
+// 创建静态对象，单例模式获取对象的方法
+MySqlUserStore *MySqlUserStore::Instance() {
+  static MySqlUserStore store;
+  return &store;
+}
+
+// 从连接池取一个连接查询，查询结束即归还
+UserStore::Status MySqlUserStore::Query(const char *name, std::string *passwd) {
+  // 从数据库连接池中取出一个连接，连接池初始化时已经指定了数据库名
+  MYSQL *sql;
+  // 使用RAII机制, 这里原作者没用临时变量，构造后立马就析构了，这样连接池内存在和当前重复的连接
+  // SqlConnRAII (&sql, SqlConnPool::Instance());
+  // 我加了个tmp临时变量，令其在作用域结束，也就是查询结束时再析构
+  SqlConnRAII tmp(&sql, SqlConnPool::Instance());
+  if (sql == nullptr) {
+    // 连接池等待超时或数据库不可用
+    return kUnavailable;
+  }
+  /* 原作者注释， 查询用户及密码 */
+  char buff[kMaxPasswdLen + 1];
+  int found = QueryPasswd_(sql, name, buff, sizeof(buff));
+  if (found < 0) {
+    return kError;
+  }
+  if (found == 0) {
+    return kNotFound;
+  }
+  passwd->assign(buff);
+  return kOk;
+}
+
+// 插入新用户，组提交开启时和其他线程的注册合并成一条多行INSERT
+// 插入失败多半是用户名已存在，两种情况都把用户名加入布隆过滤器
+UserStore::Status MySqlUserStore::Insert(const char *name, const char *pwd) {
+  UserFilter::Instance()->Add(name, strlen(name));
+  if (InsertBatcher::Instance()->IsOpen()) {
+    switch (InsertBatcher::Instance()->Insert(name, pwd)) {
+      case InsertBatcher::kInserted:
+        return kOk;
+      case InsertBatcher::kUnavailable:
+        return kUnavailable;
+      default:
+        return kError;
+    }
+  }
+  MYSQL *sql;
+  SqlConnRAII tmp(&sql, SqlConnPool::Instance());
+  if (sql == nullptr) {
+    return kUnavailable;
+  }
+  return InsertUser(sql, name, pwd) ? kOk : kError;
+}
+
+// 注册时布隆过滤器确定不存在的用户名跳过查询
+bool MySqlUserStore::MayExist(const char *name, size_t len) {
+  return UserFilter::Instance()->MayExist(name, len);
+}
+
+// 用连接上缓存的预处理语句查询用户的密码
+// 参数和结果都以二进制协议传输，服务器不需要每次解析语句，也不需要拼接和转义用户名
+int MySqlUserStore::QueryPasswd_(MYSQL *sql, const char *name, char *passwd, size_t size) {
+  MYSQL_STMT *stmt = SqlConnPool::Instance()->GetStmt(sql, SqlConnPool::kStmtSelectUser);
+  if (stmt == nullptr) {
+    return QueryPasswdText_(sql, name, passwd, size);
+  }
+  unsigned long name_len = strlen(name);
+  MYSQL_BIND param;
+  memset(&param, 0, sizeof(param));
+  param.buffer_type = MYSQL_TYPE_STRING;
+  param.buffer = const_cast<char *>(name);
+  param.buffer_length = name_len;
+  param.length = &name_len;
+
+  unsigned long passwd_len = 0;
+  bool is_null = false;
+  MYSQL_BIND result;
+  memset(&result, 0, sizeof(result));
+  result.buffer_type = MYSQL_TYPE_STRING;
+  result.buffer = passwd;
+  result.buffer_length = size - 1;
+  result.length = &passwd_len;
+  result.is_null = &is_null;
+
+  if (mysql_stmt_bind_param(stmt, &param) || mysql_stmt_bind_result(stmt, &result)
+      || mysql_stmt_execute(stmt) != 0) {
+    // 执行出错时语句可能已随连接失效，丢弃后下次重新预处理
+    LOG_ERROR("MySql stmt execute error: %s", mysql_stmt_error(stmt));
+    SqlConnPool::Instance()->DropStmt(sql, SqlConnPool::kStmtSelectUser);
+    return -1;
+  }
+  int ret = mysql_stmt_fetch(stmt);
+  mysql_stmt_free_result(stmt);
+  if (ret == MYSQL_NO_DATA) {
+    return 0;
+  }
+  if (ret != 0 || is_null) {
+    // 密码超过缓冲区长度（MYSQL_DATA_TRUNCATED）时按出错处理，不能用截断后的密码比较
+    LOG_WARN("MySql stmt fetch error: %d", ret);
+    return -1;
+  }
+  passwd[passwd_len] = '\0';
+  LOG_DEBUG("MYSQL ROW: %s %s", name, passwd);
+  return 1;
+}
+
+// 用预处理语句插入新用户
+bool MySqlUserStore::InsertUser(MYSQL *sql, const char *name, const char *pwd) {
+  MYSQL_STMT *stmt = SqlConnPool::Instance()->GetStmt(sql, SqlConnPool::kStmtInsertUser);
+  if (stmt == nullptr) {
+    return InsertUserText_(sql, name, pwd);
+  }
+  unsigned long lens[2] = {strlen(name), strlen(pwd)};
+  const char *values[2] = {name, pwd};
+  MYSQL_BIND params[2];
+  memset(params, 0, sizeof(params));
+  for (int i = 0; i < 2; ++i) {
+    params[i].buffer_type = MYSQL_TYPE_STRING;
+    params[i].buffer = const_cast<char *>(values[i]);
+    params[i].buffer_length = lens[i];
+    params[i].length = &lens[i];
+  }
+  if (mysql_stmt_bind_param(stmt, params) || mysql_stmt_execute(stmt) != 0) {
+    LOG_DEBUG("Insert error: %s", mysql_stmt_error(stmt));
+    // 用户名重复是正常的失败，语句仍然有效，其他错误时丢弃语句
+    if (mysql_stmt_errno(stmt) != ER_DUP_ENTRY) {
+      SqlConnPool::Instance()->DropStmt(sql, SqlConnPool::kStmtInsertUser);
+    }
+    return false;
+  }
+  return true;
+}
+
+// 以文本协议查询用户的密码
+int MySqlUserStore::QueryPasswdText_(MYSQL *sql, const char *name, char *passwd, size_t size) {
+  size_t name_len = strlen(name);
+  std::string order = "SELECT passwd FROM user WHERE username='";
+  size_t prefix_len = order.size();
+  order.resize(prefix_len + name_len * 2 + 1);
+  order.resize(prefix_len + mysql_real_escape_string(sql, &order[prefix_len], name, name_len));
+  order += "' LIMIT 1";
+  LOG_DEBUG("%s", order.c_str());
+
+  // 执行查询
+  if (mysql_real_query(sql, order.data(), order.size()) != 0) {
+    return -1;
+  }
+  MYSQL_RES *res = mysql_store_result(sql);
+  if (res == nullptr) {
+    return -1;
+  }
+  int found = 0;
+  if (MYSQL_ROW row = mysql_fetch_row(res)) {
+    if (row[0] != nullptr && strlen(row[0]) < size) {
+      strcpy(passwd, row[0]);
+      found = 1;
+    } else {
+      found = -1;
+    }
+  }
+  // 释放结果集，防止内存泄漏
+  mysql_free_result(res);
+  return found;
+}
+
+// 以文本协议插入新用户
+bool MySqlUserStore::InsertUserText_(MYSQL *sql, const char *name, const char *pwd) {
+  size_t name_len = strlen(name);
+  size_t pwd_len = strlen(pwd);
+  std::string escaped_name(name_len * 2 + 1, '\0');
+  escaped_name.resize(mysql_real_escape_string(sql, &escaped_name[0], name, name_len));
+  std::string escaped_pwd(pwd_len * 2 + 1, '\0');
+  escaped_pwd.resize(mysql_real_escape_string(sql, &escaped_pwd[0], pwd, pwd_len));
+  std::string order = "INSERT INTO user(username, passwd) VALUES('" + escaped_name + "', '" + escaped_pwd + "')";
+  LOG_DEBUG("%s", order.c_str());
+  if (mysql_real_query(sql, order.data(), order.size()) != 0) {
+    LOG_DEBUG("Insert error!");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,48 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_MYSQLUSERSTORE_H_
+#define MODERNCPPWEBSERVER_POOL_MYSQLUSERSTORE_H_
+
+#include <mysql/mysql.h>
+#include <mysql/mysqld_error.h>
+#include <cstring>
+#include <string>
+
+#include "../log/log.h"
+#include "userstore.h"
+#include "sqlconnpool.h"
+#include "sqlconnRAII.h"
+#include "userfilter.h"
+#include "insertbatcher.h"
+
+// MySQL用户存储，user表的查询和插入，原来直接写在HttpRequest::UserVerify中
+// 查询用连接池中连接上缓存的预处理语句，插入走组提交（InsertBatcher），注册前先查布隆过滤器（UserFilter）
+class MySqlUserStore : public UserStore {
+ public:
+  // 创建静态对象，单例模式获取对象的方法
+  static MySqlUserStore *Instance();
+
+  Status Query(const char *name, std::string *passwd) override;
+  Status Insert(const char *name, const char *pwd) override;
+  bool MayExist(const char *name, size_t len) override;
+
+  // 用连接上缓存的预处理语句插入新用户，服务器不支持时退回文本协议，成功返回true
+  // 调用者必须持有这个连接，InsertBatcher的单行插入也用它
+  static bool InsertUser(MYSQL *sql, const char *name, const char *pwd);
+
+ private:
+  MySqlUserStore() = default;
+  ~MySqlUserStore() = default;
+
+  // 用连接上缓存的预处理语句查询用户的密码，存在返回1，不存在返回0，出错返回-1
+  static int QueryPasswd_(MYSQL *sql, const char *name, char *passwd, size_t size);
+  // 服务器不支持预处理语句时退回文本协议查询，用户名经过转义
+  static int QueryPasswdText_(MYSQL *sql, const char *name, char *passwd, size_t size);
+  static bool InsertUserText_(MYSQL *sql, const char *name, const char *pwd);
+
+  static const size_t kMaxPasswdLen = 255;  // 数据库中密码的最大长度
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_MYSQLUSERSTORE_H_
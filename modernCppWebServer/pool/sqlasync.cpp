@@ -0,0 +1,395 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "sqlasync.h"
+
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+SqlAsync::SqlAsync()
+    : epoller_(nullptr), event_fd_(-1), timer_fd_(-1), wait_timeout_(0), query_timeout_(0), is_waiting_conn_(false) {
+}
+
+SqlAsync::~SqlAsync() {
+  Close();
+}
+
+// 创建静态对象，单例模式获取对象的方法
+SqlAsync *SqlAsync::Instance() {
+  static SqlAsync sql_async;
+  return &sql_async;
+}
+
+// 创建eventfd和timerfd并注册到主线程的epoller中
+bool SqlAsync::Init(Epoller *epoller, int wait_timeout_ms, int query_timeout_ms) {
+  assert(epoller);
+  epoller_ = epoller;
+  wait_timeout_ = std::chrono::milliseconds(wait_timeout_ms);
+  query_timeout_ = std::chrono::milliseconds(query_timeout_ms);
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  // steady_clock在Linux上就是CLOCK_MONOTONIC，截止时间可以直接换算成timerfd的绝对时间
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (event_fd_ < 0 || timer_fd_ < 0) {
+    LOG_ERROR("SqlAsync eventfd/timerfd error!");
+    Close();
+    return false;
+  }
+  if (!epoller_->AddFd(event_fd_, EPOLLIN) || !epoller_->AddFd(timer_fd_, EPOLLIN)) {
+    LOG_ERROR("SqlAsync add eventfd/timerfd error!");
+    Close();
+    return false;
+  }
+  return true;
+}
+
+// 提交一次验证，放入队列后通过eventfd唤醒主线程
+void SqlAsync::SubmitVerify(const std::string &name, const std::string &pwd, bool is_login, Callback callback) {
+  Job *job = new Job;
+  job->name = name;
+  job->pwd = pwd;
+  job->is_login = is_login;
+  job->callback = std::move(callback);
+  job->submitted_at = std::chrono::steady_clock::now();
+  job->deadline = job->submitted_at + wait_timeout_;
+  job->sql = nullptr;
+  job->step = kSelect;
+  job->is_registered = false;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    submitted_.push_back(job);
+  }
+  uint64_t one = 1;
+  if (write(event_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    LOG_ERROR("SqlAsync notify error!");
+  }
+}
+
+// 处理epoller中的一个事件
+bool SqlAsync::HandleEvent(int fd, uint32_t events) {
+  if (event_fd_ < 0) {
+    return false;
+  }
+  if (fd == event_fd_) {
+    uint64_t count = 0;
+    if (read(event_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      LOG_ERROR("SqlAsync eventfd read error!");
+    }
+    std::deque<std::pair<Job *, InsertBatcher::Result>> inserted;
+    {
+      std::lock_guard<std::mutex> locker(mtx_);
+      pending_.insert(pending_.end(), submitted_.begin(), submitted_.end());
+      submitted_.clear();
+      inserted.swap(inserted_);
+    }
+    // 组提交完成的注册，结果写入用户缓存后完成任务
+    for (auto &item : inserted) {
+      if (item.second == InsertBatcher::kInserted) {
+        UserCache::Instance()->Put(item.first->name, item.first->pwd);
+        Complete_(item.first, kVerified);
+      } else {
+        UserCache::Instance()->Erase(item.first->name);
+        Complete_(item.first, item.second == InsertBatcher::kUnavailable ? kUnavailable : kFailed);
+      }
+    }
+    StartJobs_();
+    return true;
+  }
+  if (fd == timer_fd_) {
+    uint64_t count = 0;
+    if (read(timer_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      LOG_ERROR("SqlAsync timerfd read error!");
+    }
+    // 先把这期间归还的连接分给等待的任务，剩下仍然取不到连接且已超时的才失败，再处理执行超时的任务
+    // timerfd已经触发过，不论截止时间是否变化都要重新设置
+    armed_deadline_ = std::chrono::steady_clock::time_point();
+    StartJobs_();
+    ExpireJobs_();
+    ArmTimer_();
+    return true;
+  }
+  auto it = running_.find(fd);
+  if (it == running_.end()) {
+    return false;
+  }
+  Job *job = it->second;
+  if (events & (EPOLLHUP | EPOLLERR)) {
+    // 连接断开，mysql的接口会返回错误，仍交给状态机处理
+    LOG_WARN("SqlAsync connection[%d] hang up", fd);
+  }
+  Step_(job);
+  return true;
+}
+
+// 为等待中的任务分配空闲连接并开始执行
+void SqlAsync::StartJobs_() {
+  while (!pending_.empty()) {
+    Job *job = pending_.front();
+    // 注册时布隆过滤器确定不存在的用户名跳过查询，直接插入（用户缓存已在提交前查过）
+    bool is_absent = !job->is_login && !UserFilter::Instance()->MayExist(job->name.data(), job->name.size());
+    if (is_absent && InsertBatcher::Instance()->IsOpen()) {
+      // 交给组提交，不需要占用连接
+      pending_.pop_front();
+      SubmitInsert_(job);
+      continue;
+    }
+    MYSQL *sql = SqlConnPool::Instance()->TryGetConn();
+    if (sql == nullptr) {
+      if (!is_waiting_conn_) {
+        // 让连接池在归还连接时写eventfd，设置之后再试一次，不会错过设置之前刚归还的连接
+        SqlConnPool::Instance()->SetNotifyFd(event_fd_);
+        is_waiting_conn_ = true;
+        continue;
+      }
+      // 没有空闲连接，等连接池归还连接或任务超时
+      ArmTimer_();
+      return;
+    }
+    pending_.pop_front();
+    job->sql = sql;
+    job->deadline = std::chrono::steady_clock::now() + query_timeout_;
+    job->step = is_absent ? kInsert : kSelect;
+    MakeQuery_(job, is_absent);
+    running_[sql->net.fd] = job;
+    Step_(job);
+  }
+  ArmTimer_();
+}
+
+// 等待连接的任务表头的截止时间最早，超时的从表头依次取出；执行中的任务不多，逐个检查
+void SqlAsync::ExpireJobs_() {
+  auto now = std::chrono::steady_clock::now();
+  while (!pending_.empty() && pending_.front()->deadline <= now) {
+    Job *job = pending_.front();
+    pending_.pop_front();
+    Metrics::Instance()->Add(Metrics::kSqlPoolTimeouts);
+    LOG_WARN("SqlAsync: no sql connection within %dms", static_cast<int>(wait_timeout_.count()));
+    Complete_(job, kUnavailable);
+  }
+  std::vector<Job *> expired;
+  for (auto &item : running_) {
+    if (item.second->deadline <= now) {
+      expired.push_back(item.second);
+    }
+  }
+  for (Job *job : expired) {
+    LOG_WARN("SqlAsync: query on connection[%d] not done within %dms", job->sql->net.fd,
+             static_cast<int>(query_timeout_.count()));
+    // 连接上的查询还没有完成，不能再给别的任务用，关闭后由连接池补充
+    int fd = job->sql->net.fd;
+    if (job->is_registered) {
+      epoller_->DelFd(fd);
+      job->is_registered = false;
+    }
+    running_.erase(fd);
+    SqlConnPool::Instance()->DiscardConn(job->sql);
+    job->sql = nullptr;
+    if (job->step == kInsert) {
+      // 插入可能已经执行，结果不确定，删除缓存，下次重新查询
+      UserCache::Instance()->Erase(job->name);
+    }
+    Complete_(job, kUnavailable);
+  }
+}
+
+// 截止时间没有变化时不重新设置，每个任务完成时都会调用到这里
+void SqlAsync::ArmTimer_() {
+  std::chrono::steady_clock::time_point deadline;
+  if (pending_.empty()) {
+    if (is_waiting_conn_) {
+      SqlConnPool::Instance()->SetNotifyFd(-1);
+      is_waiting_conn_ = false;
+    }
+  } else {
+    deadline = pending_.front()->deadline;
+  }
+  for (auto &item : running_) {
+    if (deadline == std::chrono::steady_clock::time_point() || item.second->deadline < deadline) {
+      deadline = item.second->deadline;
+    }
+  }
+  if (deadline == armed_deadline_) {
+    return;
+  }
+  armed_deadline_ = deadline;
+  // it_value全为0时停止计时
+  struct itimerspec spec = {};
+  if (deadline != std::chrono::steady_clock::time_point()) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    spec.it_value.tv_sec = ns / 1000000000;
+    spec.it_value.tv_nsec = ns % 1000000000;
+  }
+  timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+// 把注册的插入交给组提交，刷写线程完成后通过eventfd把结果交回主线程
+void SqlAsync::SubmitInsert_(Job *job) {
+  UserFilter::Instance()->Add(job->name.data(), job->name.size());
+  InsertBatcher::Instance()->Submit(job->name, job->pwd, [this, job](InsertBatcher::Result result) {
+    {
+      std::lock_guard<std::mutex> locker(mtx_);
+      inserted_.push_back(std::make_pair(job, result));
+    }
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      LOG_ERROR("SqlAsync notify error!");
+    }
+  });
+}
+
+// 推进任务的状态机
+// 非阻塞接口返回NET_ASYNC_NOT_READY时表示需要等待套接字，此时注册可读事件后返回
+void SqlAsync::Step_(Job *job) {
+  while (true) {
+    switch (job->step) {
+      case kSelect:
+      case kInsert: {
+        net_async_status status = mysql_real_query_nonblocking(job->sql, job->query.data(), job->query.size());
+        if (status == NET_ASYNC_NOT_READY) {
+          Wait_(job);
+          return;
+        }
+        if (job->step == kInsert && status != NET_ASYNC_NOT_READY) {
+          // 插入完成，不论成功与否都把用户名加入布隆过滤器（失败多半是用户名已存在）
+          UserFilter::Instance()->Add(job->name.data(), job->name.size());
+        }
+        if (status == NET_ASYNC_ERROR) {
+          LOG_WARN("SqlAsync query error: %s", mysql_error(job->sql));
+          if (job->step == kInsert) {
+            // 注册失败时结果不确定，删除缓存，下次重新查询
+            UserCache::Instance()->Erase(job->name);
+          }
+          Finish_(job, kFailed);
+          return;
+        }
+        if (job->step == kInsert) {
+          LOG_DEBUG("register!");
+          UserCache::Instance()->Put(job->name, job->pwd);
+          Finish_(job, kVerified);
+          return;
+        }
+        job->step = kStore;
+        break;
+      }
+      case kStore: {
+        MYSQL_RES *res = nullptr;
+        net_async_status status = mysql_store_result_nonblocking(job->sql, &res);
+        if (status == NET_ASYNC_NOT_READY) {
+          Wait_(job);
+          return;
+        }
+        if (status == NET_ASYNC_ERROR || res == nullptr) {
+          LOG_WARN("SqlAsync store result error: %s", mysql_error(job->sql));
+          Finish_(job, kFailed);
+          return;
+        }
+        // 和同步验证相同的判断：登录时密码一致才通过，注册时用户名不存在才通过
+        // 查询结果同时写入用户缓存
+        bool flag = !job->is_login;
+        bool found = false;
+        while (MYSQL_ROW row = mysql_fetch_row(res)) {
+          found = true;
+          if (row[1] == nullptr) {
+            // passwd为NULL的用户无法登录，用户名已被占用，也不写入缓存
+            flag = false;
+            continue;
+          }
+          UserCache::Instance()->Put(job->name, row[1]);
+          if (job->is_login) {
+            flag = (job->pwd == row[1]);
+          } else {
+            flag = false;
+          }
+        }
+        if (!found) {
+          UserCache::Instance()->PutAbsent(job->name);
+        }
+        mysql_free_result(res);
+        if (!job->is_login && flag && InsertBatcher::Instance()->IsOpen()) {
+          // 用户名可用，先归还连接，插入交给组提交
+          ReleaseConn_(job);
+          SubmitInsert_(job);
+          StartJobs_();
+          return;
+        }
+        if (!job->is_login && flag) {
+          job->step = kInsert;
+          MakeQuery_(job, true);
+          break;
+        }
+        Finish_(job, flag ? kVerified : kFailed);
+        return;
+      }
+    }
+  }
+}
+
+// 等待连接的套接字可读，套接字按EPOLLONESHOT注册，每次等待前重新激活
+void SqlAsync::Wait_(Job *job) {
+  int fd = job->sql->net.fd;
+  uint32_t events = EPOLLIN | EPOLLONESHOT;
+  if (job->is_registered) {
+    epoller_->ModFd(fd, events);
+  } else {
+    epoller_->AddFd(fd, events);
+    job->is_registered = true;
+  }
+}
+
+// 任务完成，归还连接，调用回调，再为等待中的任务分配这个连接
+void SqlAsync::Finish_(Job *job, Result result) {
+  ReleaseConn_(job);
+  Complete_(job, result);
+  StartJobs_();
+}
+
+// 从epoller中移除连接的套接字，把连接还给连接池
+void SqlAsync::ReleaseConn_(Job *job) {
+  int fd = job->sql->net.fd;
+  if (job->is_registered) {
+    epoller_->DelFd(fd);
+    job->is_registered = false;
+  }
+  running_.erase(fd);
+  SqlConnPool::Instance()->FreeConn(job->sql);
+  job->sql = nullptr;
+}
+
+// 记录数据库往返耗时，调用回调，释放任务
+void SqlAsync::Complete_(Job *job, Result result) {
+  Metrics::Instance()->RecordLatency(Metrics::kSqlVerify,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - job->submitted_at).count());
+  job->callback(result);
+  delete job;
+}
+
+// 按原来的规则拼接查询语句，用户名和密码经过转义
+void SqlAsync::MakeQuery_(Job *job, bool is_insert) {
+  std::string name(job->name.size() * 2 + 1, '\0');
+  name.resize(mysql_real_escape_string(job->sql, &name[0], job->name.data(), job->name.size()));
+  if (is_insert) {
+    std::string pwd(job->pwd.size() * 2 + 1, '\0');
+    pwd.resize(mysql_real_escape_string(job->sql, &pwd[0], job->pwd.data(), job->pwd.size()));
+    job->query = "INSERT INTO user(username, passwd) VALUES('" + name + "', '" + pwd + "')";
+  } else {
+    job->query = "SELECT username, passwd FROM user WHERE username='" + name + "' LIMIT 1";
+  }
+  LOG_DEBUG("%s", job->query.c_str());
+}
+
+void SqlAsync::Close() {
+  if (is_waiting_conn_) {
+    SqlConnPool::Instance()->SetNotifyFd(-1);
+    is_waiting_conn_ = false;
+  }
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+    event_fd_ = -1;
+  }
+  if (timer_fd_ >= 0) {
+    close(timer_fd_);
+    timer_fd_ = -1;
+  }
+}
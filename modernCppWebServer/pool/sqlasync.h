@@ -0,0 +1,123 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_SQLASYNC_H_
+#define MODERNCPPWEBSERVER_POOL_SQLASYNC_H_
+
+#include <mysql/mysql.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../log/log.h"
+#include "../metrics/metrics.h"
+#include "../server/epoller.h"
+#include "sqlconnpool.h"
+#include "usercache.h"
+#include "userfilter.h"
+#include "insertbatcher.h"
+
+// 用MySQL客户端的非阻塞接口（mysql_real_query_nonblocking等）在主线程的事件循环中执行账号验证
+// 工作线程解析出登录/注册请求后调用SubmitVerify提交，不再阻塞在取连接和数据库往返上；
+// 主线程通过eventfd收到任务，从连接池取空闲连接，把连接的套接字注册到Epoller中，
+// 套接字可读时推进查询的状态机，完成后在主线程调用任务的回调
+// 没有空闲连接时任务排队，连接池归还连接时通过同一个eventfd唤醒；排队超过wait_timeout_ms的任务以kUnavailable完成（返回503），
+// 和同步验证在连接池上等待超时的行为一致，数据库不可用时登录不会一直挂到客户端超时
+// 取到连接后执行超过query_timeout_ms的任务（数据库卡住、网络断开但没有RST）同样以kUnavailable完成，连接上还有未完成的查询，关闭丢弃
+// 除SubmitVerify外的成员函数都只在主线程调用
+class SqlAsync {
+ public:
+  // 验证的结果
+  enum Result {
+    kFailed = 0,   // 验证未通过（密码错误、用户名已存在、查询出错）
+    kVerified,     // 验证通过
+    kUnavailable,  // 等待数据库连接超时，应返回503
+  };
+  // 验证完成的回调
+  typedef std::function<void(Result)> Callback;
+
+  // 创建静态对象，单例模式获取对象的方法
+  static SqlAsync *Instance();
+
+  // 创建eventfd和timerfd并注册到主线程的epoller中，失败时返回false，此时仍使用同步验证
+  // wait_timeout_ms为任务等待空闲连接的最长时间，query_timeout_ms为取到连接后执行的最长时间
+  bool Init(Epoller *epoller, int wait_timeout_ms, int query_timeout_ms);
+  bool IsOpen() const {
+    return event_fd_ >= 0;
+  }
+
+  // 提交一次登录（is_login为true）或注册验证，可在任意线程调用
+  void SubmitVerify(const std::string &name, const std::string &pwd, bool is_login, Callback callback);
+
+  // 处理epoller中的一个事件，fd属于本对象（eventfd、timerfd或数据库连接的套接字）时处理并返回true
+  bool HandleEvent(int fd, uint32_t events);
+
+  void Close();
+
+ private:
+  SqlAsync();
+  ~SqlAsync();
+
+  // 一次验证的执行状态
+  enum Step {
+    kSelect,   // 发送查询用户的语句
+    kStore,    // 接收查询结果
+    kInsert,   // 注册时发送插入语句
+  };
+
+  struct Job {
+    std::string name;
+    std::string pwd;
+    bool is_login;
+    Callback callback;
+    std::chrono::steady_clock::time_point submitted_at;
+    std::chrono::steady_clock::time_point deadline;  // 等待时为取连接的截止时间，执行时为查询的截止时间，超过则以kUnavailable完成
+    MYSQL *sql;
+    Step step;
+    std::string query;
+    bool is_registered;  // 连接的套接字是否已加入epoller
+  };
+
+  // 为等待中的任务分配空闲连接并开始执行，没有空闲连接时等连接池归还连接后再试
+  void StartJobs_();
+  // 以kUnavailable完成等待连接超时和执行超时的任务
+  void ExpireJobs_();
+  // 按等待和执行中任务最早的截止时间设置timerfd，都没有时停止计时；没有等待的任务时不再接收连接池的通知
+  void ArmTimer_();
+  // 推进任务的状态机，直到需要等待套接字或任务完成
+  void Step_(Job *job);
+  // 等待连接的套接字可读
+  void Wait_(Job *job);
+  // 任务完成，归还连接，调用回调
+  void Finish_(Job *job, Result result);
+  // 归还任务占用的连接
+  void ReleaseConn_(Job *job);
+  // 调用任务的回调并释放任务
+  void Complete_(Job *job, Result result);
+  // 把注册的插入交给组提交（InsertBatcher）
+  void SubmitInsert_(Job *job);
+  // 按原来的规则拼接查询语句，用户名和密码经过转义
+  // 客户端库的非阻塞接口只有文本协议的查询，没有预处理语句的版本，连接池缓存的语句在这里用不上
+  void MakeQuery_(Job *job, bool is_insert);
+
+  Epoller *epoller_;
+  int event_fd_;
+  int timer_fd_;
+  std::chrono::milliseconds wait_timeout_;
+  std::chrono::milliseconds query_timeout_;
+  bool is_waiting_conn_;  // 是否已让连接池在归还连接时通知
+  std::chrono::steady_clock::time_point armed_deadline_;  // timerfd当前的截止时间，未计时时为零
+
+  std::mutex mtx_;
+  std::deque<Job *> submitted_;   // 工作线程提交的任务，由mtx_保护
+  std::deque<std::pair<Job *, InsertBatcher::Result>> inserted_;  // 组提交完成的注册及其结果，由mtx_保护
+  std::deque<Job *> pending_;     // 主线程中等待空闲连接的任务，按提交顺序排列，表头的截止时间最早
+  std::unordered_map<int, Job *> running_;  // 正在执行的任务，键为连接的套接字，任务数不超过连接池的上限
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_SQLASYNC_H_
@@ -4,7 +4,27 @@
 
 #include "sqlconnpool.h"
 
-SqlConnPool::SqlConnPool() : use_count_(0), free_count_(0) {
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// 语句中的参数用?占位，以二进制协议绑定，不需要拼接和转义
+const char *const SqlConnPool::kStmtSql[kStmtNum] = {
+    "SELECT passwd FROM user WHERE username = ? LIMIT 1",
+    "INSERT INTO user(username, passwd) VALUES(?, ?)",
+};
+
+const int SqlConnPool::kConnectTimeoutSec;
+const int SqlConnPool::kReadTimeoutSec;
+const int SqlConnPool::kMaintainIntervalMs;
+const int SqlConnPool::kCheckIntervalMs;
+const int SqlConnPool::kIdleTimeoutMs;
+const int SqlConnPool::kGrowBackoffMs;
+
+SqlConnPool::SqlConnPool()
+    : port_(0), min_count_(0), max_count_(0), wait_timeout_(0),
+      conn_count_(0), is_closed_(true), notify_fd_(-1) {
 }
 
 // 创建数据库连接池静态变量，返回其地址（指针）
@@ -13,88 +33,412 @@ SqlConnPool *SqlConnPool::Instance() {
   return &conn_pool;
 }
 
-// 初始化数据库连接池，创建连接线程，初始化信号量
+// 初始化数据库连接池，并行建立连接，启动维护线程，初始化信号量
 void SqlConnPool::Init(const char *host,
                        int port,
                        const char *user,
                        const char *pwd,
                        const char *db_name,
-                       int conn_size) {
+                       int min_size,
+                       int max_size,
+                       int wait_timeout_ms) {
   // 连接数量要大于0
-  assert(conn_size > 0);
-  // 用一个循环创建conn_size个连接
-  for (int i = 0; i < conn_size; ++i) {
-    MYSQL *sql = nullptr;
-    // 初始化MYSQL结构，如果失败，记录日志
-    sql = mysql_init(sql);
-    if (!sql) {
-      LOG_ERROR("MySql init error!");
-      assert(sql);
+  assert(min_size > 0 && max_size >= min_size);
+  host_ = host;
+  port_ = port;
+  user_ = user;
+  pwd_ = pwd;
+  db_name_ = db_name;
+  min_count_ = min_size;
+  max_count_ = max_size;
+  wait_timeout_ = std::chrono::milliseconds(wait_timeout_ms);
+  is_closed_ = false;
+  sem_init(&sem_id_, 0, 0);
+
+  // 原来逐个建立连接，每个连接都要一次TCP握手和认证往返，这里并行建立
+  // 第一个连接单独建立，mysql_init第一次调用时会初始化客户端库，这一步不是线程安全的
+  std::vector<MYSQL *> conns(min_size, nullptr);
+  conns[0] = Connect_();
+  std::vector<std::thread> threads;
+  for (int i = 1; i < min_size; ++i) {
+    threads.emplace_back([this, &conns, i] {
+      conns[i] = Connect_();
+      mysql_thread_end();
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (MYSQL *sql : conns) {
+    // 连接失败的不放入连接池，由维护线程稍后重试
+    if (sql != nullptr) {
+      {
+        std::lock_guard<std::mutex> locker(mtx_);
+        ++conn_count_;
+      }
+      AddIdle_(sql);
     }
-    // 建立数据库连接，如果失败，记录日志
-    sql = mysql_real_connect(sql, host, user, pwd, db_name, port, nullptr, 0);
-    if (!sql) {
-      LOG_ERROR("MySql Connect error!");
+  }
+  if (conn_count_ < min_count_) {
+    LOG_ERROR("SqlConnPool: only %d of %d connections established", conn_count_, min_count_);
+  }
+  maintainer_ = std::thread(&SqlConnPool::Maintain_, this);
+}
+
+// 建立一个新连接，设置连接和读写超时，失败返回空指针
+MYSQL *SqlConnPool::Connect_() {
+  MYSQL *sql = mysql_init(nullptr);
+  if (!sql) {
+    LOG_ERROR("MySql init error!");
+    return nullptr;
+  }
+  unsigned int connect_timeout = kConnectTimeoutSec;
+  unsigned int read_timeout = kReadTimeoutSec;
+  mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &connect_timeout);
+  mysql_options(sql, MYSQL_OPT_READ_TIMEOUT, &read_timeout);
+  mysql_options(sql, MYSQL_OPT_WRITE_TIMEOUT, &read_timeout);
+  // 建立数据库连接，如果失败，记录日志
+  if (!mysql_real_connect(sql, host_.c_str(), user_.c_str(), pwd_.c_str(), db_name_.c_str(),
+                          port_, nullptr, 0)) {
+    LOG_ERROR("MySql Connect error: %s", mysql_error(sql));
+    mysql_close(sql);
+    return nullptr;
+  }
+  return sql;
+}
+
+// 将新连接放入空闲队列并为其建立空的语句缓存
+void SqlConnPool::AddIdle_(MYSQL *sql) {
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    stmt_caches_[sql] = StmtCache();
+    idle_.push_front(IdleConn{sql, std::chrono::steady_clock::now()});
+  }
+  PostIdle_();
+}
+
+void SqlConnPool::PostIdle_() {
+  sem_post(&sem_id_);
+  int fd = notify_fd_.load(std::memory_order_acquire);
+  if (fd >= 0) {
+    uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      LOG_ERROR("SqlConnPool notify error!");
     }
-    // 将一个连接放入连接池队列（初始化不用加锁）
-    conn_que_.push(sql);
   }
-  // 记录连接池池大小
-  max_count_ = conn_size;
-  // 初始化信号量为max_count_
-  sem_init(&sem_id_, 0, max_count_);
+}
+
+// 已经减少了信号量，队列中一定有连接，从表头取最近归还的，使闲置的连接留在表尾以便回收
+MYSQL *SqlConnPool::PopIdle_() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  assert(!idle_.empty());
+  MYSQL *sql = idle_.front().sql;
+  idle_.pop_front();
+  return sql;
 }
 
 // 从数据库连接池中获取一个连接
 MYSQL *SqlConnPool::GetConn() {
-  MYSQL *sql = nullptr;
-  if (conn_que_.empty()) {
-    // 如果连接池为空，即没有可用连接，记录日志并返回空指针
-    LOG_WARN("SqlConnPoll busy!");
+  // 有空闲连接时直接取出
+  if (sem_trywait(&sem_id_) == 0) {
+    return PopIdle_();
+  }
+  // 没有空闲连接，未达上限时新建一个
+  MYSQL *sql = Grow_();
+  if (sql != nullptr) {
+    return sql;
+  }
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (conn_count_ == 0 || is_closed_) {
+      // 一个连接都没有（数据库不可用），等待也不会有连接归还，直接失败
+      Metrics::Instance()->Add(Metrics::kSqlPoolTimeouts);
+      return nullptr;
+    }
+  }
+  // 原来用sem_wait一直阻塞，数据库卡住时所有工作线程都会卡在这里，改为最多等待wait_timeout_
+  Metrics::Instance()->Add(Metrics::kSqlPoolWaits);
+  auto wait_begin = std::chrono::steady_clock::now();
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  long long nsec = deadline.tv_nsec
+      + std::chrono::duration_cast<std::chrono::nanoseconds>(wait_timeout_).count();
+  deadline.tv_sec += nsec / 1000000000;
+  deadline.tv_nsec = nsec % 1000000000;
+  int ret;
+  while ((ret = sem_timedwait(&sem_id_, &deadline)) != 0 && errno == EINTR) {
+  }
+  Metrics::Instance()->RecordLatency(Metrics::kSqlPoolWait,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - wait_begin).count());
+  if (ret != 0) {
+    Metrics::Instance()->Add(Metrics::kSqlPoolTimeouts);
+    LOG_WARN("SqlConnPool busy!");
     return nullptr;
   }
-  // 减少一个信号量
-  sem_wait(&sem_id_);
+  return PopIdle_();
+}
+
+// 未达上限时新建一个连接，建立连接的过程在锁外进行；失败后一段时间内不再尝试，避免数据库宕机时每个请求都去连接
+MYSQL *SqlConnPool::Grow_() {
   {
-    // 上锁后从数据库连接池队列取出一个连接
     std::lock_guard<std::mutex> locker(mtx_);
-    sql = conn_que_.front();
-    conn_que_.pop();
+    if (is_closed_ || conn_count_ >= max_count_ || std::chrono::steady_clock::now() < next_grow_) {
+      return nullptr;
+    }
+    ++conn_count_;
+  }
+  MYSQL *sql = Connect_();
+  std::lock_guard<std::mutex> locker(mtx_);
+  if (sql == nullptr) {
+    --conn_count_;
+    next_grow_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(kGrowBackoffMs);
+    return nullptr;
   }
+  stmt_caches_[sql] = StmtCache();
+  LOG_INFO("SqlConnPool: grew to %d connections", conn_count_);
   return sql;
 }
 
+// 不等待地取一个空闲连接，没有空闲连接时返回空指针
+MYSQL *SqlConnPool::TryGetConn() {
+  if (sem_trywait(&sem_id_) != 0) {
+    return nullptr;
+  }
+  return PopIdle_();
+}
+
 // 释放一个连接conn，将其返回数据库连接池队列
 void SqlConnPool::FreeConn(MYSQL *conn) {
   assert(conn);
-  std::lock_guard<std::mutex> locker(mtx_);
-  conn_que_.push(conn);
-  sem_post(&sem_id_);
+  unsigned int err = mysql_errno(conn);
+  if (err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST) {
+    // 连接在使用中断开，放回去只会让下一个请求再失败一次
+    LOG_WARN("SqlConnPool: connection lost (%u), reconnecting", err);
+    Discard_(conn);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!is_closed_) {
+      idle_.push_front(IdleConn{conn, std::chrono::steady_clock::now()});
+      conn = nullptr;
+    }
+  }
+  if (conn == nullptr) {
+    PostIdle_();
+  } else {
+    // 连接池已关闭，连接用完后直接关闭
+    Discard_(conn);
+  }
 }
 
-// 关闭数据库连接池
-void SqlConnPool::ClosePool() {
-  std::lock_guard<std::mutex> locker(mtx_); // 访问队列时上锁
-  while (!conn_que_.empty()) {
-    // 弹出连接池队列所有连接，将其关闭
-    auto item = conn_que_.front();
-    conn_que_.pop();
-    mysql_close(item);
+// 连接上可能还有未读完的结果，直接关闭
+void SqlConnPool::DiscardConn(MYSQL *conn) {
+  assert(conn);
+  Discard_(conn);
+}
+
+// 关闭一个不在空闲队列中的连接，并唤醒维护线程补足下限
+void SqlConnPool::Discard_(MYSQL *sql) {
+  StmtCache cache;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = stmt_caches_.find(sql);
+    assert(it != stmt_caches_.end());
+    cache = it->second;
+    stmt_caches_.erase(it);
+    --conn_count_;
   }
+  Metrics::Instance()->Add(Metrics::kSqlConnDiscards);
+  cond_.notify_one();
+  Close_(sql, cache);
 }
 
-// 返回当前可用连接数量，即连接池队列的当前大小
-int SqlConnPool::GetFreeConnCount() {
-  std::lock_guard<std::mutex> locker(mtx_);
-  return conn_que_.size();
+// 关闭连接上缓存的语句，再关闭连接
+void SqlConnPool::Close_(MYSQL *sql, StmtCache &cache) {
+  for (MYSQL_STMT *&stmt : cache.stmts) {
+    if (stmt != nullptr) {
+      mysql_stmt_close(stmt);
+      stmt = nullptr;
+    }
+  }
+  mysql_close(sql);
 }
 
-SqlConnPool::~SqlConnPool() {
-  ClosePool();
+// 维护线程，每隔kMaintainIntervalMs（或有连接被关闭时）补足下限，每隔kCheckIntervalMs检查一次空闲连接
+void SqlConnPool::Maintain_() {
+  auto next_check = std::chrono::steady_clock::now() + std::chrono::milliseconds(kCheckIntervalMs);
+  std::unique_lock<std::mutex> locker(mtx_);
+  while (!is_closed_) {
+    cond_.wait_for(locker, std::chrono::milliseconds(kMaintainIntervalMs));
+    if (is_closed_) {
+      break;
+    }
+    locker.unlock();
+    Refill_();
+    if (std::chrono::steady_clock::now() >= next_check) {
+      CheckIdle_();
+      next_check = std::chrono::steady_clock::now() + std::chrono::milliseconds(kCheckIntervalMs);
+    }
+    locker.lock();
+  }
+  locker.unlock();
+  mysql_thread_end();
+}
+
+// 连接数低于下限时逐个补充，建立失败（数据库仍不可用）时等下一轮再试
+void SqlConnPool::Refill_() {
+  while (true) {
+    {
+      std::lock_guard<std::mutex> locker(mtx_);
+      if (is_closed_ || conn_count_ >= min_count_) {
+        return;
+      }
+      ++conn_count_;
+    }
+    MYSQL *sql = Connect_();
+    if (sql == nullptr) {
+      std::lock_guard<std::mutex> locker(mtx_);
+      --conn_count_;
+      return;
+    }
+    AddIdle_(sql);
+    LOG_INFO("SqlConnPool: reconnected, %d connections", GetConnCount());
+  }
+}
+
+// 从表尾取出闲置超过kCheckIntervalMs的空闲连接（先减少信号量，保证不会取走别人已经占用的）
+// 连接数超过下限且闲置超过kIdleTimeoutMs的关闭，其余ping一次：正常的放回表尾，断开的关闭
+void SqlConnPool::CheckIdle_() {
+  auto now = std::chrono::steady_clock::now();
+  std::vector<MYSQL *> to_check;
+  std::vector<std::pair<MYSQL *, StmtCache>> to_close;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    while (!idle_.empty() && now - idle_.back().since >= std::chrono::milliseconds(kCheckIntervalMs)) {
+      if (sem_trywait(&sem_id_) != 0) {
+        break;
+      }
+      IdleConn conn = idle_.back();
+      idle_.pop_back();
+      if (conn_count_ > min_count_ && now - conn.since >= std::chrono::milliseconds(kIdleTimeoutMs)) {
+        auto it = stmt_caches_.find(conn.sql);
+        to_close.emplace_back(conn.sql, it->second);
+        stmt_caches_.erase(it);
+        --conn_count_;
+      } else {
+        to_check.push_back(conn.sql);
+      }
+    }
+  }
+  for (auto &conn : to_close) {
+    Close_(conn.first, conn.second);
+  }
+  if (!to_close.empty()) {
+    LOG_INFO("SqlConnPool: closed %d idle connections", static_cast<int>(to_close.size()));
+  }
+  for (MYSQL *sql : to_check) {
+    if (mysql_ping(sql) != 0) {
+      LOG_WARN("SqlConnPool: ping failed: %s", mysql_error(sql));
+      Discard_(sql);
+      continue;
+    }
+    {
+      // 检查通过的连接仍按闲置时间排在表尾，以便继续闲置时被回收
+      std::lock_guard<std::mutex> locker(mtx_);
+      idle_.push_back(IdleConn{sql, now});
+    }
+    PostIdle_();
+  }
 }
 
+// 返回连接sql上预处理好的语句，没有缓存时预处理并缓存
+MYSQL_STMT *SqlConnPool::GetStmt(MYSQL *sql, StmtId id) {
+  assert(sql);
+  StmtCache *cache;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = stmt_caches_.find(sql);
+    assert(it != stmt_caches_.end());
+    cache = &it->second;
+  }
+  MYSQL_STMT *&stmt = cache->stmts[id];
+  if (stmt != nullptr) {
+    return stmt;
+  }
+  MYSQL_STMT *new_stmt = mysql_stmt_init(sql);
+  if (new_stmt == nullptr) {
+    LOG_ERROR("MySql stmt init error!");
+    return nullptr;
+  }
+  if (mysql_stmt_prepare(new_stmt, kStmtSql[id], strlen(kStmtSql[id])) != 0) {
+    LOG_ERROR("MySql stmt prepare error: %s", mysql_stmt_error(new_stmt));
+    mysql_stmt_close(new_stmt);
+    return nullptr;
+  }
+  stmt = new_stmt;
+  return stmt;
+}
 
+// 丢弃连接sql上缓存的语句
+void SqlConnPool::DropStmt(MYSQL *sql, StmtId id) {
+  StmtCache *cache;
+  {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = stmt_caches_.find(sql);
+    assert(it != stmt_caches_.end());
+    cache = &it->second;
+  }
+  MYSQL_STMT *&stmt = cache->stmts[id];
+  if (stmt != nullptr) {
+    mysql_stmt_close(stmt);
+    stmt = nullptr;
+  }
+}
 
+// 关闭数据库连接池，停止维护线程，关闭空闲连接；使用中的连接在归还时关闭
+void SqlConnPool::ClosePool() {
+  std::deque<IdleConn> idle;
+  {
+    std::lock_guard<std::mutex> locker(mtx_); // 访问队列时上锁
+    if (is_closed_) {
+      return;
+    }
+    is_closed_ = true;
+    idle.swap(idle_);
+  }
+  cond_.notify_one();
+  if (maintainer_.joinable()) {
+    maintainer_.join();
+  }
+  for (IdleConn &conn : idle) {
+    // 先关闭其上缓存的语句，再将其关闭
+    sem_trywait(&sem_id_);
+    StmtCache cache;
+    {
+      std::lock_guard<std::mutex> locker(mtx_);
+      auto it = stmt_caches_.find(conn.sql);
+      cache = it->second;
+      stmt_caches_.erase(it);
+      --conn_count_;
+    }
+    Close_(conn.sql, cache);
+  }
+}
 
+// 返回当前可用连接数量，即空闲队列的当前大小
+int SqlConnPool::GetFreeConnCount() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  return idle_.size();
+}
 
+// 返回当前打开的连接数量
+int SqlConnPool::GetConnCount() {
+  std::lock_guard<std::mutex> locker(mtx_);
+  return conn_count_;
+}
 
+SqlConnPool::~SqlConnPool() {
+  ClosePool();
+}
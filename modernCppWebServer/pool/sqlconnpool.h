@@ -6,29 +6,63 @@
 #define MODERNCPPWEBSERVER_POOL_SQLCONNPOOL_H_
 
 #include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <string>
-#include <queue>
+#include <unordered_map>
 #include <mutex>
 #include <semaphore.h>
 #include <thread>
 #include "../log/log.h"
+#include "../metrics/metrics.h"
 
+// 数据库连接池，连接数在[min, max]之间伸缩：
+// 启动时并行建立min个连接；没有空闲连接时按需新建，直到max个；
+// 空闲太久的连接（超过min的部分）由维护线程关闭，其余的定期ping，断开的关闭后重新补足min个
 class SqlConnPool {
  public:
+  // 每个连接上缓存的预处理语句
+  enum StmtId {
+    kStmtSelectUser = 0,  // 按用户名查询密码
+    kStmtInsertUser,      // 插入新用户
+    kStmtNum,
+  };
+
   // 创建数据库连接池静态变量，返回其地址（指针）
   static SqlConnPool *Instance();
 
-  // 从数据库连接池中获取一个连接，为空返回空指针，否则返回此连接
+  // 从数据库连接池中获取一个连接：没有空闲连接时先尝试新建，已达上限则最多等待wait_timeout_ms，
+  // 超时或数据库不可用时返回空指针，调用者应尽快失败（返回503）而不是一直阻塞
   MYSQL *GetConn();
-  // 释放一个连接conn，将其返回数据库连接池队列
+  // 不等待地取一个空闲连接，没有空闲连接时返回空指针（用于主线程中的异步查询）
+  MYSQL *TryGetConn();
+  // 释放一个连接conn，将其返回数据库连接池队列；连接已断开（如数据库重启）时关闭它，由维护线程补充
   void FreeConn(MYSQL *conn);
-  // 返回当前可用连接数量，即连接池队列的当前大小
+  // 关闭一个取出的连接而不放回队列，用于连接上还有未完成的查询（如异步查询超时）的情况，由维护线程补充
+  void DiscardConn(MYSQL *conn);
+  // 设置有连接回到空闲队列（归还、补充、检查通过）时写入的eventfd，-1表示不通知
+  // 主线程的异步查询在有任务等待连接时设置，不必等下一个任务完成才发现有空闲连接
+  void SetNotifyFd(int fd) {
+    notify_fd_.store(fd, std::memory_order_release);
+  }
+  // 返回当前可用连接数量，即空闲队列的当前大小
   int GetFreeConnCount();
+  // 返回当前打开的连接数量，包括使用中的和正在建立的
+  int GetConnCount();
+
+  // 返回连接sql上预处理好的语句，第一次使用时才向服务器预处理，失败返回空指针
+  // 调用者必须持有这个连接（从连接池中取出），一个连接同时只被一个线程使用，语句本身不需要加锁
+  MYSQL_STMT *GetStmt(MYSQL *sql, StmtId id);
+  // 语句执行出错（如连接断开重连后语句已失效）时丢弃缓存，下次使用时重新预处理
+  void DropStmt(MYSQL *sql, StmtId id);
 
-  // 初始化数据库连接池，创建连接线程，初始化信号量
+  // 初始化数据库连接池，并行建立min_size个连接，启动维护线程，初始化信号量
   void Init(const char *host, int port,
             const char *user, const char *pwd,
-            const char *db_name, int conn_size);
+            const char *db_name, int min_size, int max_size, int wait_timeout_ms);
   // 关闭数据库连接池
   void ClosePool();
 
@@ -36,13 +70,68 @@ class SqlConnPool {
   SqlConnPool();
   ~SqlConnPool();
 
-  int max_count_; // 数据库连接池的连接数量
-  int use_count_; // 初始化后未使用
-  int free_count_;  // 初始化后未使用
+  // 一个连接上缓存的全部预处理语句
+  struct StmtCache {
+    MYSQL_STMT *stmts[kStmtNum];
+  };
+
+  // 空闲队列中的一个连接，since为归还（或上次检查通过）的时间
+  struct IdleConn {
+    MYSQL *sql;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  // 建立一个新连接，设置连接和读写超时，失败返回空指针
+  MYSQL *Connect_();
+  // 没有空闲连接时，在未达上限的情况下新建一个连接直接交给调用者，失败返回空指针
+  MYSQL *Grow_();
+  // 将新连接放入空闲队列并为其建立空的语句缓存
+  void AddIdle_(MYSQL *sql);
+  // 已经减少了信号量后，从空闲队列表头（最近归还的）取出一个连接
+  MYSQL *PopIdle_();
+  // 增加空闲连接的信号量，并通知等待连接的异步查询
+  void PostIdle_();
+  // 关闭一个不在空闲队列中的连接，连接数减一，并唤醒维护线程补足下限
+  void Discard_(MYSQL *sql);
+  // 关闭连接上缓存的语句和连接本身，不加锁，调用前需将其移出stmt_caches_
+  static void Close_(MYSQL *sql, StmtCache &cache);
 
-  std::queue<MYSQL *> conn_que_;  // 数据库连接队列
+  // 维护线程：补足min个连接，定期检查空闲连接
+  void Maintain_();
+  void Refill_();
+  // 取出长时间未使用的空闲连接，超过下限的关闭，其余ping一次，断开的关闭
+  void CheckIdle_();
+
+  static const char *const kStmtSql[kStmtNum];
+  static const int kConnectTimeoutSec = 2;  // 建立连接的超时，数据库宕机时不至于长时间阻塞
+  static const int kReadTimeoutSec = 5;     // 同步读写的超时
+  static const int kMaintainIntervalMs = 1000;  // 维护线程补充连接的间隔
+  static const int kCheckIntervalMs = 10000;    // 空闲连接闲置超过此时间就ping一次
+  static const int kIdleTimeoutMs = 60000;      // 超过下限的空闲连接闲置超过此时间就关闭
+  static const int kGrowBackoffMs = 1000;       // 按需新建连接失败后，这段时间内不再尝试
+
+  std::string host_;
+  int port_;
+  std::string user_;
+  std::string pwd_;
+  std::string db_name_;
+  int min_count_; // 连接数下限，维护线程保证至少有这么多连接
+  int max_count_; // 连接数上限
+  std::chrono::milliseconds wait_timeout_;  // 取连接时最多等待的时间
+
+  // 以下受mtx_保护
+  int conn_count_;  // 打开的连接数，包括使用中的和正在建立的
+  std::deque<IdleConn> idle_;   // 空闲连接队列，表头为最近归还的，表尾为闲置最久的
+  // 每个连接的语句缓存，连接建立时加入，关闭时删除；元素的引用在rehash后仍然有效，查找后可以在锁外使用
+  std::unordered_map<MYSQL *, StmtCache> stmt_caches_;
+  std::chrono::steady_clock::time_point next_grow_;  // 在此时间之前不再按需新建连接
+  bool is_closed_;
   std::mutex mtx_;
-  sem_t sem_id_;
+
+  std::condition_variable cond_;  // 唤醒维护线程
+  std::thread maintainer_;
+  sem_t sem_id_;  // 空闲连接数，先减少信号量再从队列取连接，先放入队列再增加信号量
+  std::atomic<int> notify_fd_;  // 见SetNotifyFd
 };
 
 #endif //MODERNCPPWEBSERVER_POOL_SQLCONNPOOL_H_
@@ -5,7 +5,10 @@
 #ifndef MODERNCPPWEBSERVER_THREADPOOL_H
 #define MODERNCPPWEBSERVER_THREADPOOL_H
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -14,25 +17,48 @@
 #include <thread>
 #include <utility>
 
+#include "../metrics/metrics.h"
+
 class ThreadPool {
  public:
+  // 任务的优先级，工作线程优先取高优先级的任务
+  // 静态资源等开销小的请求为高优先级，需要访问数据库的登录/注册为低优先级，过载时先被拒绝
+  enum Priority {
+    kHigh = 0,
+    kLow,
+    kPriorityNum,
+  };
+
   // 线程池构造函数使用关键字explicit阻止构造函数在隐式转换中使用
   // 初始化列表调用make_shared函数，创建线程池结构体，并给智能指针赋值
-  explicit ThreadPool(size_t thread_count = 8)
+  // max_tasks为TryAddTask时每个优先级队列的最大长度，0为不限制
+  explicit ThreadPool(size_t thread_count = 8, size_t max_tasks = 0)
       : pool_(std::make_shared<Pool>()) {
     // 确保线程池线程总量要大于0
     assert(thread_count > 0);
+    pool_->max_tasks = max_tasks;
     // 使用一个循环逐个初始化所有线程
     for (size_t i = 0; i < thread_count; ++i) {
       std::thread([pool = pool_]  {
         std::unique_lock<std::mutex> locker(pool->mtx); // 这里上锁
+        Task task;
+        bool is_shed = false;
         while (true) {
-          if (!pool->tasks.empty()) {
-            // 任务队列，非空，则从队列中取出任务，取出的任务对象（仿函数）采用移动赋值，更高效
-            auto task = std::move(pool->tasks.front());
-            pool->tasks.pop();
+          if (pool->Take(&task, &is_shed)) {
+            // 任务队列非空，取出的任务对象（仿函数）采用移动赋值，更高效
             locker.unlock(); // 从队列中取出任务后解锁
-            task();          // 执行任务
+            // 记录任务在队列中的等待时间
+            Metrics::Instance()->RecordLatency(Metrics::kQueueWait,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - task.enqueued_at).count());
+            if (is_shed) {
+              // 排队时间持续过长，不再执行，由拒绝函数回复客户端
+              Metrics::Instance()->Add(Metrics::kShedQueueDelay);
+              task.shed();
+            } else {
+              task.func();     // 执行任务
+            }
+            task = Task();   // 在锁外释放任务捕获的对象
             locker.lock();   // 重新上锁，互斥访问队列
           } else if (pool->is_closed) {
             // 线程池关闭，退出循环，即退出线程
@@ -63,22 +89,121 @@ class ThreadPool {
     }
   }
 
+  // 添加一定要执行的任务（如已接受的请求的后续写入），放入高优先级队列，不受队列长度限制
   template<typename F>
   void AddTask(F &&task) {
     {
       // 这里有大括号，是为了提前是否锁，locker在作用域结束后释放锁，而不是在析构函数结束再释放
       std::lock_guard<std::mutex> locker(pool_->mtx);
-      pool_->tasks.emplace(std::forward<F>(task));
+      pool_->tasks[kHigh].push({std::forward<F>(task), nullptr, std::chrono::steady_clock::now()});
+      pool_->queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    pool_->cond.notify_one();
+  }
+
+  // 添加可以拒绝的任务（新到达的请求），队列已满时不加入并返回false；
+  // 加入后排队时间持续过长（CoDel）时，工作线程执行shed而不是task
+  template<typename F, typename S>
+  bool TryAddTask(F &&task, S &&shed, Priority priority) {
+    {
+      std::lock_guard<std::mutex> locker(pool_->mtx);
+      std::queue<Task> &tasks = pool_->tasks[priority];
+      if (pool_->max_tasks > 0 && tasks.size() >= pool_->max_tasks) {
+        Metrics::Instance()->Add(Metrics::kShedQueueFull);
+        return false;
+      }
+      tasks.push({std::forward<F>(task), std::forward<S>(shed), std::chrono::steady_clock::now()});
+      pool_->queued.fetch_add(1, std::memory_order_relaxed);
     }
     pool_->cond.notify_one();
+    return true;
+  }
+
+  // 返回任务队列中等待执行的任务数
+  size_t TaskCount() {
+    std::lock_guard<std::mutex> locker(pool_->mtx);
+    return pool_->tasks[kHigh].size() + pool_->tasks[kLow].size();
+  }
+
+  // 队列中是否有等待执行的任务，不加锁，结果可能稍有滞后
+  // 队列为空时新任务会被马上取走，用于判断是否值得为排队做额外的工作（如区分任务的优先级）
+  bool HasBacklog() const {
+    return pool_->queued.load(std::memory_order_relaxed) > 0;
   }
 
  private:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  enum : int {
+    kCodelTargetUs = 5000,     // 可以接受的排队时间
+    kCodelIntervalUs = 100000, // 判断是否过载的间隔
+    kLowShare = 4,             // 两个队列都有任务时，每这么多次至少取一次低优先级任务，避免饿死
+  };
+
+  struct Task {
+    std::function<void()> func;                       // 任务函数
+    std::function<void()> shed;                       // 拒绝任务时执行的函数，为空时任务不会被拒绝
+    std::chrono::steady_clock::time_point enqueued_at; // 放入队列的时刻
+  };
+
+  // CoDel（Controlled Delay）：看排队时间而不是队列长度。每个间隔内最小的排队时间都超过目标值，
+  // 说明队列一直没有排空，是持续的过载而不是短暂的突发，此时拒绝排队超过两倍目标值的任务，把排队时间压回目标值附近
+  // TCP中的CoDel逐渐加快丢包的频率，等发送方退让；HTTP客户端收到503后往往立即重试，这里采用RPC服务器中常用的做法，
+  // 过载期间超时的任务一律拒绝
+  struct Codel {
+    TimePoint interval_end;  // 当前间隔的结束时刻，还没有开始过间隔时为零
+    std::chrono::steady_clock::duration min_delay = std::chrono::steady_clock::duration::zero(); // 当前间隔内最小的排队时间
+    bool is_overloaded = false;  // 上一个间隔是否过载
+
+    // 任务出队时调用，返回是否拒绝这个任务
+    // 每个间隔都由一次出队开始，min_delay总是来自实际的样本，只有有样本的间隔才能得出过载的结论
+    bool ShouldDrop(TimePoint now, TimePoint enqueued_at) {
+      std::chrono::steady_clock::duration delay = now - enqueued_at;
+      std::chrono::microseconds interval(kCodelIntervalUs);
+      if (interval_end == TimePoint() || now >= interval_end + interval) {
+        // 第一次出队，或队列空闲超过一个间隔：中间的间隔没有样本，不能说明过载，从这次出队重新开始计时
+        is_overloaded = false;
+        min_delay = delay;
+        interval_end = now + interval;
+      } else if (now >= interval_end) {
+        is_overloaded = min_delay > std::chrono::microseconds(kCodelTargetUs);
+        min_delay = delay;
+        interval_end = now + interval;
+      } else if (delay < min_delay) {
+        min_delay = delay;
+      }
+      return is_overloaded && delay > std::chrono::microseconds(2 * kCodelTargetUs);
+    }
+  };
+
   struct Pool {
     std::mutex mtx;                          // 互斥锁
     std::condition_variable cond;            // 条件变量，信号量
     bool is_closed = false;                  // 标识线程池是否关闭
-    std::queue<std::function<void()>> tasks; // 任务线程的队列
+    size_t max_tasks = 0;                    // TryAddTask时每个队列的最大长度
+    std::queue<Task> tasks[kPriorityNum];    // 各优先级的任务队列
+    Codel codel[kPriorityNum];               // 各优先级队列的排队时间控制
+    uint32_t picks = 0;                      // 两个队列都有任务时的取任务次数
+    std::atomic<size_t> queued{0};           // 两个队列中的任务总数，持有锁时修改，HasBacklog不加锁读取
+
+    // 持有锁时调用，取出下一个任务，is_shed为是否应拒绝它；两个队列都为空时返回false
+    bool Take(Task *task, bool *is_shed) {
+      int priority = kHigh;
+      if (tasks[kHigh].empty() || (!tasks[kLow].empty() && ++picks % kLowShare == 0)) {
+        priority = kLow;
+      }
+      std::queue<Task> &queue = tasks[priority];
+      if (queue.empty()) {
+        return false;
+      }
+      *task = std::move(queue.front());
+      queue.pop();
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      // 不可拒绝的任务也计入排队时间的统计，但不会被拒绝
+      *is_shed = codel[priority].ShouldDrop(std::chrono::steady_clock::now(), task->enqueued_at)
+          && static_cast<bool>(task->shed);
+      return true;
+    }
   };
 
   std::shared_ptr<Pool> pool_; // 任务队列的共享资源智能指针
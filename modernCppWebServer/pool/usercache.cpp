@@ -0,0 +1,106 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "usercache.h"
+
+const int UserCache::kShardNum;
+
+UserCache::UserCache() : shard_capacity_(0), ttl_(0), negative_ttl_(0), hits_(0), misses_(0) {
+}
+
+// 创建静态对象，单例模式获取对象的方法
+UserCache *UserCache::Instance() {
+  static UserCache user_cache;
+  return &user_cache;
+}
+
+// 设置容量和有效期，容量按分片均分，每个分片至少一个条目
+void UserCache::Init(size_t capacity, int ttl_ms, int negative_ttl_ms) {
+  shard_capacity_ = capacity == 0 ? 0 : (capacity + kShardNum - 1) / kShardNum;
+  ttl_ = std::chrono::milliseconds(ttl_ms);
+  negative_ttl_ = std::chrono::milliseconds(negative_ttl_ms);
+}
+
+// 查找用户，命中时把条目移到表头，过期的条目直接删除并按未命中处理
+UserCache::Result UserCache::Get(const std::string &name, std::string *passwd) {
+  if (shard_capacity_ == 0) {
+    return kMiss;
+  }
+  Shard &shard = ShardOf_(name);
+  std::lock_guard<std::mutex> locker(shard.mtx);
+  auto it = shard.index.find(name);
+  if (it == shard.index.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return kMiss;
+  }
+  if (it->second->expires <= Clock::now()) {
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return kMiss;
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  if (it->second->is_absent) {
+    return kAbsent;
+  }
+  *passwd = it->second->passwd;
+  return kFound;
+}
+
+void UserCache::Put(const std::string &name, const std::string &passwd) {
+  Insert_(name, passwd, false);
+}
+
+void UserCache::PutAbsent(const std::string &name) {
+  Insert_(name, std::string(), true);
+}
+
+void UserCache::Erase(const std::string &name) {
+  if (shard_capacity_ == 0) {
+    return;
+  }
+  Shard &shard = ShardOf_(name);
+  std::lock_guard<std::mutex> locker(shard.mtx);
+  auto it = shard.index.find(name);
+  if (it != shard.index.end()) {
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+  }
+}
+
+// 插入或更新一个条目并移到表头，超过分片容量时淘汰表尾（最久未使用）的条目
+void UserCache::Insert_(const std::string &name, const std::string &passwd, bool is_absent) {
+  if (shard_capacity_ == 0) {
+    return;
+  }
+  Clock::time_point expires = Clock::now() + (is_absent ? negative_ttl_ : ttl_);
+  Shard &shard = ShardOf_(name);
+  std::lock_guard<std::mutex> locker(shard.mtx);
+  auto it = shard.index.find(name);
+  if (it != shard.index.end()) {
+    Entry &entry = *it->second;
+    entry.passwd = passwd;
+    entry.is_absent = is_absent;
+    entry.expires = expires;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return;
+  }
+  if (shard.lru.size() >= shard_capacity_) {
+    shard.index.erase(shard.lru.back().name);
+    shard.lru.pop_back();
+  }
+  shard.lru.push_front(Entry{name, passwd, is_absent, expires});
+  shard.index[name] = shard.lru.begin();
+}
+
+// 当前缓存的条目数，逐个分片加锁求和
+size_t UserCache::Size() {
+  size_t size = 0;
+  for (Shard &shard : shards_) {
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    size += shard.lru.size();
+  }
+  return size;
+}
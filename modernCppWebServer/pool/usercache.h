@@ -0,0 +1,89 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_USERCACHE_H_
+#define MODERNCPPWEBSERVER_POOL_USERCACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// 数据库前的用户记录缓存，按用户名分片，每个分片一把锁、一条LRU链表，条目带过期时间
+// 既缓存存在的用户（用户名->密码），也缓存查不到的用户名（负缓存），重复登录和重复查询都不再访问数据库
+// 注册成功后直接写入（write-through），注册失败时删除，负缓存的有效期比正缓存短，
+// 以免其他服务器进程注册的用户在本进程中长时间查不到
+// 容量为0（未调用Init）时不缓存任何内容，Get总是返回kMiss
+class UserCache {
+ public:
+  enum Result {
+    kMiss = 0,  // 缓存中没有或已过期，需要查询数据库
+    kFound,     // 用户存在，passwd为其密码
+    kAbsent,    // 用户不存在（负缓存）
+  };
+
+  // 创建静态对象，单例模式获取对象的方法
+  static UserCache *Instance();
+
+  // 设置总容量（条目数）和正、负缓存的有效期，需在服务器启动前调用
+  void Init(size_t capacity, int ttl_ms, int negative_ttl_ms);
+
+  // 查找用户，命中且用户存在时把密码写入passwd
+  Result Get(const std::string &name, std::string *passwd);
+  // 记录存在的用户
+  void Put(const std::string &name, const std::string &passwd);
+  // 记录不存在的用户名
+  void PutAbsent(const std::string &name);
+  // 删除一个用户名的缓存，用于结果不确定的情况（如注册失败）
+  void Erase(const std::string &name);
+
+  // 当前缓存的条目数
+  size_t Size();
+  uint64_t Hits() const {
+    return hits_.load(std::memory_order_relaxed);
+  }
+  uint64_t Misses() const {
+    return misses_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  UserCache();
+  ~UserCache() = default;
+
+  struct Entry {
+    std::string name;
+    std::string passwd;
+    bool is_absent;
+    Clock::time_point expires;
+  };
+
+  // 每个分片按缓存行对齐，不同分片的锁不会发生伪共享
+  struct alignas(64) Shard {
+    std::mutex mtx;
+    std::list<Entry> lru;  // 表头为最近使用的条目
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  };
+
+  Shard &ShardOf_(const std::string &name) {
+    return shards_[std::hash<std::string>()(name) % kShardNum];
+  }
+  // 插入或更新一个条目并移到表头，超过分片容量时淘汰表尾
+  void Insert_(const std::string &name, const std::string &passwd, bool is_absent);
+
+  static const int kShardNum = 16;
+
+  Shard shards_[kShardNum];
+  size_t shard_capacity_;
+  Clock::duration ttl_;
+  Clock::duration negative_ttl_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_USERCACHE_H_
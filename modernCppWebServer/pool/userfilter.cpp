@@ -0,0 +1,127 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "userfilter.h"
+
+#include <cstdlib>
+
+const int UserFilter::kLoadBatch;
+
+UserFilter::UserFilter() : is_ready_(false), is_stop_(false), loaded_count_(0), skipped_selects_(0) {
+}
+
+UserFilter::~UserFilter() {
+  Close();
+}
+
+// 创建静态对象，单例模式获取对象的方法
+UserFilter *UserFilter::Instance() {
+  static UserFilter user_filter;
+  return &user_filter;
+}
+
+void UserFilter::Init(size_t expected_users, double false_positive_rate) {
+  filter_.Init(expected_users, false_positive_rate);
+  LOG_INFO("UserFilter: %zu counters, %d hashes", filter_.CounterCount(), filter_.HashCount());
+  loader_ = std::thread(&UserFilter::Load_, this);
+}
+
+void UserFilter::Close() {
+  is_stop_ = true;
+  if (loader_.joinable()) {
+    loader_.join();
+  }
+}
+
+bool UserFilter::MayExist(const char *name, size_t len) {
+  if (!IsReady() || filter_.MayContain(name, len)) {
+    return true;
+  }
+  skipped_selects_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+// 加载线程，每批单独取一个连接，批与批之间把连接还给请求使用
+void UserFilter::Load_() {
+  std::string last;
+  bool is_checked = false;
+  while (!is_stop_) {
+    MYSQL *sql;
+    SqlConnRAII tmp(&sql, SqlConnPool::Instance());
+    if (sql == nullptr) {
+      // 连接池取连接有超时，数据库暂时不可用时稍后重试，加载完成前注册总是查询数据库
+      LOG_WARN("UserFilter: no sql connection, retry later");
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      continue;
+    }
+    if (!is_checked) {
+      int has_unique_key = HasUniqueKey_(sql);
+      if (has_unique_key < 0) {
+        LOG_ERROR("UserFilter index check error: %s", mysql_error(sql));
+        return;
+      }
+      if (has_unique_key == 0) {
+        LOG_ERROR("UserFilter: user.username has no UNIQUE index, registration will always SELECT first");
+        return;
+      }
+      is_checked = true;
+    }
+    int rows = LoadBatch_(sql, last);
+    if (rows < 0) {
+      LOG_ERROR("UserFilter load error: %s", mysql_error(sql));
+      return;
+    }
+    loaded_count_.fetch_add(rows, std::memory_order_relaxed);
+    if (rows < kLoadBatch) {
+      is_ready_.store(true, std::memory_order_release);
+      LOG_INFO("UserFilter: loaded %llu users", static_cast<unsigned long long>(LoadedCount()));
+      return;
+    }
+  }
+}
+
+// 按用户名做键集分页（username > last ORDER BY username），不像OFFSET那样越往后越慢
+int UserFilter::LoadBatch_(MYSQL *sql, std::string &last) {
+  std::string escaped(last.size() * 2 + 1, '\0');
+  escaped.resize(mysql_real_escape_string(sql, &escaped[0], last.data(), last.size()));
+  std::string order = "SELECT username FROM user WHERE username > '" + escaped
+      + "' ORDER BY username LIMIT " + std::to_string(kLoadBatch);
+  if (mysql_real_query(sql, order.data(), order.size()) != 0) {
+    return -1;
+  }
+  MYSQL_RES *res = mysql_store_result(sql);
+  if (res == nullptr) {
+    return -1;
+  }
+  int rows = 0;
+  while (MYSQL_ROW row = mysql_fetch_row(res)) {
+    unsigned long *lengths = mysql_fetch_lengths(res);
+    filter_.Add(row[0], lengths[0]);
+    last.assign(row[0], lengths[0]);
+    ++rows;
+  }
+  mysql_free_result(res);
+  return rows;
+}
+
+// 找username是第一列且没有第二列的唯一索引，前缀索引比整列更严格，同样可以
+int UserFilter::HasUniqueKey_(MYSQL *sql) {
+  const char order[] =
+      "SELECT COUNT(*) FROM information_schema.STATISTICS s"
+      " WHERE s.TABLE_SCHEMA = DATABASE() AND s.TABLE_NAME = 'user' AND s.COLUMN_NAME = 'username'"
+      " AND s.NON_UNIQUE = 0 AND s.SEQ_IN_INDEX = 1 AND NOT EXISTS (SELECT 1 FROM information_schema.STATISTICS t"
+      " WHERE t.TABLE_SCHEMA = s.TABLE_SCHEMA AND t.TABLE_NAME = s.TABLE_NAME AND t.INDEX_NAME = s.INDEX_NAME"
+      " AND t.SEQ_IN_INDEX = 2)";
+  if (mysql_real_query(sql, order, sizeof(order) - 1) != 0) {
+    return -1;
+  }
+  MYSQL_RES *res = mysql_store_result(sql);
+  if (res == nullptr) {
+    return -1;
+  }
+  MYSQL_ROW row = mysql_fetch_row(res);
+  int count = row != nullptr && row[0] != nullptr ? atoi(row[0]) : -1;
+  mysql_free_result(res);
+  return count > 0 ? 1 : count;
+}
@@ -0,0 +1,73 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_USERFILTER_H_
+#define MODERNCPPWEBSERVER_POOL_USERFILTER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "bloomfilter.h"
+#include "sqlconnpool.h"
+#include "sqlconnRAII.h"
+
+// 已存在用户名的计数布隆过滤器，用于注册时判断用户名是否可用
+// 启动时由后台线程按用户名顺序分批读入user表，每批之间归还数据库连接，服务器不必等待加载完成；
+// 注册成功的用户名随时加入。加载完成后，过滤器判断为不存在的用户名一定不存在，注册时可以跳过SELECT直接插入
+// 跳过SELECT后用户名是否重复由数据库判断，要求user.username上有只含这一列的唯一索引（见TinyWebServer-master/README.md中的建表语句）：
+// 用户名按列的排序规则比较（默认不区分大小写、忽略末尾空格），而过滤器比较的是原始字节，
+// "Alice"不在过滤器中时"alice"可能已经存在，只有唯一索引能让这样的插入失败
+// 加载前先检查索引，没有唯一索引时不加载，注册总是先查询
+// 加载未完成、加载失败或没有唯一索引时不能据此判断，MayExist总是返回true
+class UserFilter {
+ public:
+  // 创建静态对象，单例模式获取对象的方法
+  static UserFilter *Instance();
+
+  // 按预计用户数和误判率初始化过滤器，并启动加载线程，需在数据库连接池初始化之后调用
+  void Init(size_t expected_users, double false_positive_rate);
+  // 停止加载线程，需在关闭数据库连接池之前调用
+  void Close();
+
+  bool IsReady() const {
+    return is_ready_.load(std::memory_order_acquire);
+  }
+  // 用户名可能已存在时返回true，加载完成且一定不存在时返回false并记一次跳过的查询
+  bool MayExist(const char *name, size_t len);
+  // 加入一个已存在的用户名（注册成功或插入时发现已存在）
+  void Add(const char *name, size_t len) {
+    filter_.Add(name, len);
+  }
+
+  uint64_t LoadedCount() const {
+    return loaded_count_.load(std::memory_order_relaxed);
+  }
+  uint64_t SkippedSelects() const {
+    return skipped_selects_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  UserFilter();
+  ~UserFilter();
+
+  // 加载线程：按用户名顺序分批读取，每批最多kLoadBatch行
+  void Load_();
+  // 读取用户名大于last的一批，返回读到的行数，出错返回-1
+  int LoadBatch_(MYSQL *sql, std::string &last);
+  // user.username上是否有只含这一列的唯一索引，出错返回-1
+  static int HasUniqueKey_(MYSQL *sql);
+
+  static const int kLoadBatch = 1000;
+
+  CountingBloomFilter filter_;
+  std::thread loader_;
+  std::atomic<bool> is_ready_;
+  std::atomic<bool> is_stop_;
+  std::atomic<uint64_t> loaded_count_;
+  std::atomic<uint64_t> skipped_selects_;
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_USERFILTER_H_
@@ -0,0 +1,7 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "userstore.h"
+
+UserStore *UserStore::instance_ = nullptr;
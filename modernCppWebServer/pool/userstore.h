@@ -0,0 +1,47 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_POOL_USERSTORE_H_
+#define MODERNCPPWEBSERVER_POOL_USERSTORE_H_
+
+#include <cstddef>
+#include <string>
+
+// 用户存储的接口，登录/注册验证（HttpRequest::UserVerify）只通过它查询和插入用户
+// 后端有MySQL（MySqlUserStore，需要编译时定义USE_MYSQL）和本地追加日志文件（LocalUserStore）两种，
+// 启动时由WebServer选定一个，之后只读，不需要加锁；用户缓存仍在后端之前
+class UserStore {
+ public:
+  enum Status {
+    kOk = 0,      // 查询时用户存在，插入时插入成功
+    kNotFound,    // 用户不存在
+    kError,       // 出错，插入时也包括用户名已存在
+    kUnavailable, // 后端暂时不可用（如取不到数据库连接），调用者应返回503
+  };
+
+  virtual ~UserStore() = default;
+
+  // 查询用户的密码，存在时写入passwd
+  virtual Status Query(const char *name, std::string *passwd) = 0;
+  // 插入新用户
+  virtual Status Insert(const char *name, const char *pwd) = 0;
+  // 注册前判断用户名是否可能已存在，返回false时可以跳过查询直接插入
+  virtual bool MayExist(const char * /*name*/, size_t /*len*/) {
+    return true;
+  }
+
+  // 返回当前使用的后端，未设置时为空指针
+  static UserStore *Instance() {
+    return instance_;
+  }
+  // 设置使用的后端，需在服务器启动前调用
+  static void SetInstance(UserStore *store) {
+    instance_ = store;
+  }
+
+ private:
+  static UserStore *instance_;
+};
+
+#endif //MODERNCPPWEBSERVER_POOL_USERSTORE_H_
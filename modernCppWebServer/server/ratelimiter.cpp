@@ -0,0 +1,134 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#include "ratelimiter.h"
+
+#include <sys/mman.h>
+#include <time.h>
+
+#include <algorithm>
+
+const int RateLimiter::kWays;
+const int RateLimiter::kShardNum;
+
+namespace {
+
+// 补充令牌时最多按这么长的空闲时间计算，避免乘法溢出，桶在这之前早已补满
+const uint32_t kMaxRefillMs = 3600 * 1000;
+
+int64_t MonotonicMs() {
+  // 粗粒度时钟只读vDSO中的值，精度为一个时钟节拍（几毫秒），对限速足够
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+} // namespace
+
+RateLimiter::RateLimiter() : sets_(nullptr), set_num_(0), base_ms_(0), evictions_(0), rejects_(0) {
+}
+
+RateLimiter::~RateLimiter() {
+  if (sets_ != nullptr) {
+    munmap(sets_, set_num_ * sizeof(Set));
+  }
+}
+
+// 创建静态对象，单例模式获取对象的方法
+RateLimiter *RateLimiter::Instance() {
+  static RateLimiter rate_limiter;
+  return &rate_limiter;
+}
+
+// 组数取2的幂，用掩码求组号；匿名映射的页在第一次写入时才分配，并且已经清零（全部为空条目）
+bool RateLimiter::Init(size_t capacity, const std::vector<Rule> &rules) {
+  if (sets_ != nullptr || capacity == 0 || rules.empty() || rules.size() > 255) {
+    return false;
+  }
+  size_t set_num = 1;
+  while (set_num * kWays < capacity) {
+    set_num <<= 1;
+  }
+  void *mem = mmap(nullptr, set_num * sizeof(Set), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return false;
+  }
+  // 表很大且随机访问，用透明大页减少TLB缺失；不支持时忽略
+  madvise(mem, set_num * sizeof(Set), MADV_HUGEPAGE);
+  sets_ = static_cast<Set *>(mem);
+  set_num_ = set_num;
+  rules_ = rules;
+  base_ms_ = MonotonicMs();
+  return true;
+}
+
+uint32_t RateLimiter::NowMs_() const {
+  return static_cast<uint32_t>(MonotonicMs() - base_ms_);
+}
+
+bool RateLimiter::Take_(Entry &entry, const Rule &rule, uint32_t now_ms) {
+  uint32_t elapsed = std::min(now_ms - entry.stamp_ms, kMaxRefillMs);
+  entry.stamp_ms = now_ms;
+  // 每秒rate个令牌，即每毫秒rate个千分之一令牌
+  int64_t tokens = std::min<int64_t>(entry.tokens + static_cast<int64_t>(elapsed) * rule.rate,
+                                     static_cast<int64_t>(rule.burst) * 1000);
+  if (tokens < 1000) {
+    entry.tokens = static_cast<int32_t>(tokens);
+    return false;
+  }
+  entry.tokens = static_cast<int32_t>(tokens - 1000);
+  return true;
+}
+
+// 在键所在的组中查找；找不到时占用一个空条目，组满时用CLOCK选出被替换的条目，新条目的桶是满的
+bool RateLimiter::Allow(uint32_t ip, int route) {
+  if (set_num_ == 0 || route < 0 || route >= static_cast<int>(rules_.size())) {
+    return true;
+  }
+  const Rule &rule = rules_[route];
+  const uint8_t tag = static_cast<uint8_t>(route + 1);
+  uint64_t hash = ((static_cast<uint64_t>(ip) << 8) | tag) * 0x9E3779B97F4A7C15ULL;
+  size_t index = (hash >> 32) & (set_num_ - 1);
+  Set &set = sets_[index];
+  uint32_t now_ms = NowMs_();
+
+  std::lock_guard<std::mutex> locker(shards_[index % kShardNum].mtx);
+  Entry *victim = nullptr;
+  for (Entry &entry : set.entries) {
+    if (entry.route == tag && entry.ip == ip) {
+      entry.ref = 1;
+      if (Take_(entry, rule, now_ms)) {
+        return true;
+      }
+      rejects_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (entry.route == 0 && victim == nullptr) {
+      victim = &entry;
+    }
+  }
+  uint8_t hand = set.entries[0].hand;
+  if (victim == nullptr) {
+    // 最多转一圈半：第一圈把访问位都清零时，第二圈一定能找到
+    while (set.entries[hand].ref != 0) {
+      set.entries[hand].ref = 0;
+      hand = (hand + 1) % kWays;
+    }
+    victim = &set.entries[hand];
+    hand = (hand + 1) % kWays;
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // 新条目的访问位为0，只出现一次的IP（如扫描）先被淘汰，不会挤掉反复出现的客户端
+  victim->ip = ip;
+  victim->route = tag;
+  victim->ref = 0;
+  victim->stamp_ms = now_ms;
+  victim->tokens = static_cast<int32_t>(rule.burst) * 1000;
+  set.entries[0].hand = hand;
+  if (Take_(*victim, rule, now_ms)) {
+    return true;
+  }
+  rejects_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
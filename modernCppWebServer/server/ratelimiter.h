@@ -0,0 +1,87 @@
+//
+// Created by lhm on 2026/10/19.
+//
+
+#ifndef MODERNCPPWEBSERVER_SERVER_RATELIMITER_H_
+#define MODERNCPPWEBSERVER_SERVER_RATELIMITER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// 按客户端IP限速，每个(IP, 路由类别)一个令牌桶，不同类别（如普通请求和登录）的速率和突发量分别设置
+// 表的大小在Init时固定，用mmap分配，内存在第一次写入时才占用：每个条目16字节，100万个条目约16MB
+// 表为4路组相联，每组正好一个缓存行，一个键只可能在它所在的组里，查找最多比较4个条目；
+// 组满时用CLOCK算法淘汰：每个条目有一个访问位，指针在组内转动，访问位为1的清零后跳过，为0的被替换
+// 被淘汰的IP再出现时令牌桶是满的，所以表太小只会让限速变宽松，不会误伤正常客户端
+// 组按下标分片加锁，主线程调用时各分片的锁都不会有竞争
+// 容量为0（未调用Init）时不限速，Allow总是返回true
+class RateLimiter {
+ public:
+  // 一个路由类别的令牌桶参数
+  struct Rule {
+    uint32_t rate;   // 每秒补充的令牌数
+    uint32_t burst;  // 桶的容量，即允许的突发请求数，不超过200万
+  };
+
+  // 创建静态对象，单例模式获取对象的方法
+  static RateLimiter *Instance();
+
+  // 设置条目数（向上取整到4的倍数）和各类别的规则（下标为类别），需在服务器启动前调用
+  bool Init(size_t capacity, const std::vector<Rule> &rules);
+
+  // 从ip（网络字节序）的route类别的桶中取一个令牌，桶空时返回false
+  bool Allow(uint32_t ip, int route);
+
+  // 因组满而被淘汰的条目数
+  uint64_t Evictions() const {
+    return evictions_.load(std::memory_order_relaxed);
+  }
+  // 被拒绝的请求数
+  uint64_t Rejects() const {
+    return rejects_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  RateLimiter();
+  ~RateLimiter();
+
+  // 一个令牌桶，令牌以千分之一为单位，补充时不丢失不足一个令牌的部分
+  struct Entry {
+    uint32_t ip;
+    uint8_t route;     // 类别加1，0表示空条目
+    uint8_t ref;       // CLOCK的访问位
+    uint8_t hand;      // 组内CLOCK指针，只用组内第一个条目的这个字段
+    uint8_t pad;
+    uint32_t stamp_ms; // 上次补充令牌的时刻（相对于Init），回绕后两次相减仍然正确
+    int32_t tokens;    // 剩余的千分之一令牌数
+  };
+
+  static const int kWays = 4;  // 每组的条目数，4个16字节的条目正好一个缓存行
+
+  struct alignas(64) Set {
+    Entry entries[kWays];
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mtx;
+  };
+
+  // 补充令牌并尝试取一个
+  bool Take_(Entry &entry, const Rule &rule, uint32_t now_ms);
+  uint32_t NowMs_() const;
+
+  static const int kShardNum = 64;
+
+  Set *sets_;
+  size_t set_num_;
+  std::vector<Rule> rules_;
+  int64_t base_ms_;  // Init时的单调时钟，条目中的时刻都相对于它
+  Shard shards_[kShardNum];
+  std::atomic<uint64_t> evictions_;
+  std::atomic<uint64_t> rejects_;
+};
+
+#endif //MODERNCPPWEBSERVER_SERVER_RATELIMITER_H_
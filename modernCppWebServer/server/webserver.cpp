@@ -3,20 +3,64 @@
 //
 
 #include "webserver.h"
+
+#include <sys/resource.h>
+
+namespace {
+
+// 过载时的响应预先生成，拒绝时只需一次send，不解析请求、不分配缓冲区
+const char kBusyResponse[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                             "Retry-After: 1\r\n"
+                             "Content-type: text/plain\r\n"
+                             "Content-length: 12\r\n"
+                             "Connection: close\r\n"
+                             "\r\n"
+                             "Server busy\n";
+
+// 超过客户端IP的限速时的响应
+const char kRateLimitedResponse[] = "HTTP/1.1 429 Too Many Requests\r\n"
+                                    "Retry-After: 1\r\n"
+                                    "Content-type: text/plain\r\n"
+                                    "Content-length: 18\r\n"
+                                    "Connection: close\r\n"
+                                    "\r\n"
+                                    "Too many requests\n";
+
+} // namespace
+
+const int WebServer::kLatencySummaryMs;
+const int WebServer::kMaxFd;
+const int WebServer::kReservedFd;
+const int WebServer::kConnMemoryBytes;
+const int WebServer::kMaxQueuedRequests;
+const int WebServer::kShedDrainReads;
+const int WebServer::kRateLimitEntries;
+
 WebServer::WebServer(int port, int trig_mode, int timeout_ms, bool opt_linger,
                      int sql_port, const char *sql_user, const char *sql_pwd,
                      const char *db_name, int conn_pool_num, int thread_num,
-                     bool open_log, int log_level, int log_que_size)
-    : port_(port), open_linger_(opt_linger), timeout_ms_(timeout_ms), is_close_(false),
-      timer_(new HeapTimer()), thread_pool_(new ThreadPool(thread_num)), epoller_(new Epoller) {
+                     bool open_log, int log_level, int log_que_size,
+                     int access_log_sample, bool open_metrics, bool async_sql,
+                     const char *user_log, bool rate_limit)
+    : port_(port), open_linger_(opt_linger), timeout_ms_(timeout_ms), is_close_(false), open_metrics_(open_metrics),
+      rate_limit_(rate_limit),
+      timer_(new HeapTimer()), thread_pool_(new ThreadPool(thread_num, kMaxQueuedRequests)), epoller_(new Epoller) {
   src_dir_ = getcwd(nullptr, 256);
   assert(src_dir_);
   strncat(src_dir_, "/resources", 16);
   HttpConn::user_count = 0;
   HttpConn::src_dir = src_dir_;
-  SqlConnPool::Instance()->Init("localhost", sql_port, sql_user,
-                                sql_pwd, db_name, conn_pool_num);
+  HttpConn::open_metrics = open_metrics;
+  UserCache::Instance()->Init(kUserCacheCapacity, kUserCacheTtlMs, kUserCacheNegativeTtlMs);
+  SessionStore::Instance()->Init(kSessionTtlSec, kSessionCapacity);
+  if (rate_limit_) {
+    // 下标与RateLimitRoute一致
+    rate_limit_ = RateLimiter::Instance()->Init(kRateLimitEntries, {{kRequestRate, kRequestBurst},
+                                                                    {kLoginRate, kLoginBurst}});
+  }
 
+  InitFdLimit_();
+  InitMemoryLimit_();
   InitEventMode_(trig_mode);
   if (!InitSocket_()) {
     is_close_ = true;
@@ -34,16 +78,112 @@ WebServer::WebServer(int port, int trig_mode, int timeout_ms, bool opt_linger,
                (conn_event_ & EPOLLET ? "ET" : "LT"));
       LOG_INFO("LogSys level: %d", log_level);
       LOG_INFO("srcDir: %s", HttpConn::src_dir);
-      LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", conn_pool_num, thread_num);
+      LOG_INFO("ThreadPool num: %d", thread_num);
+      LOG_INFO("Max connections: %d, buffer limit: %zuMB, queued requests: %d per priority",
+               max_conn_, max_buffer_bytes_ >> 20, kMaxQueuedRequests);
+      if (rate_limit_) {
+        LOG_INFO("Rate limit per IP: %d/s burst %d, login %d/s burst %d",
+                 kRequestRate, kRequestBurst, kLoginRate, kLoginBurst);
+      } else {
+        LOG_INFO("Rate limit per IP: off");
+      }
     }
   }
+  // 用户存储在日志初始化之后建立，连接失败能记录到日志
+  InitUserStore_(sql_port, sql_user, sql_pwd, db_name, conn_pool_num, user_log, async_sql);
+  if (access_log_sample > 0) {
+    // 访问日志独立于普通日志，按1/access_log_sample采样
+    AccessLog::Instance()->Init("./log", access_log_sample);
+    LOG_INFO("AccessLog sample: 1/%d", access_log_sample);
+  }
+  if (open_metrics) {
+    InitMetrics_();
+  }
 }
 
 WebServer::~WebServer() {
   close(listen_fd_);
   is_close_ = true;
   free(src_dir_);
+#ifdef USE_MYSQL
+  InsertBatcher::Instance()->Close();
+  SqlAsync::Instance()->Close();
+  UserFilter::Instance()->Close();
   SqlConnPool::Instance()->ClosePool();
+#endif
+  LocalUserStore::Instance()->Close();
+}
+
+// 选择用户存储后端：指定了本地日志文件（或编译时没有启用MySQL）时使用本地存储，
+// 否则使用MySQL，同时建立连接池、布隆过滤器、组提交和异步验证
+void WebServer::InitUserStore_(int sql_port, const char *sql_user, const char *sql_pwd, const char *db_name,
+                               int conn_pool_num, const char *user_log, bool async_sql) {
+#ifdef USE_MYSQL
+  if (user_log == nullptr) {
+    // 连接数在conn_pool_num和其kSqlPoolGrowFactor倍之间伸缩
+    LOG_INFO("UserStore: MySQL %s@localhost:%d/%s, SqlConnPool num: %d-%d", sql_user, sql_port, db_name,
+             conn_pool_num, conn_pool_num * kSqlPoolGrowFactor);
+    SqlConnPool::Instance()->Init("localhost", sql_port, sql_user, sql_pwd, db_name,
+                                  conn_pool_num, conn_pool_num * kSqlPoolGrowFactor, kSqlWaitTimeoutMs);
+    // 布隆过滤器在后台加载，需在日志初始化之后启动
+    UserFilter::Instance()->Init(kUserFilterCapacity, 0.01);
+    InsertBatcher::Instance()->Init(kInsertBatchRows, kInsertBatchDelayMs);
+    if (async_sql && !is_close_) {
+      // 登录/注册的数据库往返改为在主线程的事件循环中异步执行，初始化失败时仍使用同步验证
+      HttpRequest::async_verify = SqlAsync::Instance()->Init(epoller_.get(), kSqlWaitTimeoutMs, kSqlQueryTimeoutMs);
+      LOG_INFO("Async sql verify: %s", HttpRequest::async_verify ? "on" : "off");
+    }
+    UserStore::SetInstance(MySqlUserStore::Instance());
+    return;
+  }
+#else
+  if (user_log == nullptr) {
+    user_log = kDefaultUserLog;
+  }
+#endif
+  LOG_INFO("UserStore: local log %s", user_log);
+  if (!LocalUserStore::Instance()->Open(user_log)) {
+    is_close_ = true;
+  }
+  UserStore::SetInstance(LocalUserStore::Instance());
+}
+
+// 默认的软限制通常只有1024，C100K需要先提高；硬限制由系统管理员设置（ulimit -Hn、systemd的LimitNOFILE）
+void WebServer::InitFdLimit_() {
+  struct rlimit limit;
+  max_conn_ = kMaxFd;
+  if (getrlimit(RLIMIT_NOFILE, &limit) < 0) {
+    return;
+  }
+  if (limit.rlim_cur < limit.rlim_max) {
+    rlim_t old_cur = limit.rlim_cur;
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) < 0) {
+      limit.rlim_cur = old_cur;
+    }
+  }
+  if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < static_cast<rlim_t>(kMaxFd + kReservedFd)) {
+    max_conn_ = std::max(static_cast<int>(limit.rlim_cur) - kReservedFd, 1);
+  }
+}
+
+// 内存上限取物理内存和cgroup v2的memory.max中较小的一个，一半留给连接，其中一半可以用作缓冲区
+// 连接数超过内存能支撑的数量时，与其让整个进程被OOM杀掉，不如回复503拒绝新连接
+void WebServer::InitMemoryLimit_() {
+  uint64_t memory = static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+  FILE *fp = fopen("/sys/fs/cgroup/memory.max", "r");
+  if (fp != nullptr) {
+    unsigned long long cgroup_max;
+    if (fscanf(fp, "%llu", &cgroup_max) == 1 && cgroup_max < memory) {
+      memory = cgroup_max;
+    }
+    fclose(fp);
+  }
+  uint64_t conn_memory = memory / 2;
+  if (conn_memory / kConnMemoryBytes < static_cast<uint64_t>(max_conn_)) {
+    max_conn_ = std::max<int>(conn_memory / kConnMemoryBytes, 1);
+  }
+  max_buffer_bytes_ = conn_memory / 2;
 }
 
 void WebServer::InitEventMode_(int trig_mode) {
@@ -65,22 +205,115 @@ void WebServer::InitEventMode_(int trig_mode) {
   HttpConn::isET = (conn_event_ & EPOLLET);
 }
 
+// 注册抓取时才求值的统计项，计数器本身由各模块直接累加
+void WebServer::InitMetrics_() {
+  Metrics *metrics = Metrics::Instance();
+  ThreadPool *thread_pool = thread_pool_.get();
+  metrics->RegisterGauge("webserver_threadpool_queue_depth", "Tasks waiting in the thread pool queue.",
+                         [thread_pool] { return static_cast<double>(thread_pool->TaskCount()); });
+  metrics->RegisterGauge("webserver_access_log_dropped_total", "Access log records dropped because the ring was full.",
+                         [] { return static_cast<double>(AccessLog::Instance()->Dropped()); }, true);
+  metrics->RegisterGauge("webserver_buffer_pool_in_use_bytes", "Buffer memory lent out to connections.",
+                         [] { return static_cast<double>(BufferPool::Instance()->InUseBytes()); });
+  metrics->RegisterGauge("webserver_buffer_pool_cached_bytes", "Idle buffer memory cached in the pool.",
+                         [] { return static_cast<double>(BufferPool::Instance()->CachedBytes()); });
+  metrics->RegisterGauge("webserver_sessions", "Live login sessions.",
+                         [] { return static_cast<double>(SessionStore::Instance()->Size()); });
+  metrics->RegisterGauge("webserver_session_hits_total", "Logins confirmed by a session cookie without the database.",
+                         [] { return static_cast<double>(SessionStore::Instance()->Hits()); }, true);
+  metrics->RegisterGauge("webserver_user_cache_hits_total", "User lookups answered by the user cache.",
+                         [] { return static_cast<double>(UserCache::Instance()->Hits()); }, true);
+  metrics->RegisterGauge("webserver_user_cache_misses_total", "User lookups that went to the database.",
+                         [] { return static_cast<double>(UserCache::Instance()->Misses()); }, true);
+  metrics->RegisterGauge("webserver_user_cache_entries", "Entries in the user cache, including negative ones.",
+                         [] { return static_cast<double>(UserCache::Instance()->Size()); });
+#ifdef USE_MYSQL
+  metrics->RegisterGauge("webserver_sql_pool_free", "Idle connections in the SQL connection pool.",
+                         [] { return static_cast<double>(SqlConnPool::Instance()->GetFreeConnCount()); });
+  metrics->RegisterGauge("webserver_sql_pool_open", "Open connections in the SQL connection pool.",
+                         [] { return static_cast<double>(SqlConnPool::Instance()->GetConnCount()); });
+  metrics->RegisterGauge("webserver_user_filter_loaded", "Usernames loaded into the registration Bloom filter.",
+                         [] { return static_cast<double>(UserFilter::Instance()->LoadedCount()); });
+  metrics->RegisterGauge("webserver_user_filter_skipped_selects_total", "Registration SELECTs skipped by the Bloom filter.",
+                         [] { return static_cast<double>(UserFilter::Instance()->SkippedSelects()); }, true);
+  metrics->RegisterGauge("webserver_insert_batches_total", "Registration insert batches written by group commit.",
+                         [] { return static_cast<double>(InsertBatcher::Instance()->Batches()); }, true);
+  metrics->RegisterGauge("webserver_insert_batch_rows_total", "Registration rows written by group commit.",
+                         [] { return static_cast<double>(InsertBatcher::Instance()->Rows()); }, true);
+  metrics->RegisterGauge("webserver_insert_batch_fallbacks_total", "Batches retried row by row after the multi-row INSERT failed.",
+                         [] { return static_cast<double>(InsertBatcher::Instance()->Fallbacks()); }, true);
+#endif
+  metrics->RegisterGauge("webserver_rate_limited_total", "Requests answered with 429 by the per-IP rate limiter.",
+                         [] { return static_cast<double>(RateLimiter::Instance()->Rejects()); }, true);
+  metrics->RegisterGauge("webserver_rate_limit_evictions_total", "Rate limiter buckets evicted by CLOCK.",
+                         [] { return static_cast<double>(RateLimiter::Instance()->Evictions()); }, true);
+  metrics->RegisterGauge("webserver_local_users", "Users in the local append-log user store.",
+                         [] { return static_cast<double>(LocalUserStore::Instance()->Size()); });
+  metrics->RegisterSection([](std::string &out) {
+    HeavyHitters::Clients()->Render(out, "webserver_top_client_requests",
+                                    "Busiest client IPs, requests halved every 10s (Count-Min Sketch estimate).", "ip");
+    HeavyHitters::Paths()->Render(out, "webserver_top_path_requests",
+                                  "Busiest request paths, requests halved every 10s (Count-Min Sketch estimate).", "path");
+  });
+  LOG_INFO("Metrics: GET /metrics from loopback");
+}
+
 void WebServer::Start() {
   int time_ms = -1; /* 原作者注释 epoll wait timeout == -1 无事件将阻塞 */
   if (!is_close_) {
     LOG_INFO("======== Server start ========");
   }
+  TimeStamp next_summary = Clock::now() + MS(kLatencySummaryMs);
+  TimeStamp next_session_tick = Clock::now() + MS(SessionStore::kTickMs);
   while (!is_close_) {
     if (timeout_ms_ > 0) {
-      time_ms = timer_->GetNextTick();
+      if (open_metrics_) {
+        // 定时器堆的开销随连接数增长，每轮都记录
+        TimeStamp tick_begin = Clock::now();
+        time_ms = timer_->GetNextTick();
+        Metrics::Instance()->RecordLatency(Metrics::kTimerTick, std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - tick_begin).count());
+      } else {
+        time_ms = timer_->GetNextTick();
+      }
+    }
+    // 会话的时间轮每秒推进一格，epoll等待时间不超过下一格的时刻
+    int session_ms = std::chrono::duration_cast<MS>(next_session_tick - Clock::now()).count();
+    if (session_ms <= 0) {
+      SessionStore::Instance()->Tick();
+      next_session_tick += MS(SessionStore::kTickMs);
+      session_ms = std::max<int>(std::chrono::duration_cast<MS>(next_session_tick - Clock::now()).count(), 0);
+    }
+    if (time_ms < 0 || time_ms > session_ms) {
+      time_ms = session_ms;
+    }
+    if (open_metrics_) {
+      // 定期将各阶段延迟的分位数写入日志，epoll等待时间不超过下一次输出的时刻
+      int summary_ms = std::chrono::duration_cast<MS>(next_summary - Clock::now()).count();
+      if (summary_ms <= 0) {
+        Metrics::Instance()->LogLatencySummary();
+        next_summary = Clock::now() + MS(kLatencySummaryMs);
+        summary_ms = kLatencySummaryMs;
+      }
+      if (time_ms < 0 || time_ms > summary_ms) {
+        time_ms = summary_ms;
+      }
     }
     int event_cnt = epoller_->Wait(time_ms);
+    TimeStamp dispatch_begin;
+    if (open_metrics_ && event_cnt > 0) {
+      dispatch_begin = Clock::now();
+    }
     for (int i = 0; i < event_cnt; ++i) {
       /* 原作者注释 处理事件 */
       int fd = epoller_->GetEventFd(i);
       uint32_t events = epoller_->GetEvents(i);
       if (fd == listen_fd_) {
         DealListen_();
+#ifdef USE_MYSQL
+      } else if (SqlAsync::Instance()->HandleEvent(fd, events)) {
+        /* 异步数据库验证的eventfd或数据库连接的套接字，已在SqlAsync中处理 */
+#endif
       } else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
         assert(users_.count(fd) > 0);
         CloseConn_(&users_[fd]);
@@ -94,6 +327,11 @@ void WebServer::Start() {
         LOG_ERROR("Unexpected event");
       }
     }
+    if (open_metrics_ && event_cnt > 0) {
+      // 处理一批就绪事件的耗时，即排在最后的就绪事件最多要等多久才被处理
+      Metrics::Instance()->RecordLatency(Metrics::kEventDispatch, std::chrono::duration_cast<std::chrono::microseconds>(
+          Clock::now() - dispatch_begin).count());
+    }
   }
 }
 
@@ -132,19 +370,99 @@ void WebServer::DealListen_() {
     int fd = accept(listen_fd_, (struct sockaddr *) &addr, &len);
     if (fd <= 0) {
       return;
-    } else if (HttpConn::user_count >= kMaxFd) {
-      SendError_(fd, "Server busy!");
+    } else if (HttpConn::user_count >= max_conn_ || BufferPool::Instance()->InUseBytes() >= max_buffer_bytes_) {
+      // 连接数或缓冲区内存达到上限，回复503而不是接受后再因内存不足崩溃
+      Metrics::Instance()->Add(Metrics::kAcceptRejects);
+      Metrics::Instance()->AddStatus(503);
+      SendError_(fd, kBusyResponse);
       LOG_WARN("Clients is full!");
       return;
     }
+    Metrics::Instance()->Add(Metrics::kAccepts);
     AddClient_(fd, addr);
   } while (listen_event_ & EPOLLET);
 }
 
+// 新请求进入线程池前做准入控制：先按客户端IP限速，再看线程池，队列已满时在主线程直接拒绝，排队过久时由工作线程拒绝
+// 限速和排队都在读取、解析请求之前判断，被拒绝的请求不会占用工作线程和数据库连接
 void WebServer::DealRead_(HttpConn *client) {
   assert(client);
   ExtentTime_(client);
-  thread_pool_->AddTask(std::bind(&WebServer::OnRead_, this, client));
+  // 是不是请求的开头由连接的解析状态决定，不看数据的内容：分多次到达的请求只在第一次读事件时计一次，
+  // 开头不完整（如方法名和后面的内容分成两段发送）也会被计入，不能靠拆分请求绕过限速
+  // 请求的类别只有限速和排队时用得到：线程池队列为空时请求马上就被取走，放进哪个优先级都一样，
+  // 此时不在主线程为每个请求多做一次recv(MSG_PEEK)，按普通请求放入高优先级队列
+  RequestStart start = kNotStart;
+  if (client->IsRequestStart()) {
+    start = rate_limit_ || thread_pool_->HasBacklog() ? PeekRequest_(client->GetFd()) : kStartRequest;
+  }
+  if (open_metrics_ && start != kNotStart) {
+    // 客户端在这里计数，被限速或丢弃的请求也算在内，这些往往正是要找的客户端
+    in_addr_t ip = client->GetAddr().sin_addr.s_addr;
+    HeavyHitters::Clients()->Record(&ip, sizeof(ip));
+  }
+  if (rate_limit_ && start != kNotStart && !AllowRequest_(client, start)) {
+    Reject_(client, 429);
+    return;
+  }
+  client->MarkQueued();
+  if (!thread_pool_->TryAddTask(std::bind(&WebServer::OnRead_, this, client),
+                                std::bind(&WebServer::Reject_, this, client, 503),
+                                start == kStartLogin ? ThreadPool::kLow : ThreadPool::kHigh)) {
+    Reject_(client, 503);
+  }
+}
+
+// 请求以方法名和空格开头，方法名最长7个字符（OPTIONS），只看开头的8个字节
+// 只有看到完整的非POST方法名时才按普通请求计，其余（POST、不完整、不认识的开头）都按登录计，宁严勿宽
+WebServer::RequestStart WebServer::PeekRequest_(int fd) {
+  char head[8];
+  ssize_t len = recv(fd, head, sizeof(head), MSG_PEEK | MSG_DONTWAIT);
+  if (len <= 0) {
+    return kNotStart;
+  }
+  return ClassifyRequest_(head, len);
+}
+
+WebServer::RequestStart WebServer::ClassifyRequest_(const char *head, size_t len) {
+  len = std::min(len, static_cast<size_t>(8));
+  for (size_t i = 0; i < len; ++i) {
+    if (head[i] == ' ') {
+      if (i == 0 || (i == 4 && memcmp(head, "POST", 4) == 0)) {
+        break;
+      }
+      return kStartRequest;
+    }
+    if (head[i] < 'A' || head[i] > 'Z') {
+      break;
+    }
+  }
+  return kStartLogin;
+}
+
+// 登录/注册也是请求，先计入普通请求的桶，通过后再计入登录的桶
+bool WebServer::AllowRequest_(const HttpConn *client, RequestStart start) {
+  in_addr_t ip = client->GetAddr().sin_addr.s_addr;
+  if (!RateLimiter::Instance()->Allow(ip, kRouteRequest)) {
+    return false;
+  }
+  return start != kStartLogin || RateLimiter::Instance()->Allow(ip, kRouteLogin);
+}
+
+// 先读掉已到达的请求：接收缓冲区中还有数据时close会发送RST，客户端可能收不到响应
+void WebServer::Reject_(HttpConn *client, int code) {
+  assert(client);
+  int fd = client->GetFd();
+  char discard[4096];
+  for (int i = 0; i < kShedDrainReads && recv(fd, discard, sizeof(discard), MSG_DONTWAIT) > 0; ++i) {
+  }
+  if (code == 429) {
+    send(fd, kRateLimitedResponse, sizeof(kRateLimitedResponse) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+  } else {
+    send(fd, kBusyResponse, sizeof(kBusyResponse) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+  }
+  Metrics::Instance()->AddStatus(code);
+  CloseConn_(client);
 }
 
 void WebServer::DealWrite_(HttpConn *client) {
@@ -175,11 +493,44 @@ void WebServer::OnRead_(HttpConn *client) {
 void WebServer::OnProcess(HttpConn *client) {
   if (client->Process()) {
     epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT);
+  } else if (client->IsWaitingSql()) {
+    // 等待验证期间连接上不注册事件，由验证完成的回调重新注册
+    SubmitVerify_(client);
   } else {
     epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLIN);
   }
 }
 
+void WebServer::SubmitVerify_(HttpConn *client) {
+  int fd = client->GetFd();
+  uint32_t ticket = client->NextVerifyTicket();
+  const HttpRequest &request = client->Request();
+  // 回调在主线程执行，连接可能已因超时被关闭，fd也可能已分配给新的连接，用ticket区分
+  std::string name(request.VerifyName().data, request.VerifyName().size);
+  std::string pwd(request.VerifyPwd().data, request.VerifyPwd().size);
+#ifdef USE_MYSQL
+  SqlAsync::Instance()->SubmitVerify(name, pwd, request.VerifyIsLogin(),
+                                     [this, client, fd, ticket](SqlAsync::Result result) {
+    if (client->GetFd() != fd || !client->IsWaitingSql() || client->VerifyTicket() != ticket) {
+      return;
+    }
+    thread_pool_->AddTask([this, client, fd, ticket, result] {
+      if (client->GetFd() != fd || !client->IsWaitingSql() || client->VerifyTicket() != ticket) {
+        return;
+      }
+      if (client->FinishVerify(result == SqlAsync::kVerified, result == SqlAsync::kUnavailable)) {
+        epoller_->ModFd(fd, conn_event_ | EPOLLOUT);
+      } else {
+        epoller_->ModFd(fd, conn_event_ | EPOLLIN);
+      }
+    });
+  });
+#else
+  // 没有MySQL时不会开启异步验证
+  assert(false);
+#endif
+}
+
 void WebServer::OnWrite_(HttpConn *client) {
   assert(client);
   int ret = -1;
@@ -188,6 +539,14 @@ void WebServer::OnWrite_(HttpConn *client) {
   if (client->ToWriteBytes() == 0) {
     /* 原作者注释 传输完成 */
     if (client->IsKeepAlive()) {
+      if (rate_limit_ && client->HasPipelinedRequest()) {
+        // 同一次读入的后续请求在这里才开始处理，不经过DealRead_，逐个计入限速
+        const Buffer &buff = client->ReadBuffer();
+        if (!AllowRequest_(client, ClassifyRequest_(buff.Peek(), buff.ReadableBytes()))) {
+          Reject_(client, 429);
+          return;
+        }
+      }
       OnProcess(client);
       return;
     }
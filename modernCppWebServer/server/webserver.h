@@ -6,6 +6,7 @@
 #define MODERNCPPWEBSERVER_SERVER_WEBSERVER_H_
 
 #include <unordered_map>
+#include <algorithm>
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
@@ -17,17 +18,31 @@
 #include "epoller.h"
 #include "../log/log.h"
 #include "../timer/heaptimer.h"
-#include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
+#include "../pool/usercache.h"
+#include "../pool/userstore.h"
+#include "../pool/localuserstore.h"
+#ifdef USE_MYSQL
+#include "../pool/sqlconnpool.h"
 #include "../pool/sqlconnRAII.h"
+#include "../pool/sqlasync.h"
+#include "../pool/userfilter.h"
+#include "../pool/insertbatcher.h"
+#include "../pool/mysqluserstore.h"
+#endif
 #include "../http/httpconn.h"
+#include "../http/sessionstore.h"
+#include "../metrics/heavyhitters.h"
+#include "ratelimiter.h"
 
 class WebServer {
  public:
   WebServer(int port, int trig_mode, int timeout_ms, bool opt_linger,
             int sql_port, const char *sql_user, const char *sql_pwd,
             const char *db_name, int conn_pool_num, int thread_num,
-            bool open_log, int log_level, int log_que_size);
+            bool open_log, int log_level, int log_que_size,
+            int access_log_sample = 0, bool open_metrics = false,
+            bool async_sql = false, const char *user_log = nullptr, bool rate_limit = false);
 
   ~WebServer();
   void Start();
@@ -36,6 +51,14 @@ class WebServer {
 
   bool InitSocket_();
   void InitEventMode_(int trig_mode);
+  void InitMetrics_();
+  // 把描述符数的软限制提高到硬限制，由此确定最多接受的连接数
+  void InitFdLimit_();
+  // 按可用内存进一步限制连接数和借给连接的缓冲区总量
+  void InitMemoryLimit_();
+  // 选择用户存储后端，user_log不为空时使用本地追加日志文件，否则使用MySQL
+  void InitUserStore_(int sql_port, const char *sql_user, const char *sql_pwd, const char *db_name,
+                      int conn_pool_num, const char *user_log, bool async_sql);
   void AddClient_(int fd, sockaddr_in addr);
 
   void DealListen_();
@@ -43,14 +66,59 @@ class WebServer {
   void DealRead_(HttpConn *client);
 
   void SendError_(int fd, const char *info);
+  // 拒绝连接上的请求，回复预先生成的响应（过载503，限速429）并关闭连接
+  void Reject_(HttpConn *client, int code);
+
+  // 连接上待读的数据是不是一个请求的开头，以及请求的类别
+  enum RequestStart {
+    kNotStart = 0,  // 读到一半的请求（如分多次到达的请求体），或者没有数据（对端关闭）
+    kStartRequest,  // 完整的非POST方法名，GET等，静态资源
+    kStartLogin,    // POST，登录/注册，要访问数据库；看不出方法名（不完整或不认识）的开头也按这一类
+  };
+  // 不取出数据，查看请求的开头，决定限速的类别和进入线程池的哪个队列，只在连接处于请求开头时调用
+  static RequestStart PeekRequest_(int fd);
+  // 按请求开头的len个字节判断请求的类别
+  static RequestStart ClassifyRequest_(const char *head, size_t len);
+  // 按客户端IP限速，所有请求计入kRouteRequest，登录/注册再计入kRouteLogin，被限速时返回false
+  bool AllowRequest_(const HttpConn *client, RequestStart start);
+
+  // 限速的类别，即RateLimiter中规则的下标
+  enum RateLimitRoute {
+    kRouteRequest = 0,  // 所有请求
+    kRouteLogin,        // 登录/注册的POST，另外单独限速，防止暴力破解密码
+  };
   void ExtentTime_(HttpConn *client);
   void CloseConn_(HttpConn *client);
 
   void OnRead_(HttpConn *client);
   void OnWrite_(HttpConn *client);
   void OnProcess(HttpConn *client);
-
-  static const int kMaxFd = 65536;
+  // 把等待验证的请求提交给SqlAsync，验证完成后再交给线程池生成响应
+  void SubmitVerify_(HttpConn *client);
+
+  static const int kMaxFd = 1 << 20;  // 连接数的上限，实际上限还受RLIMIT_NOFILE限制，见InitFdLimit_()
+  static const int kReservedFd = 64; // 为监听套接字、epoll、日志、数据库连接等保留的描述符数
+  static const int kConnMemoryBytes = 16 << 10; // 估计的每个连接占用的内存（用户态和内核套接字缓冲区）
+  static const int kMaxQueuedRequests = 4096;  // 线程池每个优先级队列中最多等待的新请求数，超过时回复503
+  static const int kShedDrainReads = 16;       // 拒绝请求时最多读掉的次数（每次4KB）
+  static const int kRateLimitEntries = 1 << 20; // 限速表的条目数（IP和类别的组合），约16MB
+  static const int kRequestRate = 200;  // 每个IP每秒的请求数
+  static const int kRequestBurst = 400;
+  static const int kLoginRate = 10;     // 每个IP每秒的登录/注册数
+  static const int kLoginBurst = 20;
+  static const int kLatencySummaryMs = 60000; // 延迟分位数写入日志的间隔
+  static const int kSqlPoolGrowFactor = 2;  // 数据库连接池最多扩展到初始连接数的这么多倍
+  static const int kSqlWaitTimeoutMs = 500; // 取数据库连接最多等待的时间，超时返回503
+  static const int kSqlQueryTimeoutMs = 5000; // 异步验证取到连接后最多执行的时间，超时返回503，与连接池同步读写的超时相同
+  static constexpr const char *kDefaultUserLog = "./users.log"; // 没有启用MySQL时默认的本地用户文件
+  static const int kUserCacheCapacity = 100000; // 用户缓存的条目数
+  static const int kUserCacheTtlMs = 300000;    // 存在的用户的缓存有效期
+  static const int kUserCacheNegativeTtlMs = 10000; // 不存在的用户名的缓存有效期
+  static const int kSessionTtlSec = 1800;     // 登录会话的有效期
+  static const int kSessionCapacity = 1000000; // 最多保存的会话数，超过后登录成功也不再创建会话
+  static const int kUserFilterCapacity = 1 << 20; // 用户名布隆过滤器按此用户数设计，误判率为1%
+  static const int kInsertBatchRows = 64;   // 注册组提交每批最多的行数
+  static const int kInsertBatchDelayMs = 2; // 注册组提交最长的攒批时间
 
   static int SetFdNonblock(int fd);
 
@@ -58,7 +126,11 @@ class WebServer {
   bool open_linger_;
   int timeout_ms_;
   bool is_close_;
+  bool open_metrics_;
+  bool rate_limit_;
   int listen_fd_;
+  int max_conn_;  // 最多同时保持的客户端连接数
+  size_t max_buffer_bytes_;  // 借给连接的缓冲区总量超过这个值时拒绝新连接
   char *src_dir_;
 
   uint32_t listen_event_;
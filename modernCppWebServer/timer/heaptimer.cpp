@@ -10,8 +10,8 @@ void HeapTimer::SiftUp_(size_t i) {
   size_t j = (i - 1) / 2; // j为父节点位置
   while (j >= 0) {
     // 如果父节点j的值大于i的值，则向上交换，使值小的在上方，直到它父节点小于它或到根节点（第0）位置
-    // 原代码没有限制i == 0会直接进入死循环，这里i == 0后，直接break掉
-    if (heap_[j] < heap_[i] || i == 0) {
+    // 原代码没有限制i == 0会直接进入死循环，这里i == 0后，直接break掉（需先判断i == 0，否则j越界访问）
+    if (i == 0 || heap_[j] < heap_[i]) {
       break;
     }
     SwapNode_(i, j);
@@ -136,6 +136,7 @@ void HeapTimer::Tick() {
       break;
     }
     node.cb();
+    Metrics::Instance()->Add(Metrics::kTimerExpired);
     Pop();
   }
 }